@@ -9,6 +9,8 @@
 #include "App.h"
 
 #include "BolidRecorder.h"
+#include "CapacityPlanner.h"
+#include "MetricsAgent.h"
 #include "git_version.h"
 
 
@@ -157,6 +159,9 @@ void App::setUp()
 	options().add('v',
 			    "",
 			    "Show program version.");
+	options().add('n',
+			    "",
+			    "Dry run: report memory and CPU requirements of the configuration and exit.");
 	
 	//Logger::clearConfig();
 	//Logger::addOutput(LOG_LVL_DEBUG, "waterfall.log");
@@ -203,6 +208,11 @@ int App::onRun()
 	
 	LOG_INFO("***** Starting Radio Observer v" PACKAGE_VERSION " " GIT_VERSION " *****");
 	
+	SnapshotWriterPool::getInstance().configure(
+		config_->getStrInt("writer_threads", 2),
+		config_->getStrInt("writer_queue_size", SNAPSHOT_QUEUE_SIZE)
+	);
+	
 	string cfgName = config_->getStrString("configuration", "default");
 	Injector::getInstance().makePlans(config_->getStrItem("configurations"));
 	
@@ -212,6 +222,9 @@ int App::onRun()
 		return EXIT_INIT_FAILED;
 	}
 	
+	if (options().get('n'))
+		return dryRun();
+	
 	if (pipeline_->getFrontend().isNull())
 		pipeline_->setFrontend(createFrontend());
 	
@@ -224,8 +237,16 @@ int App::onRun()
 	Signal::INT.pushMethod(this, &App::interruptHandler);
 	Signal::TERM.install();
 	Signal::TERM.pushMethod(this, &App::termHandler);
+	Ref<MetricsAgent> metrics = new MetricsAgent(config_->getStrInt("metrics_interval", 60));
+	metrics->start();
+	Signal::USR1.install();
+	Signal::USR1.pushMethod(this, &App::dumpHandler);
 	//frontend_->run();
 	pipeline_->run();
+	Signal::USR1.pop();
+	Signal::USR1.uninstall();
+	metrics->stop();
+	metrics->join();
 	Signal::TERM.pop();
 	Signal::TERM.uninstall();
 	Signal::INT.pop();
@@ -248,6 +269,32 @@ int App::onRun()
 }
 
 
+/**
+ * Instantiates the configured backend without a frontend and reports its
+ * memory and CPU requirements (see \ref CapacityPlanner).
+ */
+int App::dryRun()
+{
+	Ref<Backend> backend = pipeline_->getBackend();
+	if (backend.isNull()) {
+		LOG_ERROR("The configuration has no backend.");
+		return EXIT_INIT_FAILED;
+	}
+	
+	CapacityPlanner planner(
+		backend,
+		config_->getStrInt("dry_run_sample_rate",
+					    config_->getStrInt("raw_sample_rate", 96000)),
+		config_->getStrDouble("dry_run_length", 5.0),
+		config_->getStrInt("dry_run_block_size", 1024)
+	);
+	
+	if (!planner.run(cout))
+		return EXIT_INIT_FAILED;
+	return 0;
+}
+
+
 void App::interruptHandler(int sigNum)
 {
 	LOG_WARNING("Received INT signal, stopping the frontend.");
@@ -263,6 +310,16 @@ void App::termHandler(int sigNum)
 }
 
 
+/**
+ * Runs in the signal handler, so the dump is only requested and done by
+ * the \ref MetricsAgent thread.
+ */
+void App::dumpHandler(int sigNum)
+{
+	MetricsAgent::requestDump();
+}
+
+
 /**
  * Constructor.
  */
@@ -52,8 +52,11 @@ protected:
 	virtual void setUp();
 	virtual int onRun();
 	
+	int dryRun();
+	
 	void interruptHandler(int sigNum);
 	void termHandler(int sigNum);
+	void dumpHandler(int sigNum);
 
 public:
 	App();
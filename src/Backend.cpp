@@ -12,7 +12,8 @@
 /**
  * Constructor.
  */
-Backend::Backend()
+Backend::Backend() :
+	dryRun_(false)
 {
 }
 
@@ -9,6 +9,7 @@
 #ifndef BACKEND_IFO2SX99
 #define BACKEND_IFO2SX99
 
+#include <string>
 #include <vector>
 
 using namespace std;
@@ -77,6 +78,20 @@ struct DataInfo {
 };
 
 
+/**
+ * \brief Memory used by one buffer of a backend (see \ref Backend::reportMemory).
+ */
+struct MemoryUsage {
+	string name;   ///< Name of the buffer.
+	size_t bytes;  ///< Number of bytes allocated for the buffer.
+	string detail; ///< Human readable description of the buffer size (e.g. length in seconds).
+	
+	MemoryUsage(const string &name, size_t bytes, const string &detail = "") :
+		name(name), bytes(bytes), detail(detail)
+	{}
+};
+
+
 /**
  * \brief Base class for backend that take I/Q data and process them.
  */
@@ -86,11 +101,29 @@ private:
 	
 protected:
 	StreamInfo streamInfo_;
+	bool       dryRun_; ///< The backend processes synthetic data and must not write any output.
 	
 public:
 	Backend();
 	virtual ~Backend() {}
 	
+	bool isDryRun() const { return dryRun_; }
+	/**
+	 * \brief Enables the dry-run mode used to plan the capacity of a configuration.
+	 *
+	 * In the dry-run mode, the backend processes data as usual, but it
+	 * doesn't write any files or send any messages.
+	 */
+	virtual void setDryRun(bool value) { dryRun_ = value; }
+	
+	/**
+	 * \brief Appends the memory used by the backend's buffers to \c usage.
+	 *
+	 * The buffers are only allocated by \ref startStream, so the method
+	 * should be called after it.
+	 */
+	virtual void reportMemory(vector<MemoryUsage> &usage) {}
+	
 	/**
 	 * \brief Return the stream information passed to the backend through startStream().
 	 */
@@ -0,0 +1,436 @@
+/**
+ * \file   BasebandRecorder.cpp
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Implementation file for the BasebandRecorder class.
+ */
+
+#include "BasebandRecorder.h"
+#include "utils.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <unistd.h>
+#include <vector>
+
+
+#define WAV_HEADER_SIZE 44
+#define WAV_CHUNK_HEADER_SIZE 8
+#define PAGE_SIZE_BYTES 4096
+
+
+BasebandRecorder::BasebandRecorder(Ref<WaterfallBackend> backend,
+						     string                outputDir,
+						     string                outputType,
+						     FileFormat            fileFormat,
+						     bool                  int16,
+						     int                   rotateTime,
+						     int64_t               rotateSize,
+						     double                bufferLength,
+						     int                   blockSize) :
+	Recorder(backend),
+	outputDir_(outputDir),
+	outputType_(outputType),
+	fileFormat_(fileFormat),
+	int16_(int16),
+	rotateTime_(rotateTime),
+	rotateSize_(rotateSize),
+	bufferLength_(bufferLength),
+	thread_(NULL),
+	stopping_(false),
+	waitingFor_(NOT_WAITING),
+	block_(NULL),
+	blockUsed_(0),
+	fd_(-1),
+	fileBytes_(0),
+	fileSamplesLeft_(0),
+	maxLag_(0),
+	lostSamples_(0)
+{
+	// Whole pages of whole samples.
+	blockSize_ = max(blockSize / PAGE_SIZE_BYTES, 1) * PAGE_SIZE_BYTES;
+}
+
+
+BasebandRecorder::~BasebandRecorder()
+{
+	free(block_);
+	block_ = NULL;
+}
+
+
+int BasebandRecorder::requestRawBufferSize()
+{
+	return (int)ceil(bufferLength_ * (double)getSampleRate());
+}
+
+
+WFTime BasebandRecorder::positionToTime(uint64_t position)
+{
+	StreamInfo info = backend_->getStreamInfo();
+	return info.timeOffset.addSamples(position, info.sampleRate);
+}
+
+
+bool BasebandRecorder::writeAll(const void *data, size_t size)
+{
+	const uint8_t *p = (const uint8_t*)data;
+	
+	while (size > 0) {
+		ssize_t written = ::write(fd_, p, size);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			
+			LOG_ERROR("Failed to write to \"" << fileName_ << "\": " << strerror(errno) << ".");
+			return false;
+		}
+		
+		p    += written;
+		size -= written;
+	}
+	return true;
+}
+
+
+/**
+ * Writes the header at the start of the file. The sizes are filled in
+ * when the file is closed.
+ *
+ * A \c JUNK chunk between the format and the data chunks pads the header
+ * to \ref getHeaderSize, so that the samples start at a block boundary.
+ */
+void BasebandRecorder::writeWAVHeader(int64_t dataBytes)
+{
+	int sampleRate   = backend_->getStreamInfo().sampleRate;
+	int bitsPerValue = int16_ ? 16 : 32;
+	int headerSize   = getHeaderSize();
+	
+	// WAV sizes are 32-bit.
+	uint32_t size = (dataBytes > 0xffffffffll - headerSize) ?
+		0xffffffffu - headerSize : (uint32_t)dataBytes;
+	
+	vector<uint8_t> header(headerSize, 0);
+	uint8_t *p = &(header[0]);
+	
+	memcpy(p, "RIFF", 4); p += 4;
+	p = putLE(p, (uint32_t)(size + headerSize - 8));
+	memcpy(p, "WAVEfmt ", 8); p += 8;
+	p = putLE(p, (uint32_t)16);
+	p = putLE(p, (uint16_t)(int16_ ? 1 : 3)); // PCM or IEEE float
+	p = putLE(p, (uint16_t)2);
+	p = putLE(p, (uint32_t)sampleRate);
+	p = putLE(p, (uint32_t)(sampleRate * getSampleSize()));
+	p = putLE(p, (uint16_t)getSampleSize());
+	p = putLE(p, (uint16_t)bitsPerValue);
+	memcpy(p, "JUNK", 4); p += 4;
+	p = putLE(p, (uint32_t)(headerSize - WAV_HEADER_SIZE - WAV_CHUNK_HEADER_SIZE));
+	p = &(header[headerSize - WAV_CHUNK_HEADER_SIZE]);
+	memcpy(p, "data", 4); p += 4;
+	putLE(p, size);
+	
+	if (pwrite(fd_, &(header[0]), headerSize, 0) != (ssize_t)headerSize)
+		LOG_ERROR("Failed to write WAV header to \"" << fileName_ << "\": " << strerror(errno) << ".");
+}
+
+
+void BasebandRecorder::openFile()
+{
+	StreamInfo info = backend_->getStreamInfo();
+	WFTime     time = positionToTime(cursor_.position);
+	
+	char name[1024];
+	snprintf(name, sizeof(name), "%s%03d_%s_%s.%s",
+		    time.format("%Y%m%d%H%M%S").c_str(),
+		    (int)(time.microseconds() / 1000),
+		    backend_->getOrigin().c_str(),
+		    outputType_.c_str(),
+		    (fileFormat_ == FORMAT_WAV) ? "wav" : "raw");
+	fileName_  = Path::join(outputDir_, string(name));
+	fileBytes_ = 0;
+	
+	// Rotate at the next multiple of the rotation time or after the
+	// rotation size, whichever comes first.
+	fileSamplesLeft_ = NOT_WAITING;
+	if (rotateTime_ > 0) {
+		time_t end = (time.seconds() / rotateTime_ + 1) * rotateTime_;
+		double left = ((double)(end - time.seconds()) - (double)time.microseconds() / 1e6) *
+			(double)info.sampleRate;
+		fileSamplesLeft_ = (uint64_t)max(left, 1.0);
+	}
+	if (rotateSize_ > 0)
+		fileSamplesLeft_ = min(fileSamplesLeft_, (uint64_t)max(rotateSize_ / getSampleSize(), (int64_t)1));
+	
+	LOG_INFO("Writing baseband \"" << fileName_ << "\"...");
+	
+	fd_ = ::open(fileName_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd_ < 0) {
+		LOG_ERROR("Failed to create \"" << fileName_ << "\": " << strerror(errno) << ".");
+		return;
+	}
+	
+	if (fileFormat_ == FORMAT_WAV) {
+		writeWAVHeader(0);
+		lseek(fd_, getHeaderSize(), SEEK_SET);
+	}
+}
+
+
+void BasebandRecorder::closeFile()
+{
+	flushBlock();
+	
+	if (fd_ >= 0) {
+		if (fileFormat_ == FORMAT_WAV)
+			writeWAVHeader(fileBytes_);
+		::close(fd_);
+		fd_ = -1;
+	}
+	
+	dump();
+}
+
+
+/**
+ * Writes the filled part of the block buffer. Only the last block of a
+ * file is shorter than the block size.
+ */
+void BasebandRecorder::flushBlock()
+{
+	if (blockUsed_ == 0) return;
+	
+	if (fd_ >= 0) {
+		LatencyTimer timer;
+		if (writeAll(block_, blockUsed_))
+			fileBytes_ += blockUsed_;
+		timer.lap(writeLatency_);
+	}
+	
+	blockUsed_ = 0;
+}
+
+
+/**
+ * Sleeps until the raw sample before \c position is published or the
+ * recorder is stopped.
+ */
+void BasebandRecorder::waitFor(uint64_t position)
+{
+	MutexLock lock(&mutex_);
+	
+	waitingFor_ = position;
+	__sync_synchronize();
+	while (!stopping_ && (rawBuffer_->getPublished() < position))
+		condition_.wait(mutex_);
+	waitingFor_ = NOT_WAITING;
+}
+
+
+/**
+ * Only takes the lock when the block the thread waits for is published.
+ */
+void BasebandRecorder::published(Cursor head)
+{
+	uint64_t target = waitingFor_;
+	if ((rawBuffer_->getPublished() >= target) &&
+	    __sync_bool_compare_and_swap(&waitingFor_, target, NOT_WAITING)) {
+		MutexLock lock(&mutex_);
+		condition_.signal();
+	}
+}
+
+
+/**
+ * Writes all published samples (whole blocks only, the rest stays in
+ * the block buffer).
+ */
+void BasebandRecorder::drain()
+{
+	uint64_t head = rawBuffer_->getPublished();
+	
+	if (rawBuffer_->isOverrun(cursor_)) {
+		// Skip to the middle of the buffer, so that the recorder
+		// doesn't keep chasing the writer.
+		IQBuffer::Cursor next = rawBuffer_->cursor(rawBuffer_->getCapacity() / 2);
+		LOG_WARNING("Baseband recorder fell behind, " << (next.position - cursor_.position) <<
+				  " samples lost.");
+		lostSamples_ += next.position - cursor_.position;
+		cursor_ = next;
+		
+		// Start a new file after the gap, so that the time in the file
+		// name stays correct.
+		fileSamplesLeft_ = 0;
+	}
+	
+	if (head > cursor_.position)
+		maxLag_ = max(maxLag_, head - cursor_.position);
+	
+	IQBuffer::Plane &planeI = rawBuffer_->plane(IQBuffer::PLANE_I);
+	IQBuffer::Plane &planeQ = rawBuffer_->plane(IQBuffer::PLANE_Q);
+	int sampleSize = getSampleSize();
+	
+	while (rawBuffer_->available(cursor_) > 0) {
+		if (fileSamplesLeft_ == 0) {
+			closeFile();
+			openFile();
+		}
+		
+		int count = min(rawBuffer_->available(cursor_), (blockSize_ - blockUsed_) / sampleSize);
+		if ((uint64_t)count > fileSamplesLeft_)
+			count = (int)fileSamplesLeft_;
+		
+		// Interleave the samples into the block buffer in runs.
+		int used = blockUsed_;
+		int mark = rawBuffer_->mark(cursor_);
+		for (int done = 0; done < count; ) {
+			int rows;
+			float *i = planeI.span(mark, count - done, &rows);
+			float *q = planeQ.span(mark, rows, &rows);
+			
+			if (int16_) {
+				int16_t *dest = (int16_t*)(block_ + blockUsed_);
+				for (int k = 0; k < rows; k++) {
+					dest[2 * k]     = FFTBackend::floatToInt(i[k]);
+					dest[2 * k + 1] = FFTBackend::floatToInt(q[k]);
+				}
+			} else {
+				float *dest = (float*)(block_ + blockUsed_);
+				for (int k = 0; k < rows; k++) {
+					dest[2 * k]     = i[k];
+					dest[2 * k + 1] = q[k];
+				}
+			}
+			
+			blockUsed_ += rows * sampleSize;
+			done       += rows;
+			mark       += rows;
+		}
+		
+		// The samples may have been overwritten while being copied,
+		// they are skipped on the next drain().
+		if (rawBuffer_->isOverrun(cursor_)) {
+			blockUsed_ = used;
+			break;
+		}
+		
+		cursor_          += count;
+		fileSamplesLeft_ -= count;
+		
+		if ((blockUsed_ + sampleSize > blockSize_) || (fileSamplesLeft_ == 0))
+			flushBlock();
+	}
+}
+
+
+void BasebandRecorder::dump()
+{
+	double capacity = (double)rawBuffer_->getCapacity();
+	
+	LOG_INFO("Baseband recorder: max lag = " << 100.0 * (double)maxLag_ / capacity <<
+		    " % of the raw buffer, lost samples = " << lostSamples_);
+	maxLag_ = 0;
+}
+
+
+void* BasebandRecorder::threadMethod()
+{
+	openFile();
+	
+	while (!stopping_) {
+		// Sleep until there are enough samples to fill the block.
+		int missing = (blockSize_ - blockUsed_) / getSampleSize();
+		waitFor(cursor_.position + missing);
+		drain();
+	}
+	
+	drain();
+	closeFile();
+	
+	return NULL;
+}
+
+
+void BasebandRecorder::start()
+{
+	// Nothing is written in the dry-run mode.
+	if (backend_->isDryRun()) return;
+	
+	if (block_ == NULL) {
+		if (posix_memalign((void**)&block_, PAGE_SIZE_BYTES, blockSize_) != 0)
+			throw std::bad_alloc();
+	}
+	blockUsed_ = 0;
+	
+	writeLatency_.setName(backend_->getLatencyPrefix() + ".baseband.write");
+	
+	cursor_      = rawBuffer_->cursor();
+	stopping_    = false;
+	maxLag_      = 0;
+	lostSamples_ = 0;
+	thread_ = new Thread(this, &BasebandRecorder::threadMethod);
+}
+
+
+void BasebandRecorder::stop()
+{
+	if (thread_ == NULL) return;
+	
+	{
+		MutexLock lock(&mutex_);
+		stopping_ = true;
+		condition_.signal();
+	}
+	
+	// The thread writes the remaining samples and closes the file.
+	thread_->join();
+	delete thread_;
+	thread_ = NULL;
+}
+
+
+/**
+ * The config values this method expects in \c parent are:
+ * \li \c output_dir
+ * \li \c output_type
+ * \li \c file_format ("wav" or "raw")
+ * \li \c sample_format ("float32" or "int16")
+ * \li \c rotate_time (seconds, 0 = no limit)
+ * \li \c rotate_size (MiB, 0 = no limit)
+ * \li \c buffer_length (seconds of raw history)
+ * \li \c block_size (KiB)
+ */
+Ref<DIObject> BasebandRecorder::make(Ref<DynObject> config, Ref<DIObject> parent)
+{
+	string outputDir    = config->getStrString("output_dir", ".");
+	string outputType   = config->getStrString("output_type", "base");
+	string fileFormat   = config->getStrString("file_format", "wav");
+	string sampleFormat = config->getStrString("sample_format", "float32");
+	
+	int    rotateTime   = config->getStrInt("rotate_time", 600);
+	int    rotateSize   = config->getStrInt("rotate_size", 0);
+	double bufferLength = config->getStrDouble("buffer_length", 10.0);
+	int    blockSize    = config->getStrInt("block_size", 1024);
+	
+	if ((fileFormat != "wav") && (fileFormat != "raw"))
+		LOG_WARNING("Unknown baseband file format \"" << fileFormat << "\", using \"wav\".");
+	if ((sampleFormat != "float32") && (sampleFormat != "int16"))
+		LOG_WARNING("Unknown baseband sample format \"" << sampleFormat << "\", using \"float32\".");
+	
+	return new BasebandRecorder(
+		parent,
+		outputDir,
+		outputType,
+		(fileFormat == "raw") ? FORMAT_RAW : FORMAT_WAV,
+		sampleFormat == "int16",
+		rotateTime,
+		(int64_t)rotateSize * 1024 * 1024,
+		bufferLength,
+		blockSize * 1024
+	);
+}
+
+CPPAPP_DI_METHOD("baseband", BasebandRecorder, make);
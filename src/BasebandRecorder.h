@@ -0,0 +1,124 @@
+/**
+ * \file   BasebandRecorder.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the BasebandRecorder class.
+ */
+
+#ifndef BASEBANDRECORDER_K3TQ9XWM
+#define BASEBANDRECORDER_K3TQ9XWM
+
+
+#include "WaterfallBackend.h"
+
+
+/**
+ * \brief Recorder for \ref WaterfallBackend class that streams the raw I/Q
+ *        input to disk.
+ *
+ * The samples are read from the raw buffer by a dedicated thread, which
+ * sleeps until a block of samples is published (see \ref published).
+ * Samples are interleaved to a page-aligned block buffer, which is written
+ * once full, so the files are written in large aligned blocks.
+ *
+ * The files are WAV files (IEEE float or 16-bit PCM stereo, I in the left
+ * channel) or headerless interleaved I/Q pairs (the float32 format can be
+ * read by the raw TCP frontend). The WAV header is padded by a \c JUNK
+ * chunk to the block size, so the blocks stay aligned in the file. A new
+ * file is started every \c rotateTime seconds (aligned to multiples of
+ * \c rotateTime since the Unix epoch) or after \c rotateSize bytes,
+ * whichever comes first.
+ *
+ * The backend doesn't wait for the recorder. If the recorder falls behind
+ * by more than the raw buffer, the overwritten samples are skipped and
+ * counted. The lag, the lost samples and the block write latency
+ * (\c <prefix>.baseband.write) are reported as backpressure metrics.
+ */
+class BasebandRecorder : public Recorder {
+public:
+	enum FileFormat {
+		FORMAT_WAV,
+		FORMAT_RAW
+	};
+
+private:
+	/**
+	 * Copy constructor.
+	 */
+	BasebandRecorder(const BasebandRecorder& other);
+	
+	typedef MethodThread<void, BasebandRecorder> Thread;
+
+protected:
+	string     outputDir_;
+	string     outputType_;
+	FileFormat fileFormat_;
+	bool       int16_;       ///< Write 16-bit integer samples instead of floats.
+	int        rotateTime_;  ///< Length of one file in seconds, 0 for no limit.
+	int64_t    rotateSize_;  ///< Size of one file in bytes, 0 for no limit.
+	double     bufferLength_; ///< Raw history requested from the backend in seconds.
+	int        blockSize_;   ///< Size of the block buffer in bytes.
+	
+	Thread                *thread_;
+	volatile bool          stopping_;
+	volatile uint64_t      waitingFor_; ///< Raw position the thread waits to be published, \ref NOT_WAITING if none.
+	static const uint64_t  NOT_WAITING = ~(uint64_t)0;
+	Mutex                  mutex_;
+	Condition              condition_;
+	
+	IQBuffer::Cursor cursor_;   ///< Next sample to be written.
+	uint8_t         *block_;    ///< Page-aligned block buffer.
+	int              blockUsed_; ///< Bytes of \ref block_ filled.
+	
+	int      fd_;
+	string   fileName_;
+	int64_t  fileBytes_;       ///< Bytes of samples in the current file.
+	uint64_t fileSamplesLeft_; ///< Samples until the current file is rotated.
+	
+	LatencyHistogram writeLatency_; ///< Time spent writing a block.
+	uint64_t         maxLag_;       ///< Maximal number of published samples not yet written.
+	uint64_t         lostSamples_;  ///< Samples overwritten before they could be written.
+	
+	int  getSampleSize() const { return int16_ ? 2 * sizeof(int16_t) : 2 * sizeof(float); }
+	int  getHeaderSize() const { return (fileFormat_ == FORMAT_WAV) ? blockSize_ : 0; }
+	WFTime positionToTime(uint64_t position);
+	
+	bool writeAll(const void *data, size_t size);
+	void writeWAVHeader(int64_t dataBytes);
+	void openFile();
+	void closeFile();
+	void flushBlock();
+	
+	void waitFor(uint64_t position);
+	void drain();
+	void dump();
+	
+	void* threadMethod();
+
+public:
+	BasebandRecorder(Ref<WaterfallBackend> backend,
+				  string                outputDir,
+				  string                outputType,
+				  FileFormat            fileFormat,
+				  bool                  int16,
+				  int                   rotateTime,
+				  int64_t               rotateSize,
+				  double                bufferLength,
+				  int                   blockSize);
+	virtual ~BasebandRecorder();
+	
+	virtual int requestRawBufferSize();
+	
+	virtual string getLatencyName() { return "baseband"; }
+	
+	virtual void start();
+	virtual void stop();
+	virtual void update() {}
+	virtual void published(Cursor head);
+	
+	static Ref<DIObject> make(Ref<DynObject> config, Ref<DIObject> parent);
+};
+
+
+#endif /* end of include guard: BASEBANDRECORDER_K3TQ9XWM */
@@ -10,6 +10,8 @@
 #include "BolidRecorder.h"
 #include "utils.h"
 
+#include <algorithm>
+
 
 #define METADATA_ENTRY(entry) {                                                          \
 	WFTime t = WFTime::now();                                                           \
@@ -43,7 +45,7 @@ float BolidRecorder::average(float fromFq, float toFq)
 	int hiBin  = backend_->frequencyToBin(toFq);
 	ORDER_PAIR(lowBin, hiBin);
 	
-	float *row = buffer_->at(buffer_->mark());
+	float *row = getRow(buffer_->mark(), lowBin, hiBin, rowBuffer_);
 	int    width = hiBin - lowBin;
 	
 	return average(row + lowBin, width);
@@ -103,6 +105,12 @@ void BolidRecorder::start()
 	noiseMetadataRows_ = backend_->timeToFFTSamples(noiseMetadataTime_);
 	CPPAPP_ASSERT(averageBinRange_ > 0);
 	
+	// Range of bins read by update(), decoded if the rows are not
+	// stored as floats.
+	decodeFrom_ = max(0, min(lowNoiseBin_, lowDetectBin_ - averageBinRange_));
+	decodeTo_   = min(backend_->getBins(),
+				   max(lowNoiseBin_ + noiseWidth_, lowDetectBin_ + detectWidth_ + averageBinRange_));
+	
 	lastNoiseMetadataEntry_ = 
 	
 	state_ = STATE_INIT;
@@ -118,7 +126,7 @@ void BolidRecorder::start()
 
 void BolidRecorder::update()
 {
-	float *row = buffer_->at(buffer_->mark() - 1);
+	float *row = getRow(buffer_->mark() - 1, decodeFrom_, decodeTo_, rowBuffer_);
 	
 	memcpy(&(noiseBuffer_[0]), row + lowNoiseBin_, sizeof(float) * noiseWidth_);
 	float n = noise(&(noiseBuffer_[0]), noiseWidth_);
@@ -175,9 +183,9 @@ void BolidRecorder::update()
 			noise_ = n;
 			magnitude_ = a;
 			duration_ = 1;
-			nextSnapshot_.start = buffer_->mark() - advance_;
+			nextSnapshot_.start = buffer_->cursor(advance_);
 			nextSnapshot_.length = 2 * advance_;
-			nextSnapshot_.fileName = getFileName(nextSnapshot_.start);
+			nextSnapshot_.time = getTime(nextSnapshot_.start);
 			state_ = STATE_BOLID;
 		}
 		break;
@@ -220,45 +228,36 @@ void BolidRecorder::update()
 				//	<< magnitude_ << ";"
 				//	<< duration
 				//	);
-				WFTime t = WFTime::now();
-				
-				CSV_LOG_ENTRY(
-					backend_->getMetadataFile(),
-					//metadataFile_,
-					t,
-					Path::basename(nextSnapshot_.fileName) << ";"
-					<< noise_ << ";"
-					<< peakFreq_ << ";"
-					<< magnitude_ << ";"
-					<< duration
-				);
-				
-				sendMessage(BolidMessage(
-					t,
-					noise_,
-					peakFreq_,
-					magnitude_,
+				// Nothing is logged or sent in the dry-run mode.
+				if (!backend_->isDryRun()) {
+					WFTime t = WFTime::now();
+					
+					// The message is sent right away, because the MIDI
+					// marker of the JACK frontend is placed relative to
+					// the current sample. Its listeners may allocate.
+					sendMessage(BolidMessage(
+						t,
+						noise_,
+						peakFreq_,
+						magnitude_,
+					
+						peakFreq_ - (maxDetectFq_ - minDetectFq_) / 4,
+						peakFreq_ + (maxDetectFq_ - minDetectFq_) / 4,
+						//nextSnapshot_.start,
+						//nextSnapshot_.start + nextSnapshot_.length,
+						0,
+						fftSamplesToRaw(nextSnapshot_.length)
+					));
 					
-					peakFreq_ - (maxDetectFq_ - minDetectFq_) / 4,
-					peakFreq_ + (maxDetectFq_ - minDetectFq_) / 4,
-					//nextSnapshot_.start,
-					//nextSnapshot_.start + nextSnapshot_.length,
-					0,
-					fftSamplesToRaw(nextSnapshot_.length)
-				));
-				
-				cout << "met;" << t << ";"
-					<< noise_ << ";"
-					<< peakFreq_ << ";"
-					<< magnitude_ << ";"
-					<< peakFreq_ - (maxDetectFq_ - minDetectFq_) / 4 << ";"
-					<< peakFreq_ + (maxDetectFq_ - minDetectFq_) / 4 << ";"
-					<< duration << ";"
-					<< fftSamplesToRaw(nextSnapshot_.length) << "#" <<endl;
-				
-				LOG_WARNING("************** METEOR DETECTED **************");
-				LOG_INFO("Duration: " << duration << "s" <<
-					    "  |  Frequency: " << peakFreq_ << "Hz");
+					// The rest is reported by the writer thread (see
+					// reportEvent).
+					nextSnapshot_.hasEvent            = true;
+					nextSnapshot_.event.time          = t;
+					nextSnapshot_.event.noise         = noise_;
+					nextSnapshot_.event.peakFrequency = peakFreq_;
+					nextSnapshot_.event.magnitude     = magnitude_;
+					nextSnapshot_.event.duration      = duration;
+				}
 				nextSnapshot_.includeRawData = true;
 				startWriting();
 				state_ = STATE_INIT;
@@ -299,21 +298,49 @@ void BolidRecorder::update()
 }
 
 
-int compareFloat(const void *a, const void *b)
+/**
+ * Writes the metadata entry of the meteor and logs it.
+ */
+void BolidRecorder::reportEvent(const Snapshot &snapshot)
 {
-	float c = ( *(float*)a - *(float*)b );
-	if (c > 0.0)
-		return 1;
-	if (c < 0.0)
-		return -1;
-	return 0;
+	const Event &event = snapshot.event;
+	float minFreq = event.peakFrequency - (maxDetectFq_ - minDetectFq_) / 4;
+	float maxFreq = event.peakFrequency + (maxDetectFq_ - minDetectFq_) / 4;
+	
+	CSV_LOG_ENTRY(
+		backend_->getMetadataFile(),
+		event.time,
+		Path::basename(getFileName(snapshot.time)) << ";"
+		<< event.noise << ";"
+		<< event.peakFrequency << ";"
+		<< event.magnitude << ";"
+		<< event.duration
+	);
+	
+	cout << "met;" << event.time << ";"
+		<< event.noise << ";"
+		<< event.peakFrequency << ";"
+		<< event.magnitude << ";"
+		<< minFreq << ";"
+		<< maxFreq << ";"
+		<< event.duration << ";"
+		<< fftSamplesToRaw(snapshot.length) << "#" <<endl;
+	
+	LOG_WARNING("************** METEOR DETECTED **************");
+	LOG_INFO("Duration: " << event.duration << "s" <<
+		    "  |  Frequency: " << event.peakFrequency << "Hz");
 }
 
 
+/**
+ * Only the lower quartile of \c buffer is needed, so it is selected in
+ * linear time instead of sorting the whole buffer. The items of \c buffer
+ * are reordered.
+ */
 float BolidRecorder::noise(float *buffer, int length)
 {
-	qsort(buffer, length, sizeof(float), compareFloat);
 	int quartile = length / 4;
+	nth_element(buffer, buffer + quartile, buffer + length);
 	return buffer[quartile] * 2.0; // * 2 == 3dB
 	//return log10(buffer[quartile] * 2.0); // * 2 == 3dB
 	//return log10(buffer[quartile]) + 3.0; // * 2 == 3dB
@@ -356,6 +383,11 @@ float BolidRecorder::average(float *buffer, int length)
  * \li \c hi_detect_freq
  * \li \c low_noise_freq
  * \li \c hi_noise_freq
+ * \li \c raw_planar
+ * \li \c raw_int16
+ *
+ * See \ref SnapshotRecorder::readCompression for the compression parameters
+ * and \ref SnapshotRecorder::readQuicklook for the quicklook parameters.
  */
 Ref<DIObject> BolidRecorder::make(Ref<DynObject> config, Ref<DIObject> parent)
 {
@@ -408,6 +440,11 @@ Ref<DIObject> BolidRecorder::make(Ref<DynObject> config, Ref<DIObject> parent)
 		//metadataPath
 	);
 	
+	result->setRawPlanar(config->getStrBool("raw_planar", false));
+	result->setRawInt16(config->getStrBool("raw_int16", false));
+	result->setCompression(readCompression(config));
+	result->setQuicklook(readQuicklook(config));
+	
 	return result;
 }
 
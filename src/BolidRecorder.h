@@ -103,6 +103,9 @@ protected:
 	//bool  bolidRecord_;
 	
 	vector<float> noiseBuffer_;
+	vector<float> rowBuffer_;  ///< decoded FFT row (if the rows are not stored as floats)
+	int           decodeFrom_; ///< first bin used by the detection
+	int           decodeTo_;   ///< bin after the last bin used by the detection
 
 	int lastNoiseMetadataEntry_; ///< Mark into the FFT buffer.
 
@@ -114,6 +117,8 @@ protected:
 	///@}
 	
 	float average(float fromFq, float toFq);
+	
+	virtual void reportEvent(const Snapshot &snapshot);
 
 public:
 	/**
@@ -193,6 +198,10 @@ public:
 	virtual void start();
 	virtual void update();
 	
+	/**
+	 * @brief Returns the noise level (twice the lower quartile) of a float
+	 *        buffer.
+	 */
 	static float noise(float *buffer, int length);
 	/**
 	 * @brief Returns the index of a maximal value in a float buffer.
@@ -0,0 +1,134 @@
+/**
+ * \file   CapacityPlanner.cpp
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Implementation file for the CapacityPlanner class.
+ */
+
+#include "CapacityPlanner.h"
+#include "LatencyHistogram.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <unistd.h>
+
+
+#define MIB (1024.0 * 1024.0)
+
+
+void CapacityPlanner::reportMemory(ostream &out)
+{
+	vector<MemoryUsage> usage;
+	backend_->reportMemory(usage);
+	
+	size_t total = 0;
+	
+	out << "Memory:" << endl;
+	FOR_EACH(usage, it) {
+		out << "  " << left << setw(28) << it->name <<
+			right << setw(10) << fixed << setprecision(1) << (double)it->bytes / MIB << " MiB";
+		if (!it->detail.empty())
+			out << "  (" << it->detail << ")";
+		out << endl;
+		
+		total += it->bytes;
+	}
+	
+	double ram = (double)sysconf(_SC_PHYS_PAGES) * (double)sysconf(_SC_PAGESIZE);
+	out << "  " << left << setw(28) << "total" <<
+		right << setw(10) << (double)total / MIB << " MiB" <<
+		"  (" << 100.0 * (double)total / ram << " % of " << ram / MIB << " MiB RAM)" << endl;
+	
+	if ((double)total > ram)
+		out << "WARNING: The buffers don't fit in RAM, consider file-backed history (history_dir)." << endl;
+}
+
+
+void CapacityPlanner::calibrate(ostream &out)
+{
+	// A few blocks of white noise are generated in advance and passed to
+	// the backend repeatedly, so that generating the noise isn't measured.
+	const int    blockCount = 16;
+	const double amplitude  = 0.1;
+	
+	vector<vector<Complex> > blocks(blockCount, vector<Complex>(blockSize_));
+	srand(1);
+	FOR_EACH(blocks, block) {
+		FOR_EACH(*block, sample) {
+			// Box-Muller transform
+			double u1 = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+			double u2 = (double)rand() / (double)RAND_MAX;
+			double r  = amplitude * sqrt(-2.0 * log(u1));
+			sample->real = r * cos(2.0 * M_PI * u2);
+			sample->imag = r * sin(2.0 * M_PI * u2);
+		}
+	}
+	
+	StreamInfo streamInfo = backend_->getStreamInfo();
+	DataInfo   info;
+	info.timeOffset = streamInfo.timeOffset;
+	
+	SampleCount sampleCount = (SampleCount)(calibrationLength_ * (float)sampleRate_);
+	
+	LatencyHistogram::clearAll();
+	uint64_t start = LatencyHistogram::now();
+	
+	for (int i = 0; info.offset < sampleCount; i++) {
+		backend_->process(blocks[i % blockCount], info);
+		
+		info.offset    += blockSize_;
+		info.timeOffset = streamInfo.timeOffset.addSamples(info.offset, sampleRate_);
+	}
+	
+	double elapsed = (double)(LatencyHistogram::now() - start) / 1e9;
+	double signal  = (double)info.offset / (double)sampleRate_;
+	
+	out << "CPU time (" << signal << " s of noise in blocks of " << blockSize_ << " samples):" << endl;
+	vector<LatencyHistogram*> histograms = LatencyHistogram::getAll();
+	FOR_EACH(histograms, it) {
+		LatencyHistogram *h = *it;
+		out << "  " << left << setw(28) << h->getName() <<
+			right << setw(8) << setprecision(2) << 100.0 * ((double)h->getTotal() / 1e9) / signal << " %" <<
+			"  (" << h->getCount() << " calls, mean " <<
+			setprecision(1) << (double)h->getTotal() / (double)h->getCount() / 1000.0 << " us, p99 " <<
+			(double)h->percentile(0.99) / 1000.0 << " us)" << endl;
+	}
+	out << "  " << left << setw(28) << "total" <<
+		right << setw(8) << setprecision(2) << 100.0 * elapsed / signal << " %" <<
+		"  of one core in real time" << endl;
+	
+	if (elapsed > signal)
+		out << "WARNING: The configuration can't be processed in real time on this machine." << endl;
+	
+	LatencyHistogram::clearAll();
+}
+
+
+bool CapacityPlanner::run(ostream &out)
+{
+	StreamInfo info;
+	info.sampleRate = sampleRate_;
+	info.timeOffset = WFTime::now();
+	
+	out << "Dry run at " << sampleRate_ << " Hz." << endl;
+	
+	backend_->setDryRun(true);
+	
+	try {
+		backend_->startStream(info);
+	} catch (std::bad_alloc&) {
+		out << "ERROR: Failed to allocate the buffers of the configuration." << endl;
+		return false;
+	}
+	
+	reportMemory(out);
+	calibrate(out);
+	
+	backend_->endStream();
+	backend_->setDryRun(false);
+	
+	return true;
+}
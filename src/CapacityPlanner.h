@@ -0,0 +1,67 @@
+/**
+ * \file   CapacityPlanner.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the CapacityPlanner class.
+ */
+
+#ifndef CAPACITYPLANNER_H4QZ9MEC
+#define CAPACITYPLANNER_H4QZ9MEC
+
+
+#include <iostream>
+using namespace std;
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include "Backend.h"
+
+
+/**
+ * \brief Reports memory and CPU requirements of a configured backend without a frontend.
+ *
+ * The planner starts a stream of the backend in the dry-run mode (see
+ * \ref Backend::setDryRun) with the given sample rate, so that all the
+ * buffers are allocated exactly as they would be by a real frontend, and
+ * reports the memory used by every buffer. Then it feeds the backend with
+ * a few seconds of synthetic noise and reports the CPU time spent in every
+ * processing stage (see \ref LatencyHistogram) relative to the real time.
+ *
+ * The buffers are allocated with the configured allocation policy, so
+ * populated or locked buffers really take the memory during the dry run.
+ */
+class CapacityPlanner {
+private:
+	Ref<Backend> backend_;
+	int          sampleRate_;        ///< sample rate of the planned stream in Hz
+	float        calibrationLength_; ///< length of the synthetic signal in seconds
+	int          blockSize_;         ///< number of samples passed to the backend at a time
+	
+	CapacityPlanner(const CapacityPlanner& other);
+	
+	void reportMemory(ostream &out);
+	void calibrate(ostream &out);
+
+public:
+	CapacityPlanner(Ref<Backend> backend,
+				 int          sampleRate,
+				 float        calibrationLength,
+				 int          blockSize) :
+		backend_(backend),
+		sampleRate_(sampleRate),
+		calibrationLength_(calibrationLength),
+		blockSize_(blockSize)
+	{}
+	
+	/**
+	 * \brief Runs the dry run and writes the report to \c out.
+	 *
+	 * \returns \c true on success, \c false if the buffers could not be allocated
+	 */
+	bool run(ostream &out);
+};
+
+
+#endif /* end of include guard: CAPACITYPLANNER_H4QZ9MEC */
@@ -32,6 +32,7 @@ private:
 	
 	int       waiting_;
 	bool      closing_;
+	bool      woken_;   ///< \ref wake was called since the last \ref drain
 	
 	/**
 	 * Copy constructor.
@@ -43,7 +44,7 @@ public:
 	 * Constructor.
 	 */
 	Channel() :
-		waiting_(0), closing_(false)
+		waiting_(0), closing_(false), woken_(false)
 	{}
 	
 	///**
@@ -51,6 +52,18 @@ public:
 	// */
 	//virtual ~Channel() {}
 	
+	/**
+	 * \brief Preallocates the queue for \c count values.
+	 *
+	 * Sending doesn't allocate as long as the queue holds at most
+	 * \c count values (and the values don't allocate when copied).
+	 */
+	void reserve(int count)
+	{
+		MutexLock lock(&mutex_);
+		buffer_.reserve(count);
+	}
+	
 	void send(T value)
 	{
 		MutexLock lock(&mutex_);
@@ -83,14 +96,15 @@ public:
 		MutexLock lock(&mutex_);
 		
 		// Keep waiting on a signal until there are some
-		// elements in the buffer.
-		while (buffer_.empty()) {
+		// elements in the buffer or the receiver is woken up.
+		while (buffer_.empty() && !woken_) {
 			if (closing_) return false;
 			
 			waiting_++;
 			condition_.wait(mutex_);
 			waiting_--;
 		}
+		woken_ = false;
 		
 		// Finally, copy the contents of the buffer to
 		// the receiving container and return.
@@ -99,6 +113,17 @@ public:
 		return !closing_;
 	}
 	
+	/**
+	 * \brief Makes the pending (or the next) \ref drain return even if nothing was sent.
+	 */
+	void wake()
+	{
+		MutexLock lock(&mutex_);
+		
+		woken_ = true;
+		condition_.signal();
+	}
+	
 	void close()
 	{
 		closing_ = true;
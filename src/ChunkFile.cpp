@@ -0,0 +1,213 @@
+/**
+ * \file   ChunkFile.cpp
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Implementation file for the ChunkFileWriter class.
+ */
+
+#include "ChunkFile.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+
+static inline uint8_t* putDouble(uint8_t *dest, double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return putLE(dest, bits);
+}
+
+
+static inline uint8_t* putFloat(uint8_t *dest, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return putLE(dest, bits);
+}
+
+
+static inline uint8_t* putBytes(uint8_t *dest, const char *data, size_t size)
+{
+	memcpy(dest, data, size);
+	return dest + size;
+}
+
+
+ChunkFileWriter::ChunkFileWriter() :
+	fd_(-1),
+	compression_(CHUNK_RAW), level_(1),
+	offset_(0),
+	rows_(0), time_(0)
+{
+}
+
+
+ChunkFileWriter::~ChunkFileWriter()
+{
+	close();
+}
+
+
+bool ChunkFileWriter::parseCodec(const string &name, ChunkCodec *codec)
+{
+	if (name == "none") {
+		*codec = CHUNK_RAW;
+	} else if (name == "zlib") {
+		*codec = CHUNK_ZLIB;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+
+bool ChunkFileWriter::writeAll(const uint8_t *data, size_t size)
+{
+	while (size > 0) {
+		ssize_t written = ::write(fd_, data, size);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			
+			LOG_ERROR("Failed to write to \"" << fileName_ << "\": " << strerror(errno) << ".");
+			return false;
+		}
+		
+		data    += written;
+		size    -= written;
+		offset_ += written;
+	}
+	return true;
+}
+
+
+bool ChunkFileWriter::open(const string &fileName, const RowCodec &codec, double rowRate, const string &origin)
+{
+	close();
+	
+	fd_ = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd_ < 0) {
+		LOG_ERROR("Failed to create \"" << fileName << "\": " << strerror(errno) << ".");
+		return false;
+	}
+	
+	fileName_ = fileName;
+	codec_    = codec;
+	offset_   = 0;
+	index_.clear();
+	
+	uint8_t  header[CHUNK_FILE_HEADER_SIZE];
+	uint8_t *p = header;
+	
+	memset(header, 0, sizeof(header));
+	p = putBytes(p, CHUNK_FILE_MAGIC, 8);
+	p = putLE(p, (uint32_t)CHUNK_FILE_VERSION);
+	p = putLE(p, (uint32_t)CHUNK_FILE_HEADER_SIZE);
+	p = putLE(p, (uint32_t)codec.getFormat());
+	p = putLE(p, (uint32_t)codec.getWidth());
+	p = putDouble(p, rowRate);
+	putBytes(p, origin.c_str(), min(origin.size(), (size_t)31));
+	
+	return writeAll(header, sizeof(header));
+}
+
+
+void ChunkFileWriter::close()
+{
+	if (fd_ < 0) return;
+	
+	// Index: magic, count and one entry of 24 bytes per chunk; trailer:
+	// offset of the index and magic.
+	uint64_t indexOffset = offset_;
+	
+	vector<uint8_t> index(8 + 24 * index_.size() + 16);
+	uint8_t *p = &(index[0]);
+	p = putBytes(p, CHUNK_INDEX_MAGIC, 4);
+	p = putLE(p, (uint32_t)index_.size());
+	FOR_EACH(index_, entry) {
+		p = putLE(p, entry->offset);
+		p = putLE(p, entry->time);
+		p = putLE(p, entry->rows);
+		p = putLE(p, (uint32_t)0);
+	}
+	p = putLE(p, indexOffset);
+	putBytes(p, CHUNK_END_MAGIC, 8);
+	
+	writeAll(&(index[0]), index.size());
+	
+	::close(fd_);
+	fd_ = -1;
+}
+
+
+void ChunkFileWriter::beginChunk(int rows, WFTime time, double leftFrequency, double binWidth)
+{
+	rows_ = rows;
+	
+	size_t payload = (size_t)rows * getRowSize();
+	if (codec_.isLog())
+		payload += (size_t)rows * 2 * sizeof(float);
+	
+	chunk_.resize(CHUNK_HEADER_SIZE + payload);
+	
+	time_ = (int64_t)time.seconds() * 1000000 + (int64_t)time.microseconds();
+	
+	// The codec and the stored size are filled in by endChunk().
+	uint8_t *p = &(chunk_[0]);
+	p = putBytes(p, CHUNK_MAGIC, 4);
+	p = putLE(p, (uint32_t)CHUNK_RAW);
+	p = putLE(p, (uint32_t)rows);
+	p = putLE(p, (uint32_t)0);
+	p = putLE(p, time_);
+	p = putDouble(p, leftFrequency);
+	p = putDouble(p, binWidth);
+	p = putLE(p, (uint64_t)payload);
+	putLE(p, (uint64_t)payload);
+}
+
+
+void ChunkFileWriter::setScale(int index, const RowScale &scale)
+{
+	uint8_t *p = &(chunk_[CHUNK_HEADER_SIZE]) + rows_ * getRowSize() + index * 2 * sizeof(float);
+	p = putFloat(p, scale.offset);
+	putFloat(p, scale.step);
+}
+
+
+bool ChunkFileWriter::endChunk()
+{
+	if (fd_ < 0) return false;
+	
+	IndexEntry entry;
+	entry.offset = offset_;
+	entry.time   = time_;
+	entry.rows   = rows_;
+	index_.push_back(entry);
+	
+	size_t payload = chunk_.size() - CHUNK_HEADER_SIZE;
+	
+	if (compression_ == CHUNK_ZLIB) {
+		uLongf size = compressBound(payload);
+		if (compressed_.size() < CHUNK_HEADER_SIZE + size)
+			compressed_.resize(CHUNK_HEADER_SIZE + size);
+		
+		int result = compress2(&(compressed_[CHUNK_HEADER_SIZE]), &size,
+						   &(chunk_[CHUNK_HEADER_SIZE]), payload, level_);
+		
+		// Chunks which don't get smaller are stored as they are.
+		if ((result == Z_OK) && (size < payload)) {
+			memcpy(&(compressed_[0]), &(chunk_[0]), CHUNK_HEADER_SIZE);
+			putLE(&(compressed_[4]), (uint32_t)CHUNK_ZLIB);
+			putLE(&(compressed_[48]), (uint64_t)size);
+			return writeAll(&(compressed_[0]), CHUNK_HEADER_SIZE + size);
+		}
+	}
+	
+	return writeAll(&(chunk_[0]), chunk_.size());
+}
@@ -0,0 +1,175 @@
+/**
+ * \file   ChunkFile.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the ChunkFileWriter class.
+ */
+
+#ifndef CHUNKFILE_H4WQ8ZRD
+#define CHUNKFILE_H4WQ8ZRD
+
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "RowCodec.h"
+#include "WFTime.h"
+
+
+/**
+ * \name Chunked Waterfall Format
+ *
+ * A chunked waterfall file (\c .wfc) consists of:
+ *
+ * \li a file header of \ref CHUNK_FILE_HEADER_SIZE bytes: magic
+ *     \ref CHUNK_FILE_MAGIC, \c uint32 version, \c uint32 header size,
+ *     \c uint32 row format (\ref RowFormat), \c uint32 row width in bins,
+ *     \c double FFT rows per second and the origin (32 bytes, zero
+ *     padded), the rest is reserved,
+ * \li chunks, each with a header of \ref CHUNK_HEADER_SIZE bytes: magic
+ *     \ref CHUNK_MAGIC, \c uint32 codec (\ref ChunkCodec), \c uint32 row
+ *     count, \c uint32 reserved, \c int64 time of the first row in
+ *     microseconds since the Unix epoch, \c double frequency of the first
+ *     bin in Hz, \c double bin width in Hz, \c uint64 size of the decoded
+ *     payload and \c uint64 size of the stored payload in bytes,
+ *     followed by the payload: the encoded samples of the rows (row
+ *     after row) and, for the log formats, \c float offset and step of
+ *     every row (see \ref RowScale),
+ * \li the index: magic \ref CHUNK_INDEX_MAGIC, \c uint32 chunk count and
+ *     for every chunk \c uint64 file offset, \c int64 time and \c uint32
+ *     row count, \c uint32 reserved,
+ * \li the trailer: \c uint64 offset of the index and magic
+ *     \ref CHUNK_END_MAGIC.
+ *
+ * All numbers are little endian. The index and the trailer are written
+ * when the file is closed. Files without them (e.g. after a crash) can be
+ * read by walking the chunk headers.
+ */
+///@{
+#define CHUNK_FILE_MAGIC       "RADIOWFC"
+#define CHUNK_FILE_VERSION     1
+#define CHUNK_FILE_HEADER_SIZE 128
+#define CHUNK_MAGIC            "CHNK"
+#define CHUNK_HEADER_SIZE      56
+#define CHUNK_INDEX_MAGIC      "INDX"
+#define CHUNK_END_MAGIC        "WFCTRAIL"
+///@}
+
+
+/**
+ * \brief Compression of chunk payloads.
+ */
+enum ChunkCodec {
+	CHUNK_RAW  = 0, ///< Payload stored as is.
+	CHUNK_ZLIB = 1  ///< Payload compressed by zlib (deflate).
+};
+
+
+/**
+ * \brief Writes FFT rows to an append-only chunked waterfall file.
+ *
+ * A chunk is assembled in memory (\ref beginChunk, \ref getRow,
+ * \ref setScale) and written by a single large sequential write in
+ * \ref endChunk. A chunk whose compressed payload isn't smaller is stored
+ * uncompressed.
+ */
+class ChunkFileWriter {
+private:
+	struct IndexEntry {
+		uint64_t offset;
+		int64_t  time;
+		uint32_t rows;
+	};
+	
+	int       fd_;
+	string    fileName_;
+	RowCodec  codec_;
+	
+	ChunkCodec compression_;
+	int        level_;
+	
+	uint64_t  offset_; ///< Size of the file written so far.
+	
+	int              rows_;       ///< Rows of the chunk being assembled.
+	int64_t          time_;       ///< Time of the chunk being assembled in microseconds.
+	vector<uint8_t>  chunk_;      ///< Header and payload of the chunk being assembled.
+	vector<uint8_t>  compressed_;
+	vector<IndexEntry> index_;
+	
+	ChunkFileWriter(const ChunkFileWriter& other);
+	
+	bool writeAll(const uint8_t *data, size_t size);
+	
+	inline int getRowSize() const { return codec_.getWidth() * codec_.getSampleSize(); }
+
+public:
+	ChunkFileWriter();
+	~ChunkFileWriter();
+	
+	/**
+	 * \brief Sets compression of the chunks.
+	 *
+	 * \param compression codec of the chunk payloads
+	 * \param level       compression level (1 is the fastest)
+	 */
+	void setCompression(ChunkCodec compression, int level = 1)
+	{
+		compression_ = compression;
+		level_       = level;
+	}
+	
+	/**
+	 * \brief Parses a codec name ("none" or "zlib").
+	 *
+	 * \returns \c false if the name is unknown
+	 */
+	static bool parseCodec(const string &name, ChunkCodec *codec);
+	
+	/**
+	 * \brief Creates the file and writes the file header.
+	 *
+	 * \param fileName name of the created file
+	 * \param codec    format and width of the rows (see \ref RowCodec)
+	 * \param rowRate  FFT rows per second
+	 * \param origin   name of the station
+	 */
+	bool open(const string &fileName, const RowCodec &codec, double rowRate, const string &origin);
+	bool isOpen() const { return fd_ >= 0; }
+	/**
+	 * \brief Writes the index and the trailer and closes the file.
+	 */
+	void close();
+	
+	const string& getFileName() const { return fileName_; }
+	
+	/**
+	 * \brief Starts assembling a chunk of \c rows rows.
+	 *
+	 * \param time          time of the first row
+	 * \param leftFrequency frequency of the first bin in Hz
+	 * \param binWidth      frequency difference of two bins in Hz
+	 */
+	void beginChunk(int rows, WFTime time, double leftFrequency, double binWidth);
+	
+	/**
+	 * \brief Returns the samples of the \c index-th row of the chunk.
+	 */
+	uint8_t* getRow(int index) { return &(chunk_[CHUNK_HEADER_SIZE]) + index * getRowSize(); }
+	
+	/**
+	 * \brief Sets the scale of the \c index-th row of the chunk (log formats only).
+	 */
+	void setScale(int index, const RowScale &scale);
+	
+	/**
+	 * \brief Compresses and writes the assembled chunk.
+	 */
+	bool endChunk();
+};
+
+
+#endif /* end of include guard: CHUNKFILE_H4WQ8ZRD */
+
@@ -0,0 +1,130 @@
+/**
+ * \file   ChunkRecorder.cpp
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Implementation file for the ChunkRecorder class.
+ */
+
+#include "ChunkRecorder.h"
+
+
+/**
+ * Starts a new file if none is open or if \c time is past the end of the
+ * current one.
+ *
+ * \param time    time of the first row of the chunk to be written
+ * \param codec   format and width of the rows of the file
+ * \param rowRate number of rows per second
+ * \returns \c false if the file could not be opened
+ */
+bool ChunkRecorder::prepareFile(WFTime time, const RowCodec &codec, double rowRate)
+{
+	if (writer_.isOpen() && (time.seconds() < fileEnd_))
+		return true;
+	
+	writer_.close();
+	
+	string fileName = getFileName(outputType_.c_str(), "wfc", time);
+	LOG_INFO("Writing chunked waterfall \"" << fileName << "\"...");
+	
+	if (!writer_.open(fileName, codec, rowRate, backend_->getOrigin()))
+		return false;
+	
+	fileEnd_ = (time.seconds() / fileLength_ + 1) * fileLength_;
+	return true;
+}
+
+
+/**
+ * Called by \ref SnapshotWriterPool threads, one snapshot of this
+ * recorder at a time.
+ */
+void ChunkRecorder::write(Snapshot snapshot)
+{
+	int    start  = buffer_->mark(snapshot.start);
+	int    length = snapshot.length;
+	WFTime time   = snapshot.time;
+	int    width  = rightBin_ - leftBin_;
+	
+	if (!prepareFile(time, RowCodec(rowCodec_->getFormat(), width), backend_->getFFTSampleRate()))
+		return;
+	
+	writer_.beginChunk(length, time, leftFrequency_, backend_->binToFrequency());
+	
+	// The range of columns of every row is copied to the chunk, which is
+	// then written at once.
+	int rowSize    = buffer_->getWidth();
+	int sampleSize = rowCodec_->getSampleSize();
+	
+	int rowIndex = start;
+	for (int y = 0; y < length; ) {
+		int      rows;
+		uint8_t *data = buffer_->span(rowIndex, length - y, &rows);
+		
+		for (int i = 0; i < rows; i++) {
+			const uint8_t *row = data + i * rowSize;
+			
+			memcpy(writer_.getRow(y + i),
+				  rowCodec_->getSamples(row) + leftBin_ * sampleSize,
+				  width * sampleSize);
+			if (rowCodec_->isLog())
+				writer_.setScale(y + i, rowCodec_->getScale(row));
+		}
+		
+		y        += rows;
+		rowIndex += rows;
+	}
+	
+	writer_.endChunk();
+}
+
+
+void ChunkRecorder::stop()
+{
+	// Writes the last chunk.
+	SnapshotRecorder::stop();
+	
+	writer_.close();
+}
+
+
+/**
+ * The config values this method expects in \c parent are:
+ * \li \c output_dir
+ * \li \c output_type
+ * \li \c chunk_length (seconds)
+ * \li \c file_length (seconds)
+ * \li \c chunk_compression ("none" or "zlib")
+ * \li \c low_freq
+ * \li \c hi_freq
+ */
+Ref<DIObject> ChunkRecorder::make(Ref<DynObject> config, Ref<DIObject> parent)
+{
+	string outputDir   = config->getStrString("output_dir", ".");
+	string outputType  = config->getStrString("output_type", "wfall");
+	
+	int    chunkLength = config->getStrInt("chunk_length", 10);
+	int    fileLength  = config->getStrInt("file_length", 3600);
+	string codecName   = config->getStrString("chunk_compression", "zlib");
+	
+	float  leftFrequency  = config->getStrDouble("low_freq", 0);
+	float  rightFrequency = config->getStrDouble("hi_freq",  0);
+	
+	ChunkCodec codec = CHUNK_ZLIB;
+	if (!ChunkFileWriter::parseCodec(codecName, &codec))
+		LOG_WARNING("Unknown chunk compression \"" << codecName << "\", using \"zlib\".");
+	
+	return new ChunkRecorder(
+		parent,
+		chunkLength,
+		max(fileLength, 1),
+		leftFrequency,
+		rightFrequency,
+		outputDir,
+		outputType,
+		codec
+	);
+}
+
+CPPAPP_DI_METHOD("chunked", ChunkRecorder, make);
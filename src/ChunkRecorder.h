@@ -0,0 +1,67 @@
+/**
+ * \file   ChunkRecorder.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the ChunkRecorder class.
+ */
+
+#ifndef CHUNKRECORDER_R6JX3NWE
+#define CHUNKRECORDER_R6JX3NWE
+
+
+#include "WaterfallBackend.h"
+#include "ChunkFile.h"
+
+
+/**
+ * \brief Recorder for \ref WaterfallBackend class that records the waterfall
+ *        continuously to chunked waterfall files (see \ref ChunkFileWriter).
+ *
+ * Every snapshot is appended as one chunk of the current file. A new file
+ * is started every \c fileLength seconds (aligned to multiples of
+ * \c fileLength since the Unix epoch). The files can be converted to FITS
+ * by the \c wfc2fits script.
+ */
+class ChunkRecorder : public SnapshotRecorder {
+private:
+	/**
+	 * Copy constructor.
+	 */
+	ChunkRecorder(const ChunkRecorder& other);
+
+protected:
+	int             fileLength_; ///< Length of one file in seconds.
+	time_t          fileEnd_;    ///< Time of the first row of the next file.
+	ChunkFileWriter writer_;
+	
+	bool prepareFile(WFTime time, const RowCodec &codec, double rowRate);
+	
+	virtual void write(Snapshot snapshot);
+
+public:
+	ChunkRecorder(Ref<WaterfallBackend> backend,
+			    int                   chunkLength,
+			    int                   fileLength,
+			    float                 leftFrequency,
+			    float                 rightFrequency,
+			    string                outputDir,
+			    string                outputType,
+			    ChunkCodec            codec) :
+		SnapshotRecorder(backend, chunkLength, leftFrequency, rightFrequency, outputDir, outputType, false, false),
+		fileLength_(fileLength),
+		fileEnd_(0)
+	{
+		writer_.setCompression(codec);
+		// Chunks are short, the processing times and the metrics are
+		// left to the snapshot recorders.
+		reportMetrics_ = false;
+	}
+	
+	virtual void stop();
+	
+	static Ref<DIObject> make(Ref<DynObject> config, Ref<DIObject> parent);
+};
+
+
+#endif /* end of include guard: CHUNKRECORDER_R6JX3NWE */
@@ -11,6 +11,14 @@
 
 Ref<Output> CsvLog::getOutput(WFTime time)
 {
+	// The file name only changes with the (local) hour, so it is only
+	// formatted when a new quarter of an hour starts (time zone offsets
+	// are multiples of 15 minutes).
+	time_t quarter = time.seconds() / 900;
+	if (!output_.isNull() && (quarter == outputQuarter_))
+		return output_;
+	outputQuarter_ = quarter;
+	
 	string fileName = getFileName(time);
 	if (output_.isNull() || fileName != output_->getName()) {
 		bool fileExists = FileInfo::exists(fileName);
@@ -32,7 +40,8 @@ ostream& CsvLog::getStream(WFTime time)
 
 CsvLog::CsvLog(string fileNameFormat, string header) :
 	fileNameFormat_(fileNameFormat),
-	header_(header)
+	header_(header),
+	outputQuarter_(0)
 {
 }
 
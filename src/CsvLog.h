@@ -36,6 +36,7 @@ private:
 	string      header_;
 	
 	Ref<Output> output_;
+	time_t      outputQuarter_; ///< Quarter of an hour of the last entry (see \ref getOutput).
 	Mutex       mutex_;
 	
 	Ref<Output> getOutput(WFTime);
@@ -54,15 +55,40 @@ public:
 	string getFileName(WFTime time);
 	
 	void write(WFTime time, string entry);
+	
+	/**
+	 * \brief Writes one entry straight to the log file (see \ref CSV_LOG_ENTRY).
+	 *
+	 * The log is locked for the lifetime of the object and the entry is
+	 * terminated on destruction, so the entry is not formatted to a
+	 * temporary string first.
+	 */
+	class Entry {
+	private:
+		Ref<CsvLog> log_;
+		MutexLock   lock_;
+		ostream    &stream_;
+		
+		Entry(const Entry& other);
+	
+	public:
+		Entry(Ref<CsvLog> log, WFTime time) :
+			log_(log), lock_(&(log->mutex_)), stream_(log->getStream(time))
+		{}
+		
+		~Entry()
+		{
+			stream_ << std::endl;
+		}
+		
+		ostream& stream() { return stream_; }
+	};
 };
 
 
 #define CSV_LOG_ENTRY(log, time, entry) { \
-	WFTime t__ = (time); \
-	std::stringstream buffer__; \
-	(buffer__ << entry); \
-	buffer__.flush(); \
-	(log)->write(t__, buffer__.str()); \
+	CsvLog::Entry entry__((log), (time)); \
+	(entry__.stream() << entry); \
 }
 
 
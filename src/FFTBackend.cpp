@@ -8,9 +8,11 @@
 
 #include "FFTBackend.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <sstream>
 using namespace std;
 
 #include <cppapp/utils.h>
@@ -35,60 +37,156 @@ void IQGainPhaseCorrection::setPhaseShift(int phaseShift)
 
 
 /**
+ * Delays the Q samples by \ref phaseShift_ samples:
+ *
  * \verbatim
- * section                   |   I    |          II          |  III   |
- * --------------------------+--------+----------------------+--------+
- * inData (I)                |-- 1 ---|---------- 2 ---------|
- * inData (Q)                         |---------- 3 ---------|-- 4 ---|
- * buffer (Q)   |---- 5 -----|-- 6 ---|                      |        |
- * --------------------------------------------------------------------
- * outData (I)               |-- 1 ---|---------- 2 ---------|
- * outData (Q)               |-- 6 ---|---------- 3 ---------|
- * buffer  (Q)                                  |---- 3 -----|-- 4 ---|
- * --------------------------+--------+--------------------------------
- *                           |        |
- *                           phase shift
+ * delayed_     |-- buffer --|----------- inData (Q) -----------|
+ * outData (Q)  |------------- length -------------|
+ * buffer_                                         |-- shift ---|
  * \endverbatim
+ *
+ * Until \ref buffer_ fills up, the missing delayed samples are zero.
  */
 void IQGainPhaseCorrection::process(const Complex *inData,
 							 int            length,
 							 Complex       *outData)
 {
-	// Initialization
-	int remaining = length;
-	int offset    = 0;
+	if ((int)delayed_.size() < phaseShift_ + length)
+		delayed_.resize(phaseShift_ + length);
+	SampleType *q = &(delayed_[0]);
 	
-	// Section I
-	int chunk = phaseShift_;
-	if (remaining < chunk) chunk = remaining;
-	remaining -= chunk;
-	offset    += chunk;
+	int buffered = buffer_.getSize();
+	int missing  = phaseShift_ - buffered;
+	for (int i = 0; i < missing; i++)
+		q[i] = 0;
+	buffer_.peek(q + missing, buffered);
 	
-	int mark = buffer_.head() - phaseShift_;
+	for (int i = 0; i < length; i++)
+		q[phaseShift_ + i] = inData[i].imag;
 	
-	for (int i = 0; i < chunk; i++) {
+	for (int i = 0; i < length; i++) {
 		outData[i].real = inData[i].real;
-		outData[i].imag = buffer_.at(mark + i) + gain_;
+		outData[i].imag = q[i] + gain_;
 	}
 	
-	// Section II
-	chunk = remaining - phaseShift_;
-	if (chunk > 0) {
-		for (int i = 0; i < chunk; i++) {
-			outData[offset + i].real = inData[offset + i].real;
-			outData[offset + i].imag = inData[i].imag + gain_;
-			buffer_.push(inData[i].imag);
+	buffer_.push(q + phaseShift_, length);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ImpulseBlanker
+////////////////////////////////////////////////////////////////////////////////
+
+
+void ImpulseBlanker::reset()
+{
+	averagePower_ = -1.0;
+	hold_         = 0;
+	last_.real    = 0.0;
+	last_.imag    = 0.0;
+	clearCounters();
+}
+
+
+/**
+ * \brief Fills blanked samples from \c start to \c end.
+ *
+ * \param next first unblanked sample after the blanked section or \c NULL if
+ *             it is not known yet
+ */
+void ImpulseBlanker::fill(Complex *data, int start, int end, const Complex *next)
+{
+	int count = end - start;
+	
+	if (!interpolate_) {
+		memset(data + start, 0, count * sizeof(Complex));
+		return;
+	}
+	
+	if (next == NULL) next = &last_;
+	
+	double stepReal = (next->real - last_.real) / (double)(count + 1);
+	double stepImag = (next->imag - last_.imag) / (double)(count + 1);
+	
+	for (int i = 0; i < count; i++) {
+		data[start + i].real = last_.real + stepReal * (double)(i + 1);
+		data[start + i].imag = last_.imag + stepImag * (double)(i + 1);
+	}
+}
+
+
+void ImpulseBlanker::process(Complex *data, int length)
+{
+	if (!isEnabled() || (length < 1)) return;
+	
+	int blockCount = (length + blockSize_ - 1) / blockSize_;
+	if ((int)blockPower_.size() < blockCount)
+		blockPower_.resize(blockCount);
+	
+	// Short-term envelope: mean power of each block. Two samples (four
+	// doubles) at a time with GCC vector extensions, see Quicklook::addRow.
+	typedef double Double4 __attribute__((vector_size(32), aligned(8)));
+	
+	for (int b = 0; b < blockCount; b++) {
+		int start = b * blockSize_;
+		int end   = min(start + blockSize_, length);
+		
+		Double4 sums = { 0.0, 0.0, 0.0, 0.0 };
+		int     i    = start;
+		for (; i + 2 <= end; i += 2) {
+			Double4 v = *(const Double4*)(data + i);
+			sums += v * v;
 		}
-		remaining -= chunk;
-		offset    += chunk;
+		
+		double power = sums[0] + sums[1] + sums[2] + sums[3];
+		for (; i < end; i++)
+			power += data[i].real * data[i].real + data[i].imag * data[i].imag;
+		blockPower_[b] = power / (double)(end - start);
 	}
 	
-	// Section III
-	if (remaining > 0) {
-		for (int i = 0; i < remaining; i++) {
-			buffer_.push(inData[offset + i].imag);
+	double alpha = (double)blockSize_ / (double)averageSize_;
+	if (alpha > 1.0) alpha = 1.0;
+	
+	int blankStart = -1; // start of the current blanked section
+	
+	for (int b = 0; b < blockCount; b++) {
+		int start = b * blockSize_;
+		int end   = min(start + blockSize_, length);
+		
+		if (averagePower_ < 0.0)
+			averagePower_ = blockPower_[b];
+		
+		bool impulse = (blockPower_[b] > (double)threshold_ * averagePower_);
+		if (impulse) {
+			if (hold_ == 0) impulses_++;
+			hold_ = holdBlocks_ + 1;
+		}
+		
+		if (hold_ > 0) {
+			hold_--;
+			if (blankStart < 0) blankStart = start;
+			blankedSamples_ += end - start;
+			
+			// The average follows blanked blocks too, clamped to the
+			// threshold, so impulses barely move it, while a lasting
+			// step in the level (gain change, new carrier) is
+			// eventually accepted instead of being blanked forever.
+			double clamped = min(blockPower_[b], (double)threshold_ * averagePower_);
+			averagePower_ += alpha * (clamped - averagePower_);
+		} else {
+			if (blankStart >= 0) {
+				fill(data, blankStart, start, data + start);
+				blankStart = -1;
+			}
+			averagePower_ += alpha * (blockPower_[b] - averagePower_);
+			last_ = data[end - 1];
 		}
 	}
+	
+	if (blankStart >= 0)
+		fill(data, blankStart, length, NULL);
+	
+	totalSamples_ += length;
 }
 
 
@@ -103,6 +201,14 @@ const double FFTBackend::PI = 4.0 * atan(1.0);
 FFTBackend::FFTBackend(int bins, int overlap) :
 	Backend(),
 	binOverlap_(overlap /* 32768 - 8192 */),
+	input_(this),
+	fixedPoint_(false),
+	fixedFFT_(NULL),
+	fixedOut_(NULL),
+	fixedWindow_(NULL),
+	fixedWindowFn_(NULL),
+	fixedInputExponent_(0),
+	fixedExponent_(0),
 	bins_(bins /* 32768 */)
 {
 	if (binOverlap_ < 0) binOverlap_ = 0;
@@ -110,6 +216,10 @@ FFTBackend::FFTBackend(int bins, int overlap) :
 
 	LOG_DEBUG("FFT backend: bins = " << bins_ << ", overlap = " << binOverlap_);
 	
+	conversionLatency_.setName(getLatencyPrefix() + ".conversion");
+	windowLatency_.setName(getLatencyPrefix() + ".window");
+	fftLatency_.setName(getLatencyPrefix() + ".fft");
+	
 	bufferSize_ = sizeof(fftw_complex) * bins_;
 	
 	windowFn_ = new float[bufferSize_];
@@ -138,6 +248,15 @@ FFTBackend::~FFTBackend()
 	
 	delete [] windowRaw_;
 	windowRaw_ = NULL;
+	
+	delete fixedFFT_;
+	fixedFFT_ = NULL;
+	delete [] fixedOut_;
+	fixedOut_ = NULL;
+	delete [] fixedWindow_;
+	fixedWindow_ = NULL;
+	delete [] fixedWindowFn_;
+	fixedWindowFn_ = NULL;
 }
 
 
@@ -146,6 +265,7 @@ void FFTBackend::startStream(StreamInfo info)
 	Backend::startStream(info);
 	
 	inMark_ = window_;
+	blanker_.reset();
 	
 	fftSampleRate_ = ((float)info.sampleRate /
 				   (float)(bins_ - binOverlap_));
@@ -185,7 +305,36 @@ void FFTBackend::startStream(StreamInfo info)
 		CPPAPP_ASSERT(windowFn_[i] <= 1.0);
 	}
 	
+	delete fixedFFT_;
+	fixedFFT_ = NULL;
+	delete [] fixedOut_;
+	fixedOut_ = NULL;
+	delete [] fixedWindow_;
+	fixedWindow_ = NULL;
+	delete [] fixedWindowFn_;
+	fixedWindowFn_ = NULL;
+	
+	if (fixedPoint_) {
+		if (FixedTransform::isPowerOfTwo(bins_)) {
+			fixedFFT_      = new FixedTransform(bins_);
+			fixedOut_      = new int16_t[2 * bins_];
+			fixedWindow_   = new int16_t[2 * bins_];
+			fixedWindowFn_ = new int16_t[bins_];
+			for (int i = 0; i < bins_; i++)
+				fixedWindowFn_[i] = (int16_t)floor(windowFn_[i] * FixedTransform::MAX_VALUE + 0.5);
+			// Q15, the range of the JACK frontend.
+			fixedInputExponent_ = -FixedTransform::FRACTION_BITS;
+			LOG_INFO("FFT backend: using fixed-point FFT.");
+		} else {
+			LOG_WARNING("FFT backend: fixed-point FFT needs the number of bins to be a power of two, using FFTW.");
+		}
+	}
+	
 	LOG_DEBUG("Starting FFT stream with time offset " << info.timeOffset << ", sample rate " << info.sampleRate << "Hz.");
+	
+	FOR_EACH(engines_, it) {
+		(*it)->startStream(info);
+	}
 }
 
 
@@ -194,88 +343,214 @@ void FFTBackend::process(const vector<Complex> &data, DataInfo info)
 	assert(sizeof(Complex) == sizeof(in_[0]));
 	//assert(binOverlap_ <= (bins_ - binOverlap_));
 	
+	int size = data.size();
+	if (size < 1) return;
+	
 	processingStopwatch_.start();
+	LatencyTimer latency;
 	
-	int size = data.size();
 	const Complex *src = &(data[0]);
 	
-	//for (int i = 0; i < size; i++) {
-	//	int16_t *row = rawBuffer_.push();
-	//	row[0] = (int16_t)(src[i].real * 0x7fff);
-	//	row[1] = (int16_t)(src[i].imag * 0x7fff);
-	//}
+	if ((int)corrected_.size() < size) {
+		corrected_.resize(size);
+		correctedRaw_.resize(size);
+	}
+	
+	// Input stage: apply the I/Q correction, blank impulses and store
+	// the raw data. The raw data are stored before blanking.
+	correction_.process(src, size, &(corrected_[0]));
+	blanker_.process(&(corrected_[0]), size);
+	int      rawMark     = rawBuffer_.mark();
+	int      rawCapacity = rawBuffer_.getCapacity();
+	uint64_t rawPosition = rawBuffer_.getPublished();
+	rawBuffer_.push(src, size);
+	rawBuffer_.publish();
+	for (int i = 0; i < size; i++) {
+		// The handle points after its sample, as the head did after
+		// pushing the sample.
+		if (++rawMark >= rawCapacity) rawMark = 0;
+		correctedRaw_[i] = RawDataHandle(
+			rawMark,
+			++rawPosition,
+			info.timeOffset.addSamples(i, streamInfo_.sampleRate)
+		);
+	}
+	latency.lap(conversionLatency_);
+	
+	// Window stage of this backend and of all attached engines.
+	processWindows(&(corrected_[0]), &(correctedRaw_[0]), size);
+	FOR_EACH(engines_, it) {
+		(*it)->processWindows(&(corrected_[0]), &(correctedRaw_[0]), size);
+	}
+	
+	processingStopwatch_.end();
+	double ms = processingStopwatch_.getMilliseconds();
+	processingTime_.add(ms);
+	totalProcessingTime_.add(ms);
+}
+
+
+string FFTBackend::getLatencyPrefix() const
+{
+	ostringstream ss;
+	ss << "fft" << bins_;
+	return ss.str();
+}
+
+
+/**
+ * \brief Stores \c count samples to the window buffer at \c offset.
+ *
+ * In fixed point, the samples are converted to integers with the block
+ * exponent of the window buffer, which is raised first if they don't
+ * fit (see \ref rescaleWindow).
+ */
+void FFTBackend::copyToWindow(const Complex *data, int offset, int count)
+{
+	if (fixedFFT_ == NULL) {
+		memcpy(window_ + offset, data, count * sizeof(in_[0]));
+		return;
+	}
+	
+	double maxAbs = 0.0;
+	for (int i = 0; i < count; i++)
+		maxAbs = max(maxAbs, max(fabs(data[i].real), fabs(data[i].imag)));
 	
-	WFTime timeOffset = info.timeOffset;
+	if (maxAbs > 0.0) {
+		// maxAbs = m * 2^e, 0.5 <= m < 1
+		int e;
+		frexp(maxAbs, &e);
+		int exponent = e - FixedTransform::FRACTION_BITS;
+		if (exponent > fixedInputExponent_)
+			rescaleWindow(offset, exponent - fixedInputExponent_);
+	}
 	
+	double   scale = ldexp(1.0, -fixedInputExponent_);
+	int16_t *dest  = fixedWindow_ + 2 * offset;
+	for (int i = 0; i < 2 * count; i++) {
+		double v = floor(((const double*)data)[i] * scale + 0.5);
+		if (v >  FixedTransform::MAX_VALUE) v =  FixedTransform::MAX_VALUE;
+		if (v < -FixedTransform::MAX_VALUE) v = -FixedTransform::MAX_VALUE;
+		dest[i] = (int16_t)v;
+	}
+}
+
+
+/**
+ * \brief Changes the block exponent of the fixed-point window buffer by
+ *        \c shift, shifting the first \c count samples accordingly.
+ *
+ * Only done when the input level changes, so the samples are converted
+ * once and only shifted afterwards.
+ */
+void FFTBackend::rescaleWindow(int count, int shift)
+{
+	if (shift > 0) {
+		int32_t round = (shift <= 16) ? (1 << (shift - 1)) : 0;
+		for (int i = 0; i < 2 * count; i++)
+			fixedWindow_[i] = (shift <= 16) ? (int16_t)((fixedWindow_[i] + round) >> shift) : 0;
+	} else {
+		for (int i = 0; i < 2 * count; i++)
+			fixedWindow_[i] = (int16_t)(fixedWindow_[i] << -shift);
+	}
+	fixedInputExponent_ += shift;
+}
+
+
+/**
+ * \brief Collects I/Q corrected samples into FFT windows, computes the FFT and
+ *        passes the result to \ref processFFT.
+ *
+ * \param data I/Q corrected samples
+ * \param raw  raw data handles of the samples in \c data
+ * \param size number of samples in \c data
+ */
+void FFTBackend::processWindows(const Complex       *data,
+						  const RawDataHandle *raw,
+						  int                  size)
+{
 	// Loop while there is enough remaining data for another FFT window.
 	while (size >= (inEnd_ - inMark_)) {
-		int count = inEnd_ - inMark_;
+		int count  = inEnd_ - inMark_;
+		int offset = inMark_ - window_;
 		
 		// Copy the incoming data to the window buffer
-		//memcpy(inMark_, src, count * sizeof(in_[0]));
-		correction_.process(src, count, (Complex*)inMark_);
-		for (int i = 0; i < count; i++) {
-			floatToInt(src[i], rawBuffer_.push());
-			windowRaw_[inMark_ - window_ + i] = RawDataHandle(
-				rawBuffer_.mark(),
-				timeOffset.addSamples(i, streamInfo_.sampleRate)
-			);
-		}
+		copyToWindow(data, offset, count);
+		memcpy(windowRaw_ + offset, raw, count * sizeof(windowRaw_[0]));
 		
 		info_.timeOffset = windowRaw_[0].time;
 		
+		LatencyTimer latency;
+		
 		// From the window buffer, copy the data to the FFT input buffer, aplying
 		// the window function
-		for (int i = 0; i < bins_; i++) {
-			in_[i][0] = window_[i][0] * windowFn_[i];
-			in_[i][1] = window_[i][1] * windowFn_[i];
+		int32_t maxAbs = 0;
+		if (fixedFFT_ != NULL) {
+			for (int i = 0; i < bins_; i++) {
+				int32_t w = fixedWindowFn_[i];
+				int32_t re = fixedWindow_[2 * i];
+				int32_t im = fixedWindow_[2 * i + 1];
+				fixedOut_[2 * i]     = (int16_t)((re * w + (1 << 14)) >> 15);
+				fixedOut_[2 * i + 1] = (int16_t)((im * w + (1 << 14)) >> 15);
+				maxAbs = max(maxAbs, max(abs(re), abs(im)));
+			}
+		} else {
+			for (int i = 0; i < bins_; i++) {
+				in_[i][0] = window_[i][0] * windowFn_[i];
+				in_[i][1] = window_[i][1] * windowFn_[i];
+			}
 		}
+		latency.lap(windowLatency_);
 		
 		// Execute FFT
 		stopwatch_.start();
-		fftw_execute(fftPlan_);
+		if (fixedFFT_ != NULL) {
+			fixedExponent_ = fixedFFT_->transform(fixedOut_) + fixedInputExponent_;
+		} else {
+			fftw_execute(fftPlan_);
+		}
 		stopwatch_.end();
+		latency.lap(fftLatency_);
 		fftTime_.add(stopwatch_.getMilliseconds());
 		
 		// Copy the overlap back to the beginning of the window buffer.
-		memmove(window_, inEnd_ - binOverlap_, binOverlap_ * sizeof(in_[0]));
+		if (fixedFFT_ != NULL) {
+			memmove(fixedWindow_, fixedWindow_ + 2 * (bins_ - binOverlap_), 2 * binOverlap_ * sizeof(int16_t));
+			
+			// The input got quieter, use more bits for the next samples
+			// (keeping one bit of headroom).
+			int shift = 0;
+			while ((maxAbs > 0) && ((maxAbs << (shift + 1)) < (1 << 14)))
+				shift++;
+			if (shift > 0)
+				rescaleWindow(binOverlap_, -shift);
+		} else
+			memmove(window_, inEnd_ - binOverlap_, binOverlap_ * sizeof(in_[0]));
 		memmove(windowRaw_, windowRaw_ + bins_ - binOverlap_, binOverlap_ * sizeof(windowRaw_[0]));
 		
 		// Update variables to keep track of the remaining data/work.
 		inMark_ = window_ + binOverlap_;
 		size -= count;
-		src += count;
+		data += count;
+		raw  += count;
 		
 		// Pass the FFT data to the derived class.
 		stopwatch_.start();
-		processFFT(out_, bins_, info_, windowRaw_[0].mark);
+		processFFT(out_, bins_, info_, windowRaw_[0]);
 		stopwatch_.end();
 		analysisTime_.add(stopwatch_.getMilliseconds());
 		
-		timeOffset = timeOffset.addSamples(count, streamInfo_.sampleRate);
 		info_.offset++;
 	}
 	
 	// If there are any remaining I/Q samples (but not enough for a complete
 	// window, copy them to the window buffer and move the mark.
 	if (size > 0) {
-		//memcpy(inMark_, src, size * sizeof(in_[0]));
-		correction_.process(src, size, (Complex*)inMark_);
-		for (int i = 0; i < size; i++) {
-			floatToInt(src[i], rawBuffer_.push());
-			windowRaw_[inMark_ - window_ + i] = RawDataHandle(
-				rawBuffer_.mark(),
-				timeOffset.addSamples(i, streamInfo_.sampleRate)
-			);
-		}
+		copyToWindow(data, inMark_ - window_, size);
+		memcpy(windowRaw_ + (inMark_ - window_), raw, size * sizeof(windowRaw_[0]));
 		
 		inMark_ += size;
 	}
-	
-	processingStopwatch_.end();
-	double ms = processingStopwatch_.getMilliseconds();
-	processingTime_.add(ms);
-	totalProcessingTime_.add(ms);
 }
 
 
@@ -283,6 +558,69 @@ void FFTBackend::endStream()
 {
 	Backend::endStream();
 	LOG_DEBUG("Ending FFT stream.");
+	
+	FOR_EACH(engines_, it) {
+		(*it)->endStream();
+	}
+}
+
+
+void FFTBackend::setDryRun(bool value)
+{
+	Backend::setDryRun(value);
+	
+	FOR_EACH(engines_, it) {
+		(*it)->setDryRun(value);
+	}
+}
+
+
+void FFTBackend::reportMemory(vector<MemoryUsage> &usage)
+{
+	string prefix = getLatencyPrefix();
+	
+	ostringstream detail;
+	detail << bins_ << " bins";
+	usage.push_back(MemoryUsage(prefix + ".window",
+		3 * bufferSize_ + sizeof(float) * bufferSize_ + sizeof(RawDataHandle) * bins_,
+		detail.str()));
+	
+	// FFTW doesn't report the size of a plan, the twiddle factors take
+	// about one complex number per bin.
+	size_t planSize = bufferSize_;
+	if (fixedFFT_ != NULL) {
+		// Output, twiddle factors and bit reversal table.
+		planSize += (2 * sizeof(int16_t) + sizeof(int16_t) + sizeof(int)) * bins_;
+	}
+	usage.push_back(MemoryUsage(prefix + ".plan", planSize,
+		isFixedPoint() ? "fixed point" : "FFTW (estimate)"));
+	
+	// The raw buffer is reported by the backend running the input stage.
+	if (!isEngine()) {
+		ostringstream raw;
+		raw << rawBuffer_.getCapacity() << " samples, " <<
+			(double)rawBuffer_.getCapacity() / (double)streamInfo_.sampleRate << " s";
+		usage.push_back(MemoryUsage("raw", rawBuffer_.getMemorySize(), raw.str()));
+	}
+	
+	FOR_EACH(engines_, it) {
+		(*it)->reportMemory(usage);
+	}
 }
 
 
+void FFTBackend::addEngine(Ref<FFTBackend> engine)
+{
+	engine->input_ = this;
+	engines_.push_back(engine);
+}
+
+
+bool FFTBackend::injectDependency(Ref<DIObject> obj, std::string key)
+{
+	if (key.compare("engine") == 0) {
+		addEngine(obj.as<FFTBackend>());
+	}
+	
+	return Backend::injectDependency(obj, key);
+}
@@ -16,6 +16,9 @@
 
 #include "Backend.h"
 #include "RingBuffer.h"
+#include "IQBuffer.h"
+#include "FixedFFT.h"
+#include "LatencyHistogram.h"
 
 
 class IQGainPhaseCorrection {
@@ -23,7 +26,8 @@ private:
 	SampleType             gain_;
 	int                    phaseShift_;
 	
-	RingBuffer<SampleType> buffer_;
+	RingBuffer<SampleType> buffer_;  ///< last \ref phaseShift_ Q samples
+	vector<SampleType>     delayed_; ///< Q samples of the current block preceded by \ref buffer_
 
 public:
 	IQGainPhaseCorrection() :
@@ -40,12 +44,98 @@ public:
 };
 
 
+/**
+ * \brief Time-domain blanker of wideband impulses.
+ *
+ * The input is split into short blocks. The mean power of each block (the
+ * short-term envelope) is compared to a long-term average of the power and
+ * blocks exceeding it \c threshold times are blanked, together with the
+ * following \c hold blocks. Blanked samples are either zeroed or linearly
+ * interpolated between the neighbouring unblanked samples. Blanked blocks
+ * contribute to the long-term average with their power clamped to
+ * \c threshold times the average, so impulses barely move it, while a
+ * lasting step in the level is accepted after a while (a 100x step after
+ * about 17k samples with the default settings).
+ *
+ * The blanker is disabled when the threshold is 0.
+ */
+class ImpulseBlanker {
+private:
+	float      threshold_;   ///< blanking threshold as a ratio to the average power
+	int        blockSize_;   ///< envelope block length in samples
+	int        holdBlocks_;  ///< number of blocks blanked after an impulse
+	int        averageSize_; ///< time constant of the long-term average in samples
+	bool       interpolate_; ///< interpolate blanked samples instead of zeroing them
+	
+	double     averagePower_;
+	int        hold_;
+	Complex    last_;        ///< last unblanked sample
+	
+	vector<double> blockPower_;
+	
+	SampleCount blankedSamples_;
+	SampleCount totalSamples_;
+	SampleCount impulses_;
+	
+	void fill(Complex *data, int start, int end, const Complex *next);
+
+public:
+	ImpulseBlanker() :
+		threshold_(0.0f), blockSize_(16), holdBlocks_(2), averageSize_(65536),
+		interpolate_(true),
+		averagePower_(-1.0), hold_(0),
+		blankedSamples_(0), totalSamples_(0), impulses_(0)
+	{
+		last_.real = 0.0;
+		last_.imag = 0.0;
+	}
+	
+	bool isEnabled() const { return threshold_ > 0.0f; }
+	
+	float getThreshold() const { return threshold_; }
+	void  setThreshold(float value) { threshold_ = value; }
+	
+	void setBlockSize(int value)   { blockSize_ = (value < 1) ? 1 : value; }
+	void setHoldBlocks(int value)  { holdBlocks_ = (value < 0) ? 0 : value; }
+	void setAverageSize(int value) { averageSize_ = (value < 1) ? 1 : value; }
+	void setInterpolate(bool value) { interpolate_ = value; }
+	
+	/**
+	 * \brief Returns the number of blanked samples since the last \ref clearCounters.
+	 */
+	SampleCount getBlankedSamples() const { return blankedSamples_; }
+	/**
+	 * \brief Returns the number of processed samples since the last \ref clearCounters.
+	 */
+	SampleCount getTotalSamples() const { return totalSamples_; }
+	/**
+	 * \brief Returns the number of detected impulses since the last \ref clearCounters.
+	 */
+	SampleCount getImpulses() const { return impulses_; }
+	
+	void clearCounters()
+	{
+		blankedSamples_ = 0;
+		totalSamples_   = 0;
+		impulses_       = 0;
+	}
+	
+	void reset();
+	
+	/**
+	 * \brief Blanks impulses in \c data in place.
+	 */
+	void process(Complex *data, int length);
+};
+
+
 struct RawDataHandle {
-	int    mark; ///< points to a row \ref FFTBackend::rawBuffer_;
-	WFTime time; ///< contains the 
+	int      mark;     ///< points to a row \ref FFTBackend::rawBuffer_;
+	uint64_t position; ///< position of the same row (see \ref RingBuffer2D::Cursor), doesn't wrap around
+	WFTime   time;     ///< contains the 
 	
-	RawDataHandle() : mark(0) {}
-	RawDataHandle(int mark, WFTime time) : mark(mark), time(time) {}
+	RawDataHandle() : mark(0), position(0) {}
+	RawDataHandle(int mark, uint64_t position, WFTime time) : mark(mark), position(position), time(time) {}
 };
 
 
@@ -54,10 +144,20 @@ struct RawDataHandle {
  *
  * This class also buffers the raw I/Q data so that any subclasses (\ref
  * WaterfallBackend) can record them.
+ *
+ * Processing of the incoming data is split into two stages. The input stage
+ * applies the I/Q correction and stores the raw data, the window stage
+ * collects the corrected samples into FFT windows and computes the FFT.
+ * Additional FFT engines (other FFT backends, see \ref addEngine) can be
+ * attached to a backend. Engines skip the input stage and are fed by the
+ * input stage of the backend they are attached to, sharing its I/Q
+ * correction and raw data buffer. This way, one input stream can be
+ * analyzed with several different FFT resolutions at once.
  */
 class FFTBackend : public Backend {
 public:
-	typedef RingBuffer2D<float> IQBuffer;
+	typedef ::IQBuffer              IQBuffer;
+	typedef BlockFloatFFT<int16_t>  FixedTransform;
 
 private:
 	FFTBackend(const FFTBackend& other);
@@ -69,6 +169,13 @@ private:
 	int bufferSize_; ///< buffer size in bytes
 	
 	IQGainPhaseCorrection correction_;
+	ImpulseBlanker        blanker_;
+	
+	FFTBackend             *input_;   ///< backend running the input stage (\c this, unless this backend is an engine)
+	vector<Ref<FFTBackend> > engines_; ///< FFT engines fed by this backend's input stage
+	
+	vector<Complex>       corrected_;    ///< I/Q corrected samples of the current batch
+	vector<RawDataHandle> correctedRaw_; ///< raw data handles of the samples in \ref corrected_
 	
 	float        *windowFn_;  ///< table containing the values of the window function
 	
@@ -81,6 +188,14 @@ private:
 	fftw_complex *in_, *out_; ///< input and output FFT buffers
 	fftw_plan     fftPlan_;   ///< FFT plan
 	
+	bool            fixedPoint_;    ///< use the fixed-point FFT instead of FFTW
+	FixedTransform *fixedFFT_;      ///< fixed-point FFT, \c NULL when FFTW is used
+	int16_t        *fixedOut_;      ///< fixed-point FFT buffer (interleaved I/Q)
+	int16_t        *fixedWindow_;   ///< incoming samples in fixed point (interleaved I/Q), used instead of \ref window_ in fixed point
+	int16_t        *fixedWindowFn_; ///< window function in Q15
+	int             fixedInputExponent_; ///< block exponent of \ref fixedWindow_ (the samples equal \ref fixedWindow_ * 2^exponent)
+	int             fixedExponent_; ///< block exponent of \ref fixedOut_
+	
 	DataInfo      info_; ///< FFT data stream info (as opposed to the raw data stream)
 	
 	RunningAverage2<double> processingTime_; ///< Running average of FFT calculation times.
@@ -91,17 +206,40 @@ private:
 	RunningAverage2<double> analysisTime_;
 	Stopwatch               stopwatch_;
 	
+	LatencyHistogram conversionLatency_; ///< input stage (correction, blanking, raw data conversion)
+	LatencyHistogram windowLatency_;     ///< windowing of one FFT window
+	LatencyHistogram fftLatency_;        ///< one FFT
+	
 protected:
 	int   bins_; ///< Number of FFT output bins.
 	/// Number of FFT results per second (Hz).
 	float fftSampleRate_;
 	
 	//RingBuffer2D<int16_t> rawBuffer_; ///< contains raw I/Q data
-	IQBuffer rawBuffer_; ///< contains raw I/Q data
+	IQBuffer rawBuffer_; ///< contains raw I/Q data in separate I and Q planes
 	
 	//virtual int getRawBufferSize() { return 1024; }
 	
-	virtual void processFFT(const fftw_complex *data, int size, DataInfo info, int rawMark) {}
+	void copyToWindow(const Complex *data, int offset, int count);
+	void rescaleWindow(int count, int shift);
+	void processWindows(const Complex *data, const RawDataHandle *raw, int size);
+	
+	/**
+	 * \brief Called for every computed FFT window.
+	 *
+	 * In fixed-point mode (see \ref isFixedPoint), \c data doesn't contain
+	 * the result. Use \ref getFixedOutput and \ref getFixedExponent instead.
+	 */
+	virtual void processFFT(const fftw_complex *data, int size, DataInfo info, const RawDataHandle &raw) {}
+	
+	/**
+	 * \brief Returns the result of the last fixed-point FFT (interleaved I/Q).
+	 *
+	 * The true value of the result is the returned data multiplied by
+	 * 2^\ref getFixedExponent().
+	 */
+	const int16_t* getFixedOutput() const { return fixedOut_; }
+	int            getFixedExponent() const { return fixedExponent_; }
 	
 public:
 	FFTBackend(int bins, int overlap);
@@ -116,19 +254,87 @@ public:
 	 */
 	float getFFTSampleRate() const { return fftSampleRate_; }
 	
+	/**
+	 * \brief Returns a prefix for names of this backend's latency histograms.
+	 */
+	string getLatencyPrefix() const;
+	
 	SampleType getGain() { return correction_.getGain(); }
 	void       setGain(SampleType value) { correction_.setGain(value); }
 	
+	/**
+	 * \brief Returns \c true if the FFT is computed in fixed point.
+	 */
+	bool isFixedPoint() const { return fixedFFT_ != NULL; }
+	/**
+	 * \brief Enables the fixed-point FFT for the next stream.
+	 *
+	 * The fixed-point FFT (\ref BlockFloatFFT) is much cheaper on boards
+	 * without fast double precision arithmetic. The samples are converted
+	 * to 16-bit integers once, when they enter the window buffer, with a
+	 * block exponent following the input level (frontends pass samples of
+	 * different ranges), and windowed in Q15. It requires the number of
+	 * bins to be a power of two, otherwise FFTW is used anyway.
+	 */
+	void setFixedPoint(bool value) { fixedPoint_ = value; }
+	
 	int        getPhaseShift() { return correction_.getPhaseShift(); }
 	void       setPhaseShift(int value) { correction_.setPhaseShift(value); } 
 	
+	/**
+	 * \brief Returns the impulse blanker applied to the input before windowing.
+	 */
+	ImpulseBlanker& getBlanker() { return blanker_; }
+	
+	/**
+	 * \brief Attaches an FFT engine fed by this backend's input stage.
+	 *
+	 * The engine gets the I/Q corrected samples of this backend and
+	 * shares its raw data buffer. Its own I/Q correction settings are
+	 * ignored.
+	 */
+	void addEngine(Ref<FFTBackend> engine);
+	
+	/**
+	 * \brief Returns \c true if this backend is an engine fed by another backend.
+	 */
+	bool isEngine() const { return input_ != this; }
+	
 	virtual void startStream(StreamInfo info);
 	virtual void process(const vector<Complex> &data, DataInfo info);
 	virtual void endStream();
 	
+	virtual void setDryRun(bool value);
+	virtual void reportMemory(vector<MemoryUsage> &usage);
+	
+	virtual bool injectDependency(Ref<DIObject> obj, std::string key);
+	
+	/**
+	 * \brief Returns the raw I/Q data buffer (shared with the input backend for engines).
+	 */
+	IQBuffer* getRawBuffer() { return &(input_->rawBuffer_); }
+	
+	/**
+	 * \brief Makes sure the raw I/Q data buffer can hold at least \c sampleCount samples.
+	 *
+	 * The raw buffer may be shared by several FFT engines, so it is only
+	 * ever enlarged. Enlarging the buffer discards its contents.
+	 */
 	void resizeRawBuffer(int sampleCount)
 	{
-		rawBuffer_.resize(2, 1024 * 1024, sampleCount);
+		IQBuffer *rawBuffer = getRawBuffer();
+		if (sampleCount > rawBuffer->getCapacity())
+			rawBuffer->resize(512 * 1024, sampleCount);
+	}
+	
+	/**
+	 * \brief Sets the allocation policy of the raw I/Q data buffer.
+	 *
+	 * For engines, this sets the policy of the shared buffer.
+	 */
+	void setRawAllocationPolicy(const AllocationPolicy &policy)
+	{
+		getRawBuffer()->setAllocationPolicy(policy);
 	}
 	
 	inline float binToFrequency(int bin) const
@@ -137,7 +343,7 @@ public:
 		//	(float)streamInfo_.sampleRate *
 		//	((2.0 * ((float)bin / (float)bins_)) - 1.0)
 		//);
-
+		
 		float b = (float)bin;
 		float sr = (float)streamInfo_.sampleRate;
 		float n = (float)bins_;
@@ -220,18 +426,29 @@ public:
 				<< fftTime_.max
 				<< ", fft count = "
 				<< fftTime_.count
-
+				
 				<< ", avg. anal. time (ms) = "
 				<< analysisTime_.getValue()
 				<< ", max. anal. time (ms) = "
 				<< analysisTime_.max
 		);
+		
+		if (blanker_.isEnabled()) {
+			LOG_DEBUG("FFTBackend: blanked samples = "
+					<< blanker_.getBlankedSamples()
+					<< " of "
+					<< blanker_.getTotalSamples()
+					<< ", impulses = "
+					<< blanker_.getImpulses()
+			);
+		}
 	}
 	void   clearProcessingTime()
 	{
 		processingTime_.clear();
 		fftTime_.clear();
 		analysisTime_.clear();
+		blanker_.clearCounters();
 	}
 	
 	inline static int16_t floatToInt(float f)
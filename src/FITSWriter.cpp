@@ -8,6 +8,9 @@
 
 #include "FITSWriter.h"
 
+#include <algorithm>
+#include <cstring>
+
 
 ostream& operator<<(ostream &output, const FITSStatus &status)
 {
@@ -63,15 +66,57 @@ void FITSWriter::close()
 }
 
 
+bool FITSCompression::parseType(const string &name, int *type)
+{
+	if (name == "rice") {
+		*type = RICE_1;
+	} else if (name == "gzip") {
+		*type = GZIP_1;
+	} else if (name == "gzip2") {
+		*type = GZIP_2;
+	} else if (name == "hcompress") {
+		*type = HCOMPRESS_1;
+	} else if (name == "plio") {
+		*type = PLIO_1;
+	} else if (name == "none") {
+		*type = NOCOMPRESS;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+
 void FITSWriter::createImage(long width, long height, int type)
 {
 	dimCount_ = 2;
+	delete [] dimensions_;
 	dimensions_ = new long[2];
 	dimensions_[0] = width;
 	dimensions_[1] = height;
+	
+	if (compression_.isEnabled()) {
+		long tile[2] = {
+			(compression_.tileWidth > 0) ? compression_.tileWidth : width,
+			compression_.tileHeight
+		};
+		
+		fits_set_compression_type(file_, compression_.type, status_);
+		fits_set_tile_dim(file_, 2, tile, status_);
+		if (type == FLOAT_IMG)
+			fits_set_quantize_level(file_, compression_.quantizeLevel, status_);
+		CHECK_STATUS("Failed to set compression parameters of FITS file.");
+	} else {
+		// CFITSIO keeps the compression parameters of the file for
+		// following HDUs, so they must be reset explicitly.
+		fits_set_compression_type(file_, NOCOMPRESS, status_);
+		fits_set_quantize_level(file_, 0.0, status_);
+		CHECK_STATUS("Failed to disable compression of FITS file.");
+	}
+	
 	//long dimensions[2] = { width, height };
 	fits_create_img(file_, type, 2, dimensions_, status_);
-	CHECK_STATUS("Failed to create primary HDU in FITS file.");
+	CHECK_STATUS("Failed to create image HDU in FITS file.");
 }
 
 
@@ -128,6 +173,16 @@ void FITSWriter::writeHeader(const char *keyword,
 }
 
 
+void FITSWriter::writeScaling(double scale, double zero)
+{
+	writeHeader("BSCALE", scale, "physical value = BZERO + BSCALE * pixel");
+	writeHeader("BZERO",  zero,  "");
+	
+	fits_set_bscale(file_, 1.0, 0.0, status_);
+	CHECK_STATUS("Failed to disable FITS pixel scaling.");
+}
+
+
 void FITSWriter::comment(const char *value)
 {
 	fits_write_comment(file_, value, status_);
@@ -162,6 +217,60 @@ void FITSWriter::write(long y, long count, int16_t *data)
 }
 
 
+void FITSWriter::write(long y, long count, uint16_t *data)
+{
+	write(0, y, count * dimensions_[0], data, TUSHORT);
+}
+
+
+void FITSWriter::write(long y, long count, uint8_t *data)
+{
+	write(0, y, count * dimensions_[0], data, TBYTE);
+}
+
+
+static int pixelSize(int type)
+{
+	switch (type) {
+	case TBYTE:   return 1;
+	case TSHORT:
+	case TUSHORT: return 2;
+	case TDOUBLE: return 8;
+	default:      return 4;
+	}
+}
+
+
+void FITSWriter::writeRows(long y, long count, const void *data, long stride, int type)
+{
+	long width = dimensions_[0];
+	
+	if (stride == width) {
+		write(0, y, count * width, const_cast<void*>(data), type);
+		return;
+	}
+	
+	size_t rowSize   = pixelSize(type) * width;
+	size_t rowStride = pixelSize(type) * stride;
+	long   batch     = max(1L, (long)(GATHER_SIZE / rowSize));
+	
+	if (gather_.size() < rowSize * min(batch, count))
+		gather_.resize(rowSize * min(batch, count));
+	
+	const char *src = (const char*)data;
+	while (count > 0) {
+		long rows = min(batch, count);
+		for (long i = 0; i < rows; i++, src += rowStride)
+			memcpy(&(gather_[0]) + i * rowSize, src, rowSize);
+		
+		write(0, y, rows * width, &(gather_[0]), type);
+		
+		y     += rows;
+		count -= rows;
+	}
+}
+
+
 void FITSWriter::checkStatus(const char *errorMsg)
 {
 	CHECK_STATUS(errorMsg);
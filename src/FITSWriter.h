@@ -10,7 +10,9 @@
 #define FITSWRITER_N9AFZ3HN
 
 
+#include <stdint.h>
 #include <string>
+#include <vector>
 using namespace std;
 
 #include <fitsio.h>
@@ -54,6 +56,33 @@ struct FITSStatus {
 ostream& operator<<(ostream &output, const FITSStatus &status);
 
 
+/**
+ * \brief Tile compression parameters of images (see \ref FITSWriter::setCompression).
+ *
+ * http://heasarc.gsfc.nasa.gov/fitsio/c/c_user/node41.html
+ */
+struct FITSCompression {
+	int   type;          ///< \c RICE_1, \c GZIP_1, \c GZIP_2, \c HCOMPRESS_1, \c PLIO_1 or \c NOCOMPRESS.
+	long  tileWidth;     ///< Tile width in pixels, 0 for the width of the image.
+	long  tileHeight;    ///< Tile height in pixels.
+	float quantizeLevel; ///< Quantization level of float images, 0 for lossless compression.
+	
+	FITSCompression(int type = NOCOMPRESS) :
+		type(type), tileWidth(0), tileHeight(1), quantizeLevel(4.0)
+	{}
+	
+	inline bool isEnabled() const { return type != NOCOMPRESS; }
+	
+	/**
+	 * \brief Converts an algorithm name ("rice", "gzip", "gzip2",
+	 *        "hcompress", "plio" or "none") to a compression type.
+	 *
+	 * \returns \c false if the name is unknown
+	 */
+	static bool parseType(const string &name, int *type);
+};
+
+
 /**
  * \brief Thin wrapper around some of FITSIO's FITS file writing functions.
  *
@@ -72,6 +101,10 @@ private:
 	int         dimCount_;
 	long       *dimensions_;
 	
+	vector<char> gather_; ///< Rows gathered by \ref writeRows.
+	
+	FITSCompression compression_;
+	
 	FITSWriter(const FITSWriter& other);
 public:
 	/**
@@ -98,6 +131,22 @@ public:
 	 */
 	bool open(string fileName);
 	void close();
+	
+	/**
+	 * \brief Sets the compression of the images created by \ref createImage.
+	 *
+	 * Compressed images are stored as tiles in binary table extensions.
+	 * Pixels should be written in whole tiles, otherwise FITSIO has to
+	 * decompress and compress the tiles again.
+	 */
+	void setCompression(const FITSCompression &compression) { compression_ = compression; }
+	
+	/**
+	 * \brief Creates a new image HDU.
+	 *
+	 * The first image is the primary HDU, the following images are
+	 * appended as image extensions.
+	 */
 	void createImage(long width, long height, int type = FLOAT_IMG);
 	
 	void writeHeader(const char *keyword,
@@ -125,6 +174,14 @@ public:
 				  long long   value,
 				  const char *comment);
 
+	/**
+	 * \brief Writes BSCALE and BZERO headers of an integer image.
+	 *
+	 * The pixels are then written as they are stored (physical value =
+	 * BZERO + BSCALE * stored value), FITSIO doesn't scale them.
+	 */
+	void writeScaling(double scale, double zero);
+	
 	void comment(const char *value);
 	
 	void date();
@@ -143,6 +200,34 @@ public:
 	void write(long x, long y, long count, void *data, int type);
 	void write(long y, long count, float *data);
 	void write(long y, long count, int16_t *data);
+	void write(long y, long count, uint16_t *data);
+	void write(long y, long count, uint8_t *data);
+	
+	/**
+	 * \brief Writes \c count full-width rows whose starts are \c stride pixels apart in \c data.
+	 *
+	 * Rows of a ring buffer chunk (see \ref RingBuffer2D::span) are
+	 * written at once: if the rows are contiguous (\c stride equals the
+	 * image width), they are written by a single FITSIO call, otherwise
+	 * they are gathered into an internal buffer and written in batches of
+	 * about \ref GATHER_SIZE bytes. The latter is used to write a range of
+	 * columns of wider rows.
+	 *
+	 * \param y      position of the first row
+	 * \param count  number of rows
+	 * \param data   pointer to the first pixel of the first row
+	 * \param stride distance between starts of two rows in number of pixels
+	 * \param type   domain data type of the data (\c TFLOAT, \c TSHORT,
+	 *               \c TUSHORT or \c TBYTE)
+	 */
+	void writeRows(long y, long count, const void *data, long stride, int type);
+	void writeRows(long y, long count, const float *data, long stride)    { writeRows(y, count, data, stride, TFLOAT); }
+	void writeRows(long y, long count, const int16_t *data, long stride)  { writeRows(y, count, data, stride, TSHORT); }
+	void writeRows(long y, long count, const uint16_t *data, long stride) { writeRows(y, count, data, stride, TUSHORT); }
+	void writeRows(long y, long count, const uint8_t *data, long stride)  { writeRows(y, count, data, stride, TBYTE); }
+	
+	/// Approximate size of the batches of gathered rows in bytes.
+	static const int GATHER_SIZE = 1024 * 1024;
 	
 	void checkStatus(const char *errorMsg);
 };
@@ -0,0 +1,255 @@
+/**
+ * \file   FixedFFT.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the BlockFloatFFT class.
+ */
+
+#ifndef FIXEDFFT_R4KQ8ZTM
+#define FIXEDFFT_R4KQ8ZTM
+
+
+#include <stdint.h>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+using namespace std;
+
+
+/**
+ * \brief Integer square root of a 32-bit unsigned integer (rounded down).
+ */
+inline uint32_t isqrt32(uint32_t value)
+{
+	uint32_t result = 0;
+	uint32_t bit    = (uint32_t)1 << 30;
+
+	while (bit > value) bit >>= 2;
+
+	while (bit != 0) {
+		if (value >= result + bit) {
+			value  -= result + bit;
+			result  = (result >> 1) + bit;
+		} else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return result;
+}
+
+
+/**
+ * \brief Radix-2 complex FFT in fixed point with block floating point scaling.
+ *
+ * The data are stored as interleaved real and imaginary parts of type \c T
+ * (\c int16_t by default) in Q15 format, intermediate products are computed
+ * in \c Acc. Before each butterfly stage, the stage output is scaled down by
+ * a power of two just enough to avoid overflow, and the scaling is
+ * accumulated in a block exponent shared by all the samples. The true result
+ * is the fixed-point result multiplied by 2^exponent.
+ *
+ * The class uses only portable integer arithmetic, so it gives the same
+ * results on the ARM station boards and on the development machines.
+ *
+ * \note The number of bins must be a power of two.
+ */
+template<class T = int16_t, class Acc = int32_t>
+class BlockFloatFFT {
+public:
+	typedef T   value_type;
+	typedef Acc accumulator_type;
+
+	static const int FRACTION_BITS = 15;
+	static const Acc ONE           = (Acc)1 << FRACTION_BITS;
+	static const Acc MAX_VALUE     = ONE - 1;
+
+private:
+	int        bins_;
+	int        log2Bins_;
+	vector<T>  twiddles_; ///< interleaved cos(-2 pi k / n), sin(-2 pi k / n), Q15
+	vector<int> reversed_; ///< bit reversed index for every bin
+
+	/**
+	 * \brief Returns the shift needed for a stage to not overflow.
+	 *
+	 * One radix-2 butterfly can grow a component at most (1 + sqrt(2))
+	 * times.
+	 */
+	static int stageShift(Acc maxAbs)
+	{
+		const Acc limit = (Acc)(MAX_VALUE / 2.4143);
+
+		if (maxAbs <= limit)     return 0;
+		if (maxAbs <= 2 * limit) return 1;
+		return 2;
+	}
+
+	static inline Acc mulQ15(Acc a, Acc b)
+	{
+		return (a * b + (ONE >> 1)) >> FRACTION_BITS;
+	}
+
+	static inline T roundShift(Acc value, int shift)
+	{
+		if (shift == 0) return (T)value;
+		return (T)((value + ((Acc)1 << (shift - 1))) >> shift);
+	}
+
+public:
+	BlockFloatFFT() : bins_(0), log2Bins_(0) {}
+
+	explicit BlockFloatFFT(int bins) : bins_(0), log2Bins_(0)
+	{
+		resize(bins);
+	}
+
+	int getBins() const { return bins_; }
+
+	static bool isPowerOfTwo(int value)
+	{
+		return (value > 0) && ((value & (value - 1)) == 0);
+	}
+
+	void resize(int bins)
+	{
+		assert(isPowerOfTwo(bins));
+
+		bins_     = bins;
+		log2Bins_ = 0;
+		while ((1 << log2Bins_) < bins_) log2Bins_++;
+
+		twiddles_.resize(bins_);
+		for (int k = 0; k < bins_ / 2; k++) {
+			double angle = -2.0 * M_PI * (double)k / (double)bins_;
+			twiddles_[2 * k]     = (T)floor(cos(angle) * MAX_VALUE + 0.5);
+			twiddles_[2 * k + 1] = (T)floor(sin(angle) * MAX_VALUE + 0.5);
+		}
+
+		reversed_.resize(bins_);
+		for (int i = 0; i < bins_; i++) {
+			int r = 0;
+			for (int b = 0; b < log2Bins_; b++) {
+				if (i & (1 << b)) r |= 1 << (log2Bins_ - 1 - b);
+			}
+			reversed_[i] = r;
+		}
+	}
+
+	/**
+	 * \brief Quantizes double samples to the fixed-point format.
+	 *
+	 * The samples are scaled by a power of two so that the largest of them
+	 * uses the full range of \c T.
+	 *
+	 * \param src    interleaved real and imaginary parts, 2 * \c count values
+	 * \param count  number of complex samples
+	 * \param dest   interleaved fixed-point output
+	 * \returns exponent of the quantized block (the samples equal
+	 *          \c dest * 2^exponent)
+	 */
+	static int quantize(const double *src, int count, T *dest)
+	{
+		double maxAbs = 0.0;
+		for (int i = 0; i < 2 * count; i++) {
+			double v = fabs(src[i]);
+			if (v > maxAbs) maxAbs = v;
+		}
+
+		if (maxAbs == 0.0) {
+			for (int i = 0; i < 2 * count; i++) dest[i] = 0;
+			return 0;
+		}
+
+		// maxAbs = m * 2^e, 0.5 <= m < 1
+		int e;
+		frexp(maxAbs, &e);
+		int exponent = e - FRACTION_BITS;
+		double scale = ldexp(1.0, -exponent);
+
+		for (int i = 0; i < 2 * count; i++) {
+			double v = floor(src[i] * scale + 0.5);
+			if (v >  MAX_VALUE) v =  MAX_VALUE;
+			if (v < -MAX_VALUE) v = -MAX_VALUE;
+			dest[i] = (T)v;
+		}
+
+		return exponent;
+	}
+
+	/**
+	 * \brief Computes forward FFT of \c data in place.
+	 *
+	 * \param data interleaved real and imaginary parts, 2 * \ref getBins() values
+	 * \returns exponent accumulated by the block scaling
+	 */
+	int transform(T *data) const
+	{
+		int exponent = 0;
+
+		// Bit reversal permutation
+		for (int i = 0; i < bins_; i++) {
+			int j = reversed_[i];
+			if (j > i) {
+				T re = data[2 * i];
+				T im = data[2 * i + 1];
+				data[2 * i]     = data[2 * j];
+				data[2 * i + 1] = data[2 * j + 1];
+				data[2 * j]     = re;
+				data[2 * j + 1] = im;
+			}
+		}
+
+		for (int half = 1, stride = bins_ / 2; half < bins_; half *= 2, stride /= 2) {
+			Acc maxAbs = 0;
+			for (int i = 0; i < 2 * bins_; i++) {
+				Acc v = abs((Acc)data[i]);
+				if (v > maxAbs) maxAbs = v;
+			}
+
+			int shift = stageShift(maxAbs);
+			exponent += shift;
+
+			for (int start = 0; start < bins_; start += 2 * half) {
+				for (int k = 0; k < half; k++) {
+					T *a = data + 2 * (start + k);
+					T *b = a + 2 * half;
+
+					Acc wr = twiddles_[2 * k * stride];
+					Acc wi = twiddles_[2 * k * stride + 1];
+
+					Acc br = b[0];
+					Acc bi = b[1];
+					Acc tr = mulQ15(wr, br) - mulQ15(wi, bi);
+					Acc ti = mulQ15(wr, bi) + mulQ15(wi, br);
+
+					Acc ar = a[0];
+					Acc ai = a[1];
+
+					a[0] = roundShift(ar + tr, shift);
+					a[1] = roundShift(ai + ti, shift);
+					b[0] = roundShift(ar - tr, shift);
+					b[1] = roundShift(ai - ti, shift);
+				}
+			}
+		}
+
+		return exponent;
+	}
+
+	/**
+	 * \brief Integer magnitude of one fixed-point complex value.
+	 */
+	static inline uint32_t magnitude(const T *value)
+	{
+		int32_t re = value[0];
+		int32_t im = value[1];
+		return isqrt32((uint32_t)(re * re) + (uint32_t)(im * im));
+	}
+};
+
+
+#endif /* end of include guard: FIXEDFFT_R4KQ8ZTM */
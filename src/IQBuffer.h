@@ -0,0 +1,126 @@
+/**
+ * \file   IQBuffer.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the IQBuffer class.
+ */
+
+#ifndef IQBUFFER_P7DK2VQA
+#define IQBUFFER_P7DK2VQA
+
+
+#include <stddef.h>
+
+#include "RingBuffer.h"
+
+
+/**
+ * \brief Ring buffer of raw I/Q samples stored in two separate planes.
+ *
+ * The I and Q components are kept in two ring buffers of identical
+ * layout (one sample per row), so runs of one component are contiguous
+ * within the chunks of \ref RingBuffer2D. Bulk consumers can
+ * process a plane with full-width vector loads instead of picking every
+ * other float out of interleaved samples (see \ref plane and
+ * \ref RingBuffer2D::span).
+ *
+ * Both planes use the same marks. Positions (see
+ * \ref RingBuffer2D::Cursor) are kept by the I plane: a run is claimed in
+ * the I plane before either plane is written to, so \ref isOverrun covers
+ * both planes.
+ */
+class IQBuffer {
+public:
+	typedef RingBuffer2D<float>   Plane;
+	typedef Plane::Cursor         Cursor;
+	
+	static const int PLANE_I = 0;
+	static const int PLANE_Q = 1;
+
+private:
+	Plane planes_[2];
+	
+	IQBuffer(const IQBuffer& other);
+
+public:
+	IQBuffer() {}
+	
+	inline int    getCapacity()   const { return planes_[PLANE_I].getCapacity(); }
+	inline size_t getMemorySize() const { return planes_[PLANE_I].getMemorySize() + planes_[PLANE_Q].getMemorySize(); }
+	
+	/**
+	 * \brief Returns the plane of the I (\c PLANE_I) or Q (\c PLANE_Q) component.
+	 */
+	inline Plane& plane(int index) { return planes_[index]; }
+	
+	void setAllocationPolicy(const AllocationPolicy &policy)
+	{
+		planes_[PLANE_I].setAllocationPolicy(policy);
+		planes_[PLANE_Q].setAllocationPolicy(policy);
+	}
+	
+	/**
+	 * \brief Resizes both planes, discarding all current data in process.
+	 *
+	 * \param chunkSize maximal chunk size of one plane in bytes
+	 * \param capacity  minimal capacity in number of samples
+	 */
+	void resize(int chunkSize, int capacity)
+	{
+		planes_[PLANE_I].resize(1, chunkSize, capacity);
+		planes_[PLANE_Q].resize(1, chunkSize, capacity);
+	}
+	
+	void clear()
+	{
+		planes_[PLANE_I].clear();
+		planes_[PLANE_Q].clear();
+	}
+	
+	/**
+	 * \brief Pushes \c count samples, splitting them into the planes.
+	 *
+	 * \c Sample is any type with \c real and \c imag members, such as
+	 * \ref Complex.
+	 */
+	template<class Sample>
+	void push(const Sample *data, int count)
+	{
+		while (count > 0) {
+			int rows;
+			float *i = planes_[PLANE_I].push(count, &rows);
+			float *q = planes_[PLANE_Q].push(rows, &rows);
+			
+			for (int k = 0; k < rows; k++) {
+				i[k] = (float)data[k].real;
+				q[k] = (float)data[k].imag;
+			}
+			
+			data  += rows;
+			count -= rows;
+		}
+	}
+	
+	/**
+	 * \brief Returns the mark of the next sample to be pushed.
+	 */
+	inline int mark() { return planes_[PLANE_I].mark(); }
+	
+	inline void publish()
+	{
+		planes_[PLANE_Q].publish();
+		planes_[PLANE_I].publish();
+	}
+	
+	inline uint64_t getPublished() const { return planes_[PLANE_I].getPublished(); }
+	
+	inline Cursor cursor(int back = 0) const       { return planes_[PLANE_I].cursor(back); }
+	inline Cursor cursorAt(int rowMark) const      { return planes_[PLANE_I].cursorAt(rowMark); }
+	inline int    mark(const Cursor &c) const      { return planes_[PLANE_I].mark(c); }
+	inline int    available(const Cursor &c) const { return planes_[PLANE_I].available(c); }
+	inline bool   isOverrun(const Cursor &c) const { return planes_[PLANE_I].isOverrun(c); }
+};
+
+
+#endif /* end of include guard: IQBUFFER_P7DK2VQA */
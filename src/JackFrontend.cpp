@@ -29,6 +29,8 @@ int JackFrontend::onJackInput(jack_nframes_t nframes, void *arg)
 	//int offset = outputBuffer_.size();
 	//outputBuffer_.resize(offset + nframes);
 	int offset = 0;
+	// The capacity is reserved outside of the process callback, so
+	// resizing never allocates.
 	self->outputBuffer_.resize(nframes);
 	
 	for (int i = 0; i < (int)nframes; i++) {
@@ -72,6 +74,20 @@ int JackFrontend::onJackInput(jack_nframes_t nframes, void *arg)
 }
 
 
+/**
+ * Called by JACK whenever the buffer size changes (and before the first
+ * process callback), while no process callback is running.
+ */
+int JackFrontend::onJackBufferSize(jack_nframes_t nframes, void *arg)
+{
+	JackFrontend *self = (JackFrontend*)arg;
+	
+	self->outputBuffer_.reserve(nframes);
+	
+	return 0;
+}
+
+
 void JackFrontend::onJackShutdown(void *arg)
 {
 	JackFrontend *self = (JackFrontend*)arg;
@@ -109,7 +125,9 @@ void JackFrontend::run()
 	
 	startStream();
 	
+	outputBuffer_.reserve(jack_get_buffer_size(client));
 	jack_set_process_callback(client, onJackInput, (void*)this);
+	jack_set_buffer_size_callback(client, onJackBufferSize, (void*)this);
 	jack_on_shutdown(client, onJackShutdown, (void*)this);
 	
 	leftPort_ = jack_port_register(client,
@@ -36,6 +36,7 @@ private:
 	JackFrontend(const JackFrontend& other);
 	
 	static int  onJackInput(jack_nframes_t nframes, void *arg);
+	static int  onJackBufferSize(jack_nframes_t nframes, void *arg);
 	static void onJackShutdown(void *arg);
 	
 	bool        connect_;
@@ -46,7 +47,7 @@ private:
 	jack_port_t *leftPort_;
 	jack_port_t *rightPort_;
 	
-	vector<Complex> outputBuffer_;
+	vector<Complex> outputBuffer_; ///< preallocated for the JACK buffer size (see \ref onJackBufferSize)
 	
 	jack_port_t     *midiPort_;
 	deque<string*>   midiQueue_;
@@ -0,0 +1,111 @@
+/**
+ * \file   LatencyHistogram.cpp
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ * 
+ * \brief  Implementation file for the LatencyHistogram class.
+ */
+
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+
+
+Mutex                     LatencyHistogram::registryMutex_;
+vector<LatencyHistogram*> LatencyHistogram::registry_;
+
+
+LatencyHistogram::LatencyHistogram(const string &name) :
+	name_(name)
+{
+	clear();
+	
+	MutexLock lock(&registryMutex_);
+	registry_.push_back(this);
+}
+
+
+LatencyHistogram::~LatencyHistogram()
+{
+	MutexLock lock(&registryMutex_);
+	
+	vector<LatencyHistogram*>::iterator it = find(registry_.begin(), registry_.end(), this);
+	if (it != registry_.end())
+		registry_.erase(it);
+}
+
+
+uint32_t LatencyHistogram::percentile(double p) const
+{
+	uint32_t count = count_;
+	if (count == 0) return 0;
+	
+	uint64_t target = (uint64_t)(p * (double)count + 0.5);
+	if (target < 1) target = 1;
+	
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKET_COUNT; i++) {
+		seen += buckets_[i];
+		if (seen >= target)
+			return min(bucketUpperBound(i), (uint32_t)max_);
+	}
+	
+	return max_;
+}
+
+
+void LatencyHistogram::clear()
+{
+	for (int i = 0; i < BUCKET_COUNT; i++)
+		buckets_[i] = 0;
+	count_ = 0;
+	max_   = 0;
+	total_ = 0;
+}
+
+
+void LatencyHistogram::dump() const
+{
+	LOG_INFO("Latency " << name_ <<
+		    ": count = " << getCount() <<
+		    ", p50 (us) = " << (double)percentile(0.50) / 1000.0 <<
+		    ", p99 (us) = " << (double)percentile(0.99) / 1000.0 <<
+		    ", max (us) = " << (double)getMax() / 1000.0);
+}
+
+
+void LatencyHistogram::dumpAll(bool clear)
+{
+	MutexLock lock(&registryMutex_);
+	
+	FOR_EACH(registry_, it) {
+		if ((*it)->getCount() == 0) continue;
+		
+		(*it)->dump();
+		if (clear)
+			(*it)->clear();
+	}
+}
+
+
+vector<LatencyHistogram*> LatencyHistogram::getAll()
+{
+	MutexLock lock(&registryMutex_);
+	
+	vector<LatencyHistogram*> result;
+	FOR_EACH(registry_, it) {
+		if ((*it)->getCount() > 0)
+			result.push_back(*it);
+	}
+	return result;
+}
+
+
+void LatencyHistogram::clearAll()
+{
+	MutexLock lock(&registryMutex_);
+	
+	FOR_EACH(registry_, it) {
+		(*it)->clear();
+	}
+}
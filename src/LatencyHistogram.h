@@ -0,0 +1,175 @@
+/**
+ * \file   LatencyHistogram.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the LatencyHistogram class.
+ */
+
+#ifndef LATENCYHISTOGRAM_W3NX0EQF
+#define LATENCYHISTOGRAM_W3NX0EQF
+
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+
+/**
+ * \brief Lock-free histogram of latencies with logarithmic buckets.
+ *
+ * Latencies are recorded in nanoseconds. Every octave is split into four
+ * buckets, so the percentiles have a resolution of 25 %. Recording a value
+ * (\ref add) only uses atomic increments, so it can be called from the
+ * real-time processing thread while another thread reads or dumps the
+ * histogram.
+ *
+ * All histograms register themselves in a global list on construction, so
+ * they can be dumped all at once by \ref dumpAll.
+ */
+class LatencyHistogram {
+public:
+	static const int SUB_BUCKETS  = 4;
+	static const int BUCKET_COUNT = 31 * SUB_BUCKETS;
+
+private:
+	string            name_;
+	volatile uint32_t buckets_[BUCKET_COUNT];
+	volatile uint32_t count_;
+	volatile uint32_t max_;
+	volatile uint64_t total_; ///< sum of all recorded latencies
+	
+	static Mutex                      registryMutex_;
+	static vector<LatencyHistogram*>  registry_;
+	
+	LatencyHistogram(const LatencyHistogram& other);
+	
+	static int bucketIndex(uint32_t value)
+	{
+		if (value < (uint32_t)SUB_BUCKETS) return value;
+		
+		int msb = 31 - __builtin_clz(value);
+		int sub = (value >> (msb - 2)) & (SUB_BUCKETS - 1);
+		return (msb - 1) * SUB_BUCKETS + sub;
+	}
+	
+	static uint32_t bucketUpperBound(int index)
+	{
+		if (index < SUB_BUCKETS) return index;
+		
+		int      msb   = index / SUB_BUCKETS + 1;
+		uint64_t upper = ((uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS + 1) << (msb - 2)) - 1;
+		return (upper > 0xffffffffu) ? 0xffffffffu : (uint32_t)upper;
+	}
+
+public:
+	LatencyHistogram(const string &name = "");
+	~LatencyHistogram();
+	
+	const string& getName() const { return name_; }
+	void setName(const string &name) { name_ = name; }
+	
+	/**
+	 * \brief Records one latency in nanoseconds.
+	 */
+	inline void add(uint64_t ns)
+	{
+		uint32_t value = (ns > 0xffffffffu) ? 0xffffffffu : (uint32_t)ns;
+		
+		__sync_fetch_and_add(&(buckets_[bucketIndex(value)]), 1);
+		__sync_fetch_and_add(&count_, 1);
+		__sync_fetch_and_add(&total_, (uint64_t)value);
+		
+		uint32_t old = max_;
+		while (value > old) {
+			uint32_t prev = __sync_val_compare_and_swap(&max_, old, value);
+			if (prev == old) break;
+			old = prev;
+		}
+	}
+	
+	uint32_t getCount() const { return count_; }
+	uint32_t getMax() const { return max_; }
+	/**
+	 * \brief Returns the sum of all recorded latencies in nanoseconds.
+	 */
+	uint64_t getTotal() const { return __sync_fetch_and_add(const_cast<uint64_t*>(&total_), 0); }
+	
+	/**
+	 * \brief Returns an upper bound of the \c p quantile (0 -- 1) in nanoseconds.
+	 */
+	uint32_t percentile(double p) const;
+	
+	/**
+	 * \brief Resets the histogram.
+	 *
+	 * \note Values recorded concurrently with clearing may be lost.
+	 */
+	void clear();
+	
+	/**
+	 * \brief Logs count, p50, p99 and max of the histogram.
+	 */
+	void dump() const;
+	
+	/**
+	 * \brief Logs all histograms with at least one recorded value.
+	 *
+	 * \param clear if \c true, the histograms are reset after being logged
+	 */
+	static void dumpAll(bool clear = false);
+	
+	/**
+	 * \brief Returns all histograms with at least one recorded value.
+	 *
+	 * \note The histograms must not be destroyed while the result is used.
+	 */
+	static vector<LatencyHistogram*> getAll();
+	
+	/**
+	 * \brief Resets all histograms.
+	 */
+	static void clearAll();
+	
+	/**
+	 * \brief Returns monotonic time in nanoseconds.
+	 */
+	static inline uint64_t now()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+	}
+};
+
+
+/**
+ * \brief Measures consecutive intervals and records them to histograms.
+ */
+class LatencyTimer {
+private:
+	uint64_t start_;
+
+public:
+	LatencyTimer() : start_(LatencyHistogram::now()) {}
+	
+	void restart() { start_ = LatencyHistogram::now(); }
+	
+	/**
+	 * \brief Records the time since the last lap (or construction) and starts a new lap.
+	 */
+	inline void lap(LatencyHistogram &histogram)
+	{
+		uint64_t t = LatencyHistogram::now();
+		histogram.add(t - start_);
+		start_ = t;
+	}
+};
+
+
+#endif /* end of include guard: LATENCYHISTOGRAM_W3NX0EQF */
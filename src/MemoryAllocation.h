@@ -0,0 +1,266 @@
+/**
+ * \file   MemoryAllocation.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Allocation of large buffers with a configurable policy.
+ */
+
+#ifndef MEMORYALLOCATION_K2JD7WQE
+#define MEMORYALLOCATION_K2JD7WQE
+
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+
+/**
+ * \brief Describes how a large buffer (for example a \ref RingBuffer2D chunk) is allocated.
+ *
+ * By default, the memory is allocated on the heap, aligned to a cache line
+ * and the pages are faulted in on first access. This is fine for small
+ * buffers, but the page faults of buffers of hundreds of megabytes land
+ * on the processing thread during the first minutes of the run. Other
+ * options map the memory directly:
+ *
+ *  - \c hugePages requests transparent (\c madvise) or explicit
+ *    (\c MAP_HUGETLB) huge pages, which reduces TLB misses. Explicit huge
+ *    pages must be reserved by the system administrator; if there are not
+ *    enough of them, normal pages are used instead.
+ *  - \c populate pre-faults all the pages when the buffer is allocated.
+ *  - \c lock locks the pages in RAM (\c mlock), so they are never swapped
+ *    out. The limit of locked memory (\c ulimit -l) must be large enough.
+ */
+struct AllocationPolicy {
+	enum HugePages {
+		HUGE_PAGES_NONE,
+		HUGE_PAGES_TRANSPARENT,
+		HUGE_PAGES_EXPLICIT
+	};
+	
+	HugePages hugePages;
+	bool      populate;  ///< pre-fault the memory when allocating it
+	bool      lock;      ///< lock the memory in RAM
+	size_t    alignment; ///< alignment of heap allocations in bytes
+	
+	AllocationPolicy() :
+		hugePages(HUGE_PAGES_NONE),
+		populate(false),
+		lock(false),
+		alignment(64)
+	{}
+	
+	/**
+	 * \brief Returns \c true if the memory is mapped directly instead of allocated on the heap.
+	 */
+	bool isMapped() const
+	{
+		return (hugePages != HUGE_PAGES_NONE) || populate || lock;
+	}
+	
+	/**
+	 * \brief Returns the actual size of an allocation of \c size bytes.
+	 *
+	 * Mappings are rounded up to whole pages. Only explicit huge pages
+	 * are mapped whole, so callers using huge pages should choose sizes
+	 * that fill them (see \ref RingBuffer2D::resize).
+	 */
+	size_t roundSize(size_t size) const
+	{
+		if (!isMapped()) return size;
+		
+		size_t page = (hugePages == HUGE_PAGES_EXPLICIT) ?
+			(size_t)HUGE_PAGE_SIZE :
+			(size_t)sysconf(_SC_PAGESIZE);
+		return ((size + page - 1) / page) * page;
+	}
+	
+	/**
+	 * \brief Parses huge page mode from a string ("none", "transparent" or "explicit").
+	 */
+	static HugePages parseHugePages(const string &value)
+	{
+		if (value == "transparent") return HUGE_PAGES_TRANSPARENT;
+		if (value == "explicit")    return HUGE_PAGES_EXPLICIT;
+		if (value != "none") {
+			LOG_WARNING("Unknown huge page mode \"" << value << "\", huge pages are not used.");
+		}
+		return HUGE_PAGES_NONE;
+	}
+};
+
+
+/**
+ * \brief Allocates \c size bytes according to \c policy.
+ *
+ * \returns pointer to the allocated memory or \c NULL on failure
+ */
+inline void* allocateMemory(size_t size, const AllocationPolicy &policy)
+{
+	if (size == 0) return NULL;
+	
+	if (!policy.isMapped()) {
+		void *result = NULL;
+		if (posix_memalign(&result, policy.alignment, size) != 0)
+			return NULL;
+		return result;
+	}
+	
+	size_t mappedSize = policy.roundSize(size);
+	int    flags      = MAP_PRIVATE | MAP_ANONYMOUS;
+	
+	// Transparent huge pages are only used for pages faulted in after
+	// madvise(), so MAP_POPULATE would fault in normal pages.
+	if (policy.populate && (policy.hugePages != AllocationPolicy::HUGE_PAGES_TRANSPARENT))
+		flags |= MAP_POPULATE;
+	
+	void *result = MAP_FAILED;
+	
+#ifdef MAP_HUGETLB
+	if (policy.hugePages == AllocationPolicy::HUGE_PAGES_EXPLICIT) {
+		result = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+		if (result == MAP_FAILED) {
+			LOG_WARNING("Failed to allocate " << mappedSize << " B in explicit huge pages (" <<
+					  strerror(errno) << "), using normal pages.");
+		}
+	}
+#endif
+	
+	if (result == MAP_FAILED)
+		result = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (result == MAP_FAILED) {
+		LOG_ERROR("Failed to map " << mappedSize << " B of memory: " << strerror(errno));
+		return NULL;
+	}
+	
+#ifdef MADV_HUGEPAGE
+	if (policy.hugePages == AllocationPolicy::HUGE_PAGES_TRANSPARENT)
+		madvise(result, mappedSize, MADV_HUGEPAGE);
+#endif
+	
+	if (policy.populate && (policy.hugePages == AllocationPolicy::HUGE_PAGES_TRANSPARENT))
+		memset(result, 0, mappedSize);
+	
+	if (policy.lock && (mlock(result, mappedSize) != 0)) {
+		LOG_WARNING("Failed to lock " << mappedSize << " B of memory in RAM: " <<
+				  strerror(errno));
+	}
+	
+	return result;
+}
+
+
+/**
+ * \brief Frees memory allocated by \ref allocateMemory with the same \c size and \c policy.
+ */
+inline void freeMemory(void *ptr, size_t size, const AllocationPolicy &policy)
+{
+	if (ptr == NULL) return;
+	
+	if (!policy.isMapped()) {
+		free(ptr);
+		return;
+	}
+	
+	munmap(ptr, policy.roundSize(size));
+}
+
+
+/**
+ * \brief Maps a new temporary file of \c size bytes created in \c directory.
+ *
+ * The file is unlinked right after it is created, so it never outlives
+ * the process. Its pages are written back to the disk by the kernel and
+ * may be evicted from RAM when not used.
+ *
+ * \param directory directory to create the file in
+ * \param size      size of the mapping in bytes (a multiple of the page size)
+ * \param fd        receives the descriptor of the file
+ * \returns pointer to the mapping or \c NULL on failure
+ */
+inline void* mapTemporaryFile(const string &directory, size_t size, int *fd)
+{
+	string path = directory + "/radio-observer-XXXXXX";
+	vector<char> name(path.begin(), path.end());
+	name.push_back('\0');
+	
+	*fd = mkstemp(&(name[0]));
+	if (*fd < 0) {
+		LOG_ERROR("Failed to create a buffer file in \"" << directory << "\": " << strerror(errno));
+		return NULL;
+	}
+	unlink(&(name[0]));
+	
+	if (ftruncate(*fd, size) != 0) {
+		LOG_ERROR("Failed to resize a buffer file to " << size << " B: " << strerror(errno));
+		close(*fd);
+		*fd = -1;
+		return NULL;
+	}
+	
+	void *result = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+	if (result == MAP_FAILED) {
+		LOG_ERROR("Failed to map a buffer file of " << size << " B: " << strerror(errno));
+		close(*fd);
+		*fd = -1;
+		return NULL;
+	}
+	
+	return result;
+}
+
+
+/**
+ * \brief Unmaps a file mapped by \ref mapTemporaryFile.
+ */
+inline void unmapFile(void *ptr, size_t size, int fd)
+{
+	if (ptr != NULL) munmap(ptr, size);
+	if (fd >= 0) close(fd);
+}
+
+
+/**
+ * \brief Hints that a range of a file mapping is going to be written soon.
+ */
+inline void prefetchMappedRange(void *ptr, size_t size)
+{
+	madvise(ptr, size, MADV_WILLNEED);
+}
+
+
+/**
+ * \brief Writes a range of a file mapping back and releases its pages.
+ *
+ * Waits for the writeback, so it must not be called from a real-time
+ * thread. The data stay in the file and are read back on access.
+ *
+ * \param fd     descriptor of the mapped file
+ * \param ptr    start of the range in the mapping
+ * \param offset offset of the range in the file
+ * \param size   size of the range
+ */
+inline void releaseMappedRange(int fd, void *ptr, size_t offset, size_t size)
+{
+	// Only clean pages can be dropped from the page cache.
+	msync(ptr, size, MS_SYNC);
+	madvise(ptr, size, MADV_DONTNEED);
+	posix_fadvise(fd, offset, size, POSIX_FADV_DONTNEED);
+}
+
+
+#endif /* end of include guard: MEMORYALLOCATION_K2JD7WQE */
@@ -0,0 +1,39 @@
+/**
+ * \file   MetricsAgent.cpp
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Implementation file for the MetricsAgent class.
+ */
+
+#include "MetricsAgent.h"
+#include "LatencyHistogram.h"
+#include "WaterfallBackend.h"
+
+#include <unistd.h>
+
+
+volatile sig_atomic_t MetricsAgent::dumpRequested_ = 0;
+volatile sig_atomic_t MetricsAgent::snapshotDumpRequested_ = 0;
+
+
+bool MetricsAgent::runCycle()
+{
+	usleep(POLL_INTERVAL * 1000);
+	
+	if (dumpRequested_) {
+		dumpRequested_ = 0;
+		LatencyHistogram::dumpAll();
+		SnapshotWriterPool::getInstance().dump();
+	}
+	
+	elapsed_ += POLL_INTERVAL;
+	if (snapshotDumpRequested_ || ((interval_ > 0) && (elapsed_ >= interval_ * 1000))) {
+		snapshotDumpRequested_ = 0;
+		elapsed_ = 0;
+		LatencyHistogram::dumpAll(true);
+		SnapshotWriterPool::getInstance().dump(true);
+	}
+	
+	return true;
+}
@@ -0,0 +1,71 @@
+/**
+ * \file   MetricsAgent.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the MetricsAgent class.
+ */
+
+#ifndef METRICSAGENT_Q2VX8LDN
+#define METRICSAGENT_Q2VX8LDN
+
+
+#include <csignal>
+
+#include "Agent.h"
+
+
+/**
+ * \brief Agent logging the latency histograms and the state of the
+ *        snapshot writer queue periodically and on request.
+ *
+ * The histograms and the queue statistics are logged and reset whenever
+ * a recorder completes a snapshot (see \ref requestSnapshotDump) and every
+ * \c interval seconds, so they are reported even without snapshots.
+ * Snapshots completed within one \ref POLL_INTERVAL share a dump.
+ *
+ * Logging allocates and takes locks, so it must not be done in a signal
+ * handler. The handler only calls \ref requestDump and the agent's thread
+ * notices the request within \ref POLL_INTERVAL.
+ */
+class MetricsAgent : public Agent {
+private:
+	MetricsAgent(const MetricsAgent& other);
+	
+	static volatile sig_atomic_t dumpRequested_;
+	static volatile sig_atomic_t snapshotDumpRequested_;
+	
+	int interval_; ///< In seconds, 0 disables the periodic dumps.
+	int elapsed_;  ///< Milliseconds since the last periodic dump.
+
+protected:
+	virtual bool runCycle();
+
+public:
+	static const int POLL_INTERVAL = 100; ///< In milliseconds.
+	
+	MetricsAgent(int interval) :
+		interval_(interval), elapsed_(0)
+	{}
+	virtual ~MetricsAgent() {}
+	
+	virtual string getName() { return "metrics"; }
+	
+	/**
+	 * \brief Asks the agent to log the histograms.
+	 *
+	 * Only sets a flag, so it is safe to call from a signal handler.
+	 */
+	static void requestDump() { dumpRequested_ = 1; }
+	
+	/**
+	 * \brief Asks the agent to log and reset the histograms at the end of
+	 *        a snapshot.
+	 *
+	 * Only sets a flag, so it is safe to call from the FFT thread.
+	 */
+	static void requestSnapshotDump() { snapshotDumpRequested_ = 1; }
+};
+
+
+#endif /* end of include guard: METRICSAGENT_Q2VX8LDN */
@@ -0,0 +1,188 @@
+/**
+ * \file   OverviewRecorder.cpp
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Implementation file for the OverviewRecorder class.
+ */
+
+#include "OverviewRecorder.h"
+
+
+/**
+ * Adds bins \ref leftBin_ -- \ref rightBin_ of an encoded FFT row to
+ * \ref accumulator_.
+ */
+void OverviewRecorder::accumulate(const uint8_t *row)
+{
+	rowCodec_->decode(row, leftBin_, rightBin_, &(values_[0]));
+	
+	const float *values = &(values_[leftBin_]);
+	int          width  = rightBin_ - leftBin_;
+	
+	for (int bin = 0; bin < width; bin++) {
+		float &output = accumulator_[bin / freqDecimation_];
+		
+		// The magnitudes are never negative, so the maximum can start
+		// from zero too.
+		if (mode_ == DECIMATE_MAX) {
+			if (values[bin] > output)
+				output = values[bin];
+		} else {
+			output += values[bin];
+		}
+	}
+	
+	accumulated_++;
+}
+
+
+/**
+ * Turns \ref accumulator_ to the decimated row, encodes it to
+ * \ref encoded_ and resets the accumulator.
+ */
+void OverviewRecorder::finishRow()
+{
+	int width       = rightBin_ - leftBin_;
+	int outputWidth = getOutputWidth();
+	
+	if (mode_ == DECIMATE_MEAN) {
+		for (int i = 0; i < outputWidth; i++) {
+			// The last bin may merge less than freqDecimation_ bins.
+			int bins = min(freqDecimation_, width - i * freqDecimation_);
+			accumulator_[i] /= (float)(bins * accumulated_);
+		}
+	}
+	
+	RowCodec(rowCodec_->getFormat(), outputWidth).encode(&(accumulator_[0]), &(encoded_[0]));
+	
+	fill(accumulator_.begin(), accumulator_.end(), 0.0f);
+	accumulated_ = 0;
+}
+
+
+/**
+ * Called by \ref SnapshotWriterPool threads, one snapshot of this
+ * recorder at a time.
+ */
+void OverviewRecorder::write(Snapshot snapshot)
+{
+	int      outputWidth = getOutputWidth();
+	RowCodec codec(rowCodec_->getFormat(), outputWidth);
+	
+	if ((int)accumulator_.size() != outputWidth) {
+		values_.assign(rowCodec_->getWidth(), 0.0f);
+		accumulator_.assign(outputWidth, 0.0f);
+		encoded_.assign(codec.getRowSize(), 0);
+		accumulated_ = 0;
+	}
+	
+	// A partially integrated row is only continued by the adjacent
+	// snapshot, otherwise it is dropped.
+	if ((accumulated_ > 0) && (snapshot.start != next_)) {
+		LOG_WARNING("Overview: snapshots are not contiguous, dropping " << accumulated_ << " rows.");
+		fill(accumulator_.begin(), accumulator_.end(), 0.0f);
+		accumulated_ = 0;
+	}
+	next_ = snapshot.end();
+	
+	double rowRate    = backend_->getFFTSampleRate();
+	int    outputRows = (accumulated_ + snapshot.length) / timeDecimation_;
+	WFTime chunkTime  = (accumulated_ > 0) ? accumulatedTime_ : getRowTime(snapshot.start);
+	
+	bool writing = (outputRows > 0) &&
+		prepareFile(chunkTime, codec, rowRate / (double)timeDecimation_);
+	if (writing)
+		writer_.beginChunk(outputRows, chunkTime, leftFrequency_,
+					    backend_->binToFrequency() * freqDecimation_);
+	
+	int rowSize  = buffer_->getWidth();
+	int rowIndex = buffer_->mark(snapshot.start);
+	int output   = 0;
+	
+	for (int y = 0; y < snapshot.length; ) {
+		int      rows;
+		uint8_t *data = buffer_->span(rowIndex, snapshot.length - y, &rows);
+		
+		for (int i = 0; i < rows; i++) {
+			if (accumulated_ == 0)
+				accumulatedTime_ = getRowTime(snapshot.start + (y + i));
+			
+			accumulate(data + i * rowSize);
+			if (accumulated_ < timeDecimation_)
+				continue;
+			
+			finishRow();
+			if (writing) {
+				memcpy(writer_.getRow(output), codec.getSamples(&(encoded_[0])),
+					  outputWidth * codec.getSampleSize());
+				if (codec.isLog())
+					writer_.setScale(output, codec.getScale(&(encoded_[0])));
+			}
+			output++;
+		}
+		
+		y        += rows;
+		rowIndex += rows;
+	}
+	
+	if (writing)
+		writer_.endChunk();
+}
+
+
+/**
+ * The config values this method expects in \c parent are:
+ * \li \c output_dir
+ * \li \c output_type
+ * \li \c chunk_length (seconds)
+ * \li \c file_length (seconds)
+ * \li \c chunk_compression ("none" or "zlib")
+ * \li \c time_decimation (FFT rows per row)
+ * \li \c freq_decimation (bins per bin)
+ * \li \c decimation ("mean" or "max")
+ * \li \c low_freq
+ * \li \c hi_freq
+ */
+Ref<DIObject> OverviewRecorder::make(Ref<DynObject> config, Ref<DIObject> parent)
+{
+	string outputDir   = config->getStrString("output_dir", ".");
+	string outputType  = config->getStrString("output_type", "overview");
+	
+	int    chunkLength = config->getStrInt("chunk_length", 60);
+	int    fileLength  = config->getStrInt("file_length", 86400);
+	string codecName   = config->getStrString("chunk_compression", "zlib");
+	
+	int    timeDecimation = config->getStrInt("time_decimation", 10);
+	int    freqDecimation = config->getStrInt("freq_decimation", 10);
+	string modeName       = config->getStrString("decimation", "mean");
+	
+	float  leftFrequency  = config->getStrDouble("low_freq", 0);
+	float  rightFrequency = config->getStrDouble("hi_freq",  0);
+	
+	ChunkCodec codec = CHUNK_ZLIB;
+	if (!ChunkFileWriter::parseCodec(codecName, &codec))
+		LOG_WARNING("Unknown chunk compression \"" << codecName << "\", using \"zlib\".");
+	
+	DecimationMode mode = DECIMATE_MEAN;
+	if (modeName == "max")
+		mode = DECIMATE_MAX;
+	else if (modeName != "mean")
+		LOG_WARNING("Unknown decimation \"" << modeName << "\", using \"mean\".");
+	
+	return new OverviewRecorder(
+		parent,
+		chunkLength,
+		max(fileLength, 1),
+		leftFrequency,
+		rightFrequency,
+		outputDir,
+		outputType,
+		codec,
+		max(timeDecimation, 1),
+		max(freqDecimation, 1),
+		mode
+	);
+}
+
+CPPAPP_DI_METHOD("overview", OverviewRecorder, make);
@@ -0,0 +1,93 @@
+/**
+ * \file   OverviewRecorder.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the OverviewRecorder class.
+ */
+
+#ifndef OVERVIEWRECORDER_P4WB8QZN
+#define OVERVIEWRECORDER_P4WB8QZN
+
+
+#include "ChunkRecorder.h"
+
+
+/**
+ * \brief Recorder for \ref WaterfallBackend class that records a decimated
+ *        overview of the waterfall to chunked waterfall files.
+ *
+ * Every \c timeDecimation consecutive FFT rows are integrated to one row and
+ * every \c freqDecimation neighbouring bins are merged to one bin, either by
+ * taking their mean or their maximum (see \ref DecimationMode). The
+ * decimated rows are stored in the format of the backend's rows (see
+ * \ref RowCodec), one chunk per snapshot, so with the default file length
+ * a compact file covers a whole day.
+ *
+ * Rows not completing a decimated row are carried over to the next
+ * snapshot.
+ */
+class OverviewRecorder : public ChunkRecorder {
+public:
+	enum DecimationMode {
+		DECIMATE_MEAN,
+		DECIMATE_MAX
+	};
+
+private:
+	/**
+	 * Copy constructor.
+	 */
+	OverviewRecorder(const OverviewRecorder& other);
+
+protected:
+	int            timeDecimation_; ///< Number of FFT rows integrated to one row.
+	int            freqDecimation_; ///< Number of bins merged to one bin.
+	DecimationMode mode_;
+	
+	vector<float> values_;      ///< Decoded FFT row.
+	vector<float> accumulator_; ///< Decimated bins of the row being integrated.
+	vector<uint8_t> encoded_;   ///< Encoded decimated row (see \ref RowCodec::encode).
+	int           accumulated_; ///< Number of FFT rows in \ref accumulator_.
+	WFTime        accumulatedTime_; ///< Time of the first FFT row in \ref accumulator_.
+	Cursor        next_;        ///< Position of the row following the last written snapshot.
+	
+	int  getOutputWidth() const { return (rightBin_ - leftBin_ + freqDecimation_ - 1) / freqDecimation_; }
+	void accumulate(const uint8_t *row);
+	void finishRow();
+	
+	/**
+	 * \brief Returns the time of the FFT row at \c row.
+	 *
+	 * The raw data handle of a row is stored at the position following
+	 * the row (the head after pushing it), so \ref getTime(row) would
+	 * return the time of the previous row.
+	 */
+	WFTime getRowTime(Cursor row) { return getTime(row + 1); }
+	
+	virtual void write(Snapshot snapshot);
+
+public:
+	OverviewRecorder(Ref<WaterfallBackend> backend,
+				  int                   chunkLength,
+				  int                   fileLength,
+				  float                 leftFrequency,
+				  float                 rightFrequency,
+				  string                outputDir,
+				  string                outputType,
+				  ChunkCodec            codec,
+				  int                   timeDecimation,
+				  int                   freqDecimation,
+				  DecimationMode        mode) :
+		ChunkRecorder(backend, chunkLength, fileLength, leftFrequency, rightFrequency, outputDir, outputType, codec),
+		timeDecimation_(timeDecimation),
+		freqDecimation_(freqDecimation),
+		mode_(mode),
+		accumulated_(0)
+	{}
+	
+	static Ref<DIObject> make(Ref<DynObject> config, Ref<DIObject> parent);
+};
+
+
+#endif /* end of include guard: OVERVIEWRECORDER_P4WB8QZN */
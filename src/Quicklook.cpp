@@ -0,0 +1,108 @@
+/**
+ * \file   Quicklook.cpp
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Implementation file for the Quicklook class.
+ */
+
+#include "Quicklook.h"
+#include "utils.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+
+
+/**
+ * \brief Stores \c value in big endian byte order (as used by PNG).
+ */
+static uint8_t* putBE32(uint8_t *dest, uint32_t value)
+{
+	dest[0] = (uint8_t)(value >> 24);
+	dest[1] = (uint8_t)(value >> 16);
+	dest[2] = (uint8_t)(value >> 8);
+	dest[3] = (uint8_t)value;
+	return dest + 4;
+}
+
+
+/**
+ * \brief Writes a PNG chunk (length, type, data and CRC of type and data).
+ */
+static bool writePNGChunk(FILE *file, const char *type, const uint8_t *data, uint32_t size)
+{
+	uint8_t header[8];
+	putBE32(header, size);
+	memcpy(header + 4, type, 4);
+	
+	uint32_t crc = crc32(0L, Z_NULL, 0);
+	crc = crc32(crc, header + 4, 4);
+	if (size > 0)
+		crc = crc32(crc, data, size);
+	
+	uint8_t trailer[4];
+	putBE32(trailer, crc);
+	
+	return (fwrite(header, sizeof(header), 1, file) == 1) &&
+		((size == 0) || (fwrite(data, size, 1, file) == 1)) &&
+		(fwrite(trailer, sizeof(trailer), 1, file) == 1);
+}
+
+
+/**
+ * The image is stored as 8-bit RGB without interlacing. Every scanline
+ * uses no filter, which compresses well enough for the smooth images
+ * and keeps encoding cheap.
+ */
+bool Quicklook::writePNG(const string &fileName) const
+{
+	static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	
+	if (rgb_.empty())
+		return false;
+	
+	// Scanlines prefixed by their filter type (0 = none).
+	int             lineSize = imageWidth_ * 3;
+	vector<uint8_t> raw((lineSize + 1) * imageHeight_);
+	for (int y = 0; y < imageHeight_; y++) {
+		raw[y * (lineSize + 1)] = 0;
+		memcpy(&(raw[y * (lineSize + 1) + 1]), &(rgb_[y * lineSize]), lineSize);
+	}
+	
+	uLongf          compressedSize = compressBound(raw.size());
+	vector<uint8_t> compressed(compressedSize);
+	if (compress2(&(compressed[0]), &compressedSize, &(raw[0]), raw.size(), 6) != Z_OK) {
+		LOG_ERROR("Failed to compress quicklook image \"" << fileName << "\".");
+		return false;
+	}
+	
+	uint8_t header[13];
+	uint8_t *p = header;
+	p = putBE32(p, imageWidth_);
+	p = putBE32(p, imageHeight_);
+	*(p++) = 8; // bit depth
+	*(p++) = 2; // color type: RGB
+	*(p++) = 0; // compression: deflate
+	*(p++) = 0; // filter method
+	*(p++) = 0; // interlace: none
+	
+	FILE *file = fopen(fileName.c_str(), "wb");
+	if (file == NULL) {
+		LOG_ERROR("Failed to create \"" << fileName << "\": " << strerror(errno) << ".");
+		return false;
+	}
+	
+	bool ok = (fwrite(SIGNATURE, sizeof(SIGNATURE), 1, file) == 1) &&
+		writePNGChunk(file, "IHDR", header, sizeof(header)) &&
+		writePNGChunk(file, "IDAT", &(compressed[0]), compressedSize) &&
+		writePNGChunk(file, "IEND", NULL, 0);
+	
+	if ((fclose(file) != 0) || !ok) {
+		LOG_ERROR("Failed to write to \"" << fileName << "\": " << strerror(errno) << ".");
+		return false;
+	}
+	
+	return true;
+}
@@ -0,0 +1,282 @@
+/**
+ * \file   Quicklook.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the Quicklook class.
+ */
+
+#ifndef QUICKLOOK_H8MZ2RQV
+#define QUICKLOOK_H8MZ2RQV
+
+
+#include <stdint.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+
+/**
+ * \brief Colormaps of \ref Quicklook images.
+ */
+enum Colormap {
+	COLORMAP_GRAY, ///< black to white
+	COLORMAP_HOT,  ///< black, red, yellow, white
+	COLORMAP_JET   ///< dark blue, blue, cyan, yellow, red, dark red
+};
+
+
+/**
+ * \brief Renders a waterfall to a small false color PNG image.
+ *
+ * The rows of the waterfall are passed by \ref addRow. They are
+ * downsampled by averaging blocks of bins so that the image fits within
+ * the maximal size: the rows are summed up into a full width accumulator
+ * and every complete block of rows is then reduced horizontally. \ref render
+ * takes the logarithm of the magnitudes, scales them linearly between two
+ * percentiles of the image and maps them to colors through a 256 entry
+ * lookup table. \ref writePNG encodes the result.
+ */
+class Quicklook {
+private:
+	bool     enabled_;
+	int      maxWidth_;
+	int      maxHeight_;
+	float    lowPercentile_;
+	float    highPercentile_;
+	Colormap colormap_;
+	
+	int width_;   ///< Width of the waterfall in bins.
+	int factorX_; ///< Bins per pixel.
+	int factorY_; ///< Rows per pixel.
+	int imageWidth_;
+	int imageHeight_;
+	
+	vector<float>   sums_;      ///< Sums of the bins of the rows of the current block.
+	int             sumRows_;   ///< Number of rows in \ref sums_.
+	int             y_;         ///< Image row the current block belongs to.
+	vector<float>   image_;     ///< Mean magnitudes of the pixels.
+	vector<float>   sorted_;    ///< Copy of the image for percentile selection.
+	vector<uint8_t> lut_;       ///< RGB colors of 256 levels.
+	vector<uint8_t> rgb_;       ///< Rendered image, RGB pixels.
+	
+	void buildLUT()
+	{
+		// Colors at evenly spaced positions along the colormap.
+		static const uint8_t GRAY[] = { 0, 0, 0,  255, 255, 255 };
+		static const uint8_t HOT[]  = { 0, 0, 0,  255, 0, 0,  255, 255, 0,  255, 255, 255 };
+		static const uint8_t JET[]  = { 0, 0, 128,  0, 0, 255,  0, 255, 255,
+		                                255, 255, 0,  255, 0, 0,  128, 0, 0 };
+		
+		const uint8_t *points;
+		int            count;
+		switch (colormap_) {
+		case COLORMAP_HOT: points = HOT; count = sizeof(HOT) / 3; break;
+		case COLORMAP_JET: points = JET; count = sizeof(JET) / 3; break;
+		default:           points = GRAY; count = sizeof(GRAY) / 3; break;
+		}
+		
+		lut_.resize(256 * 3);
+		for (int i = 0; i < 256; i++) {
+			float position = (float)i / 255.0f * (float)(count - 1);
+			int   index    = min((int)position, count - 2);
+			float t        = position - (float)index;
+			
+			for (int c = 0; c < 3; c++) {
+				float a = points[index * 3 + c];
+				float b = points[(index + 1) * 3 + c];
+				lut_[i * 3 + c] = (uint8_t)(a + (b - a) * t + 0.5f);
+			}
+		}
+	}
+	
+	/**
+	 * \brief Reduces \ref sums_ horizontally to the current image row.
+	 */
+	void finishBlock()
+	{
+		if (sumRows_ == 0)
+			return;
+		
+		float *output = &(image_[y_ * imageWidth_]);
+		for (int x = 0; x < imageWidth_; x++) {
+			int from = x * factorX_;
+			int to   = min(from + factorX_, width_);
+			
+			float sum = 0.0f;
+			for (int i = from; i < to; i++)
+				sum += sums_[i];
+			output[x] = sum / (float)((to - from) * sumRows_);
+		}
+		
+		fill(sums_.begin(), sums_.end(), 0.0f);
+		sumRows_ = 0;
+		y_++;
+	}
+	
+	/**
+	 * \brief Returns the \c percentile-th percentile of the first \c count
+	 *        items of \ref sorted_ (reorders them).
+	 */
+	float percentile(int count, float percentile)
+	{
+		int index = (int)((float)(count - 1) * percentile / 100.0f + 0.5f);
+		index = max(0, min(index, count - 1));
+		nth_element(sorted_.begin(), sorted_.begin() + index, sorted_.begin() + count);
+		return sorted_[index];
+	}
+
+public:
+	Quicklook() :
+		enabled_(false),
+		maxWidth_(1024), maxHeight_(1024),
+		lowPercentile_(5.0f), highPercentile_(99.5f),
+		colormap_(COLORMAP_HOT),
+		width_(0), factorX_(1), factorY_(1), imageWidth_(0), imageHeight_(0),
+		sumRows_(0), y_(0)
+	{}
+	
+	/**
+	 * \brief Constructor.
+	 *
+	 * \param maxWidth       maximal width of the image in pixels
+	 * \param maxHeight      maximal height of the image in pixels
+	 * \param lowPercentile  percentile of the magnitudes drawn with the first color
+	 * \param highPercentile percentile of the magnitudes drawn with the last color
+	 * \param colormap       colors of the image
+	 */
+	Quicklook(int maxWidth, int maxHeight, float lowPercentile, float highPercentile, Colormap colormap) :
+		enabled_(true),
+		maxWidth_(max(maxWidth, 1)), maxHeight_(max(maxHeight, 1)),
+		lowPercentile_(lowPercentile), highPercentile_(highPercentile),
+		colormap_(colormap),
+		width_(0), factorX_(1), factorY_(1), imageWidth_(0), imageHeight_(0),
+		sumRows_(0), y_(0)
+	{}
+	
+	bool isEnabled() const { return enabled_; }
+	
+	int getWidth()  const { return imageWidth_; }
+	int getHeight() const { return imageHeight_; }
+	
+	/**
+	 * \brief Returns the rendered image, \ref getWidth() x \ref getHeight()
+	 *        RGB pixels (see \ref render).
+	 */
+	const uint8_t* getPixels() const { return &(rgb_[0]); }
+	
+	/**
+	 * \brief Parses a colormap name ("gray", "hot" or "jet").
+	 *
+	 * \returns \c false if the name is unknown
+	 */
+	static bool parseColormap(const string &name, Colormap *colormap)
+	{
+		if (name == "gray")
+			*colormap = COLORMAP_GRAY;
+		else if (name == "hot")
+			*colormap = COLORMAP_HOT;
+		else if (name == "jet")
+			*colormap = COLORMAP_JET;
+		else
+			return false;
+		return true;
+	}
+	
+	/**
+	 * \brief Starts a new image of a waterfall of \c width bins and
+	 *        \c height rows.
+	 */
+	void begin(int width, int height)
+	{
+		width_       = max(width, 1);
+		factorX_     = (width_ + maxWidth_ - 1) / maxWidth_;
+		factorY_     = (max(height, 1) + maxHeight_ - 1) / maxHeight_;
+		imageWidth_  = (width_ + factorX_ - 1) / factorX_;
+		imageHeight_ = (max(height, 1) + factorY_ - 1) / factorY_;
+		
+		sums_.assign(width_, 0.0f);
+		image_.assign(imageWidth_ * imageHeight_, 0.0f);
+		sumRows_ = 0;
+		y_       = 0;
+	}
+	
+	/**
+	 * \brief Adds the next row of magnitudes of the waterfall.
+	 */
+	void addRow(const float *values)
+	{
+		if (y_ >= imageHeight_)
+			return;
+		
+		// Four bins at a time with GCC vector extensions, which compile to
+		// SIMD instructions (SSE, NEON) even without optimization. The
+		// rows are not aligned, hence the reduced alignment.
+		typedef float Float4 __attribute__((vector_size(16), aligned(4)));
+		
+		float *sums = &(sums_[0]);
+		int    i    = 0;
+		for (; i + 4 <= width_; i += 4)
+			*(Float4*)(sums + i) += *(const Float4*)(values + i);
+		for (; i < width_; i++)
+			sums[i] += values[i];
+		
+		if (++sumRows_ == factorY_)
+			finishBlock();
+	}
+	
+	/**
+	 * \brief Renders the rows added since \ref begin to RGB pixels.
+	 */
+	void render()
+	{
+		finishBlock();
+		
+		if (lut_.empty())
+			buildLUT();
+		
+		// Logarithm of the magnitudes, zeros (no signal) are excluded
+		// from the percentiles and drawn with the first color.
+		int count = 0;
+		sorted_.resize(image_.size());
+		for (size_t i = 0; i < image_.size(); i++) {
+			if (image_[i] > 0.0f) {
+				image_[i] = log10f(image_[i]);
+				sorted_[count++] = image_[i];
+			} else {
+				image_[i] = (float)-HUGE_VAL;
+			}
+		}
+		
+		float low   = 0.0f;
+		float high  = 1.0f;
+		if (count > 0) {
+			low  = percentile(count, lowPercentile_);
+			high = percentile(count, highPercentile_);
+		}
+		float scale = (high > low) ? 255.0f / (high - low) : 0.0f;
+		
+		rgb_.resize(image_.size() * 3);
+		for (size_t i = 0; i < image_.size(); i++) {
+			float level = (image_[i] - low) * scale;
+			level = max(0.0f, min(level, 255.0f));
+			
+			const uint8_t *color = &(lut_[(int)level * 3]);
+			rgb_[i * 3]     = color[0];
+			rgb_[i * 3 + 1] = color[1];
+			rgb_[i * 3 + 2] = color[2];
+		}
+	}
+	
+	/**
+	 * \brief Writes the rendered image to a PNG file.
+	 *
+	 * \returns \c false if the file could not be written
+	 */
+	bool writePNG(const string &fileName) const;
+};
+
+
+#endif /* end of include guard: QUICKLOOK_H8MZ2RQV */
@@ -10,13 +10,21 @@
 #define RINGBUFFER_HSQMLSDG
 
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
+#include <new>
+#include <stdint.h>
+
+#include "MemoryAllocation.h"
 
 
 /**
  * \todo Write documentation for class RingBuffer.
  *
  * Items enter at the HEAD of the buffer and exit at the TAIL.
+ *
+ * Items are copied with \c memcpy, so \c T must be a plain data type.
  */
 template<class T>
 class RingBuffer {
@@ -28,7 +36,33 @@ private:
 	T   *head_;
 	int  size_;
 	
+	/**
+	 * Copies \c count items starting at index \c offset of the buffer
+	 * to \c dest, wrapping around the end of the buffer.
+	 */
+	inline void copyOut(int offset, T *dest, int count) const
+	{
+		int chunk = capacity_ - offset;
+		if (chunk > count) chunk = count;
+		
+		memcpy(dest, items_ + offset, sizeof(T) * chunk);
+		if (count > chunk)
+			memcpy(dest + chunk, items_, sizeof(T) * (count - chunk));
+	}
+	
+	inline int tail() const
+	{
+		int offset = (head_ - items_) - size_;
+		if (offset < 0) offset += capacity_;
+		return offset;
+	}
+	
 public:
+	/**
+	 * \brief Enlarges the buffer, keeping the items it holds.
+	 *
+	 * The buffer is never shrunk.
+	 */
 	void resize(int capacity)
 	{
 		if (capacity_ > capacity)
@@ -50,31 +84,15 @@ public:
 		//                                 |
 		//                                head
 		//
-		if (newSize > 0) {
-			int offset = normalize(head() - newSize);
-			int remaining = newSize;
-			
-			// Copy section 1
-			int chunk = capacity_ - offset;
-			if (chunk > remaining) chunk = remaining;
-			remaining -= chunk;
-			
-			for (int i = 0; i < chunk; i++)
-				newItems[i] = items_[offset + i];
-			
-			// Copy section 2
-			if (remaining > 0) {
-				for (int i = 0; i < remaining; i++)
-					newItems[chunk + i] = items_[i];
-			}
-		}
+		if (newSize > 0)
+			copyOut(tail(), newItems, newSize);
 		
 		// Clean up old items.
 		delete [] items_;
 		items_    = newItems;
 		capacity_ = capacity;
-		head_     = items_;
 		size_     = newSize;
+		head_     = items_ + ((newSize < capacity) ? newSize : 0);
 	}
 	
 	RingBuffer() :
@@ -155,7 +173,9 @@ public:
 	
 	inline int normalize(int mark)
 	{
-		return mark % capacity_;
+		mark = mark % capacity_;
+		if (mark < 0) mark += capacity_;
+		return mark;
 	}
 	
 	inline int head() { return head_ - items_; }
@@ -178,31 +198,69 @@ public:
 		if (size_ < capacity_) size_++;
 	}
 	
+	/**
+	 * \brief Pushes \c count items to the head of the buffer.
+	 *
+	 * The items are copied in at most two contiguous runs. If \c count is
+	 * larger than the capacity, only the last items are kept.
+	 */
 	inline void push(const T *items, int count)
 	{
+		if ((capacity_ < 1) || (count < 1)) return;
+		
 		// If pushing more items that the buffer can hold,
 		// clear the buffer and copy the last n items to the
 		// buffer.
 		if (count >= capacity_) {
-			clear();
-			int offset = count - capacity_;
-			for (int i = 0; i < capacity_; i++) {
-				items_[i] = items[offset + i];
-			}
+			memcpy(items_, items + (count - capacity_), sizeof(T) * capacity_);
+			head_ = items_;
+			size_ = capacity_;
 			return;
 		}
 		
-		// Otherwise, start copying the pushed items to the
-		// buffer at the head.
+		// Otherwise, copy the pushed items to the buffer at the
+		// head, wrapping around the end of the buffer.
 		int offset = head_ - items_;
-		for (int i = 0; i < count; i++) {
-			items_[offset] = items[i];
-			offset = (offset + 1) % capacity_;
-		}
+		int chunk  = capacity_ - offset;
+		if (chunk > count) chunk = count;
+		
+		memcpy(items_ + offset, items, sizeof(T) * chunk);
+		if (count > chunk)
+			memcpy(items_, items + chunk, sizeof(T) * (count - chunk));
+		
+		offset += count;
+		if (offset >= capacity_) offset -= capacity_;
 		head_ = items_ + offset;
+		
 		size_ += count;
 		if (size_ > capacity_) size_ = capacity_;
 	}
+	
+	/**
+	 * \brief Copies up to \c count oldest items (from the tail) to \c dest.
+	 *
+	 * \returns number of items copied
+	 */
+	inline int peek(T *dest, int count) const
+	{
+		if (count > size_) count = size_;
+		if (count < 1) return 0;
+		
+		copyOut(tail(), dest, count);
+		return count;
+	}
+	
+	/**
+	 * \brief Removes up to \c count oldest items (from the tail) and copies them to \c dest.
+	 *
+	 * \returns number of items removed
+	 */
+	inline int pop(T *dest, int count)
+	{
+		count = peek(dest, count);
+		size_ -= count;
+		return count;
+	}
 };
 
 
@@ -230,6 +288,21 @@ private:
 	int      chunkCount_;    //< Actual number of chunks.
 	pointer *chunks_;        //< Array of pointers to chunks.
 	
+	bool     powerOfTwo_;    //< Round chunk rows and chunk count to powers of two on resize.
+	int      rowShift_;      //< log2(chunkRows_), only valid in the power-of-two layout.
+	int      rowMask_;       //< chunkRows_ - 1, only valid in the power-of-two layout.
+	int      indexMask_;     //< capacity_ - 1, only valid in the power-of-two layout.
+	
+	AllocationPolicy policy_;          //< Allocation policy used by the next resize.
+	AllocationPolicy allocatedPolicy_; //< Allocation policy the current chunks were allocated with.
+	
+	string   backingDir_;     //< Directory of the backing file, empty if the buffer is kept in RAM.
+	int      residentChunks_; //< Number of recent chunks kept resident when file-backed.
+	int      backingFd_;      //< Descriptor of the backing file, -1 if not file-backed.
+	char    *backingBase_;    //< Start of the backing file mapping.
+	size_t   chunkStride_;    //< Distance between chunks in the backing file in bytes.
+	uint64_t agedChunks_;     //< Number of chunks entered by the head when \ref ageChunks last ran.
+	
 	struct ChunkItem {
 		//RingBuffer2D<T> *buffer;
 		pointer         *chunk; //< Points to an item in RingBuffer2D::chunks_.
@@ -287,7 +360,8 @@ private:
 			ChunkItem result = *this;
 			
 			result.index++;
-			result.index %= buffer.capacity_;
+			if (result.index >= buffer.capacity_)
+				result.index = 0;
 			result.generation++;
 			
 			result.item += buffer.width_;
@@ -305,6 +379,8 @@ private:
 	
 	ChunkItem head_;
 	int       size_;
+	uint64_t  pushCount_; //< Number of rows pushed since the last clear, updated atomically (see \ref Cursor).
+	uint64_t  published_; //< Number of rows visible to the readers, updated atomically (see \ref Cursor).
 	
 	//inline ChunkItem advance(const ChunkItem &item) const
 	//{
@@ -327,9 +403,15 @@ private:
 	{
 		if ((chunkCount_ < 1) || (chunks_ == NULL)) return; 
 		
-		for (pointer *chunk = chunks_; chunk < (chunks_ + chunkCount_); chunk++) {
-			delete [] *chunk;
-			*chunk = NULL;
+		if (backingBase_ != NULL) {
+			unmapFile(backingBase_, chunkStride_ * chunkCount_, backingFd_);
+			backingBase_ = NULL;
+			backingFd_   = -1;
+		} else {
+			for (pointer *chunk = chunks_; chunk < (chunks_ + chunkCount_); chunk++) {
+				freeMemory(*chunk, sizeof(T) * chunkElements_, allocatedPolicy_);
+				*chunk = NULL;
+			}
 		}
 		
 		delete [] chunks_;
@@ -357,28 +439,47 @@ private:
 	//	return (chunkIndex * chunkRows_) + itemIndex;
 	//}
 
-	inline int normalizeRowIndex(int value)
+	inline int normalizeRowIndex(int value) const
 	{
-		while (value < 0) {
-			value += capacity_;
-		}
+		if (powerOfTwo_)
+			return value & indexMask_;
 		
 		value = value % capacity_;
+		if (value < 0)
+			value += capacity_;
 		
 		return value;
 	}
+	
+	static inline int roundUpToPowerOfTwo(int value)
+	{
+		int result = 1;
+		while (result < value) result <<= 1;
+		return result;
+	}
+	
+	static inline int roundDownToPowerOfTwo(int value)
+	{
+		int result = 1;
+		while ((result << 1) <= value) result <<= 1;
+		return result;
+	}
 
 public:
 	RingBuffer2D() :
 		width_(0), minCapacity_(0), chunkSizeLimit_(0),
 		capacity_(0), chunkElements_(0), chunkRows_(0), chunkCount_(0), chunks_(NULL),
-		head_(), size_(0)
+		powerOfTwo_(false), rowShift_(0), rowMask_(0), indexMask_(0),
+		residentChunks_(0), backingFd_(-1), backingBase_(NULL), chunkStride_(0), agedChunks_(0),
+		head_(), size_(0), pushCount_(0), published_(0)
 	{}
 	
 	RingBuffer2D(int width, int chunkSize) :
 		width_(width), minCapacity_(0), chunkSizeLimit_(chunkSize),
 		capacity_(0), chunkElements_(0), chunkRows_(0), chunkCount_(0), chunks_(NULL),
-		head_(), size_(0)
+		powerOfTwo_(false), rowShift_(0), rowMask_(0), indexMask_(0),
+		residentChunks_(0), backingFd_(-1), backingBase_(NULL), chunkStride_(0), agedChunks_(0),
+		head_(), size_(0), pushCount_(0), published_(0)
 	{
 		int rowSize = sizeof(T) * width_;
 		chunkRows_ = chunkSizeLimit_ / rowSize;
@@ -390,7 +491,9 @@ public:
 	RingBuffer2D(int width, int chunkSize, int capacity) :
 		width_(width), minCapacity_(0), chunkSizeLimit_(chunkSize),
 		capacity_(0), chunkElements_(0), chunkRows_(0), chunkCount_(0), chunks_(NULL),
-		head_(), size_(0)
+		powerOfTwo_(false), rowShift_(0), rowMask_(0), indexMask_(0),
+		residentChunks_(0), backingFd_(-1), backingBase_(NULL), chunkStride_(0), agedChunks_(0),
+		head_(), size_(0), pushCount_(0), published_(0)
 	{
 		int rowSize = sizeof(T) * width_;
 		chunkRows_ = chunkSizeLimit_ / rowSize;
@@ -407,6 +510,7 @@ public:
 	}
 	
 	inline int getWidth()    const { return width_; }
+	inline int getChunkRows() const { return chunkRows_; }
 	inline int getCapacity() const { return capacity_; }
 	inline int getSize()     const { return size_; }
 	inline bool isEmpty()    const { return (size_ == 0); }
@@ -415,27 +519,157 @@ public:
 		return ((size_ >= capacity_) && (capacity_ > 0));
 	}
 	
+	inline bool isPowerOfTwo() const { return powerOfTwo_; }
+	
+	/**
+	 * \brief Selects the power-of-two layout for the next \ref resize.
+	 *
+	 * In the power-of-two layout, the number of rows in a chunk is rounded
+	 * down and the number of chunks is rounded up to a power of two, so
+	 * that row lookups (\ref at) use only shifts and masks instead of
+	 * divisions. This may almost double the allocated memory.
+	 */
+	void setPowerOfTwo(bool value) { powerOfTwo_ = value; }
+	
+	const AllocationPolicy& getAllocationPolicy() const { return policy_; }
+	/**
+	 * \brief Sets how the chunks are allocated by the next \ref resize.
+	 *
+	 * The buffer should only hold plain data types, because the chunks
+	 * are allocated as raw memory. The buffer should be resized outside
+	 * of the real-time processing thread, especially with the populate
+	 * or lock options, which fault in all the pages during the resize.
+	 */
+	void setAllocationPolicy(const AllocationPolicy &value) { policy_ = value; }
+	
+	/**
+	 * \brief Keeps the buffer data in a file instead of RAM from the next \ref resize.
+	 *
+	 * The chunks are mapped from a temporary file created in \c directory,
+	 * so that the buffer can hold much more history than fits in RAM.
+	 * Chunks more than \c residentChunks chunks behind the head are
+	 * written back to the disk and their pages released, while the chunk
+	 * after the head is read ahead. This is done by \ref ageChunks, which
+	 * a housekeeping thread must call periodically. Recent rows thus stay
+	 * in RAM and older rows are read back from the file when accessed.
+	 * Reservations work as usual.
+	 *
+	 * The allocation policy is ignored for file-backed buffers.
+	 *
+	 * \param directory      directory for the backing file, empty to keep the buffer in RAM
+	 * \param residentChunks number of recent chunks to keep in RAM
+	 */
+	void setBackingFile(const string &directory, int residentChunks)
+	{
+		backingDir_     = directory;
+		residentChunks_ = (residentChunks < 1) ? 1 : residentChunks;
+	}
+	
+	inline bool isFileBacked() const { return backingBase_ != NULL; }
+	
+	/**
+	 * \brief Ages the chunks of a file-backed buffer the head has entered
+	 *        since the last call (see \ref setBackingFile).
+	 *
+	 * The writer only counts the pushed rows, the system calls (which may
+	 * wait for the disk) are made by the calling thread. Only one thread
+	 * may call this method and not during \ref resize.
+	 */
+	void ageChunks()
+	{
+		if (backingBase_ == NULL) return;
+		
+		uint64_t entered = __sync_fetch_and_add(&pushCount_, 0) / chunkRows_;
+		if (entered == agedChunks_) return;
+		
+		// Read the chunk after the head's chunk ahead, so that writing it
+		// doesn't wait for the disk.
+		int current = (int)(entered % chunkCount_);
+		prefetchMappedRange(chunks_[(current + 1) % chunkCount_], chunkStride_);
+		
+		// Release the chunks left behind since the last call, but never
+		// the resident ones, even if the head went around meanwhile.
+		if (residentChunks_ < chunkCount_) {
+			uint64_t behind = chunkCount_ - residentChunks_;
+			uint64_t from   = max(agedChunks_, entered - min(entered, behind)) + 1;
+			for (uint64_t chunk = from; chunk <= entered; chunk++) {
+				if (chunk < (uint64_t)residentChunks_) continue;
+				
+				int old = (int)((chunk - residentChunks_) % chunkCount_);
+				releaseMappedRange(backingFd_, chunks_[old], chunkStride_ * old, chunkStride_);
+			}
+		}
+		
+		agedChunks_ = entered;
+	}
+	
+	/**
+	 * \brief Returns the number of bytes allocated for the buffer data.
+	 */
+	size_t getMemorySize() const
+	{
+		if (backingBase_ != NULL)
+			return chunkStride_ * chunkCount_;
+		return (size_t)chunkCount_ * allocatedPolicy_.roundSize(sizeof(T) * chunkElements_);
+	}
+	
 	void clear()
 	{
 		//head_       = ChunkItem(chunks_, chunks_[0]);
 		head_ = ChunkItem(*this);
 		size_ = 0;
+		
+		// Positions and reservations refer to the discarded data.
+		pushCount_  = 0;
+		published_  = 0;
+		agedChunks_ = 0;
+		reservations_.clear();
+		freeReservations_.clear();
 	}
 	
 	/**
 	 * \brief Resizes the ring buffer, discarding all current data in process.
+	 *
+	 * With huge pages (see \ref AllocationPolicy), the chunk size is
+	 * rounded up to whole huge pages and the chunks hold as many rows as
+	 * fit in them, so that no huge page is left mostly empty.
 	 */
 	void resize(int width, int chunkSize, int capacity)
+	{
+		int rowSize = sizeof(T) * width;
+		int chunkRows;
+		
+		if ((policy_.hugePages != AllocationPolicy::HUGE_PAGES_NONE) && backingDir_.empty()) {
+			int limit = ((chunkSize + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+			chunkRows = max(limit / rowSize, 1);
+		} else {
+			chunkRows = chunkSize / rowSize;
+			if ((chunkSize % rowSize) != 0) chunkRows++;
+		}
+		
+		resizeRows(width, chunkRows, capacity);
+		chunkSizeLimit_ = chunkSize;
+	}
+	
+	/**
+	 * \brief Resizes the ring buffer to chunks of \c chunkRows rows,
+	 *        discarding all current data in process.
+	 *
+	 * Buffers parallel to another buffer use this to get the same marks
+	 * for the same rows. In the power-of-two layout, \c chunkRows is still
+	 * rounded down to a power of two.
+	 */
+	void resizeRows(int width, int chunkRows, int capacity)
 	{
 		dispose();
 
 		width_          = width;
-		chunkSizeLimit_ = chunkSize;
+		chunkSizeLimit_ = sizeof(T) * width * chunkRows;
 		
 		// Calculate chunk metrics
-		int rowSize = sizeof(T) * width_;
-		chunkRows_ = chunkSizeLimit_ / rowSize;
-		if ((chunkSizeLimit_ % rowSize) != 0) chunkRows_++;
+		chunkRows_ = chunkRows;
+		if (powerOfTwo_)
+			chunkRows_ = roundDownToPowerOfTwo(chunkRows_);
 		
 		chunkElements_ = chunkRows_ * width;
 		
@@ -444,13 +678,48 @@ public:
 		
 		chunkCount_ = minCapacity_ / chunkRows_;
 		if ((minCapacity_ % chunkRows_) > 0) chunkCount_ += 1;
+		if (powerOfTwo_)
+			chunkCount_ = roundUpToPowerOfTwo(chunkCount_);
 		
 		capacity_ = chunkCount_ * chunkRows_;
 		
+		rowShift_ = 0;
+		while ((1 << rowShift_) < chunkRows_) rowShift_++;
+		rowMask_   = chunkRows_ - 1;
+		indexMask_ = capacity_ - 1;
+		
 		// Allocate memory
+		allocatedPolicy_ = policy_;
 		chunks_ = new pointer[chunkCount_];
+		
+		if (!backingDir_.empty()) {
+			size_t page = sysconf(_SC_PAGESIZE);
+			chunkStride_ = ((sizeof(T) * chunkElements_ + page - 1) / page) * page;
+			
+			backingBase_ = (char*)mapTemporaryFile(backingDir_, chunkStride_ * chunkCount_, &backingFd_);
+			if (backingBase_ == NULL) {
+				delete [] chunks_;
+				chunks_     = NULL;
+				chunkCount_ = 0;
+				capacity_   = 0;
+				throw std::bad_alloc();
+			}
+			
+			for (int i = 0; i < chunkCount_; i++)
+				chunks_[i] = (pointer)(backingBase_ + chunkStride_ * i);
+			
+			clear();
+			return;
+		}
+		
 		for (int i = 0; i < chunkCount_; i++) {
-			chunks_[i] = new T[chunkElements_];
+			chunks_[i] = (pointer)allocateMemory(sizeof(T) * chunkElements_, allocatedPolicy_);
+			if (chunks_[i] == NULL) {
+				// Free the chunks allocated so far (chunks_[i] is NULL).
+				chunkCount_ = i + 1;
+				dispose();
+				throw std::bad_alloc();
+			}
 		}
 		
 		clear();
@@ -487,45 +756,222 @@ public:
 		if (!isFull()) size_++;
 		assert(size_ <= capacity_);
 		
-		FOR_EACH(reservations_, it) {
-			if (it->alive && isInRange(mark(), it->start, it->end))
-				it->dirty = true;
-		}
+		// Readers must see the row claimed before it is written to, so
+		// that they can detect that it has been overwritten.
+		__sync_fetch_and_add(&pushCount_, 1);
 		
 		return result;
 	}
-	
+
+	/**
+	 * \brief Pushes a run of up to \c count contiguous rows at once.
+	 *
+	 * The run ends at the end of the chunk containing the head at the
+	 * latest (see \ref span), so bulk producers push \c count rows in a
+	 * few runs. The rows are claimed by a single atomic update, as if they
+	 * were pushed one by one by \ref push.
+	 *
+	 * \param count    maximal number of rows
+	 * \param spanRows receives the number of rows in the run (at most \c count)
+	 * \returns pointer to the first row of the run
+	 */
+	pointer push(int count, int *spanRows)
+	{
+		int inChunk = (head_.item - *head_.chunk) / width_;
+		int rows    = chunkRows_ - inChunk;
+		if (rows > count) rows = count;
+		*spanRows = rows;
+
+		pointer result = head_.item;
+		head_ = head_.advance(*this, rows);
+
+		size_ += rows;
+		if (size_ > capacity_) size_ = capacity_;
+
+		__sync_fetch_and_add(&pushCount_, (uint64_t)rows);
+
+		return result;
+	}
+
 	pointer at(int mark)
 	{
+		if (powerOfTwo_) {
+			int rowIndex = mark & indexMask_;
+			return chunks_[rowIndex >> rowShift_] + (rowIndex & rowMask_) * width_;
+		}
+		
 		int rowIndex = normalizeRowIndex(mark);
 		//return getItem(rowIndex).item;
 		return ChunkItem(*this, rowIndex, 0).item;
 	}
 	
+	/**
+	 * \brief Returns the longest run of contiguous rows starting at \c mark.
+	 *
+	 * Rows are stored contiguously within a chunk, so a run ends at the
+	 * end of the chunk containing \c mark at the latest. Bulk consumers
+	 * can process \c count rows in a few runs:
+	 *
+	 * \code
+	 * while (count > 0) {
+	 *     int rows;
+	 *     float *data = buffer.span(mark, count, &rows);
+	 *     // process rows * getWidth() values at data
+	 *     mark  += rows;
+	 *     count -= rows;
+	 * }
+	 * \endcode
+	 *
+	 * \param mark     position of the first row
+	 * \param count    maximal number of rows
+	 * \param spanRows receives the number of rows in the run (at most \c count)
+	 * \returns pointer to the first row of the run
+	 */
+	pointer span(int mark, int count, int *spanRows)
+	{
+		int rowIndex = normalizeRowIndex(mark);
+		int inChunk  = powerOfTwo_ ? (rowIndex & rowMask_) : (rowIndex % chunkRows_);
+		
+		int rows = chunkRows_ - inChunk;
+		if (rows > count) rows = count;
+		*spanRows = rows;
+		
+		return at(rowIndex);
+	}
+	
 	int mark()
 	{
 		//return getRowIndex(head_);
 		return head_.index;
 	}
 	
+	//// ITERATORS /////////////////////////////////////////////////
+	
+	/**
+	 * \brief Iterator over consecutive rows of the buffer.
+	 *
+	 * Moving to the neighbouring row only moves a pointer within a chunk,
+	 * so iterating over rows is cheaper than calling \ref at for every
+	 * row. Two iterators are equal if they were moved to the same position
+	 * (the position is not wrapped around the capacity).
+	 */
+	class RowIterator {
+	private:
+		RingBuffer2D<T> *buffer_;
+		pointer         *chunk_;
+		pointer          item_;
+		int              position_;
+		
+	public:
+		RowIterator() :
+			buffer_(NULL), chunk_(NULL), item_(NULL), position_(0)
+		{}
+		
+		RowIterator(RingBuffer2D<T> *buffer, int mark) :
+			buffer_(buffer), position_(mark)
+		{
+			int rowIndex = buffer_->normalizeRowIndex(mark);
+			chunk_ = buffer_->chunks_ + (rowIndex / buffer_->chunkRows_);
+			item_  = buffer_->at(rowIndex);
+		}
+		
+		inline pointer operator*() const { return item_; }
+		inline int     mark()      const { return buffer_->normalizeRowIndex(position_); }
+		
+		inline RowIterator& operator++()
+		{
+			position_++;
+			item_ += buffer_->width_;
+			
+			if (item_ >= (*chunk_ + buffer_->chunkElements_)) {
+				chunk_++;
+				if (chunk_ >= (buffer_->chunks_ + buffer_->chunkCount_))
+					chunk_ = buffer_->chunks_;
+				item_ = *chunk_;
+			}
+			
+			return *this;
+		}
+		
+		inline RowIterator& operator--()
+		{
+			position_--;
+			
+			if (item_ == *chunk_) {
+				if (chunk_ == buffer_->chunks_)
+					chunk_ = buffer_->chunks_ + buffer_->chunkCount_;
+				chunk_--;
+				item_ = *chunk_ + buffer_->chunkElements_;
+			}
+			item_ -= buffer_->width_;
+			
+			return *this;
+		}
+		
+		inline bool operator==(const RowIterator &other) const { return position_ == other.position_; }
+		inline bool operator!=(const RowIterator &other) const { return position_ != other.position_; }
+	};
+	
+	/**
+	 * \brief Iterator over consecutive rows of the buffer in reverse order.
+	 */
+	class ReverseRowIterator {
+	private:
+		RowIterator it_;
+		
+	public:
+		ReverseRowIterator() {}
+		ReverseRowIterator(RingBuffer2D<T> *buffer, int mark) : it_(buffer, mark) {}
+		
+		inline pointer operator*() const { return *it_; }
+		inline int     mark()      const { return it_.mark(); }
+		
+		inline ReverseRowIterator& operator++() { --it_; return *this; }
+		inline ReverseRowIterator& operator--() { ++it_; return *this; }
+		
+		inline bool operator==(const ReverseRowIterator &other) const { return it_ == other.it_; }
+		inline bool operator!=(const ReverseRowIterator &other) const { return it_ != other.it_; }
+	};
+	
+	typedef RowIterator        row_iterator;
+	typedef ReverseRowIterator reverse_row_iterator;
+	
+	/**
+	 * \brief Returns an iterator pointing to the row at \c mark.
+	 */
+	row_iterator rowIterator(int mark) { return row_iterator(this, mark); }
+	
+	/**
+	 * \brief Returns a reverse iterator pointing to the row at \c mark.
+	 *
+	 * Incrementing the iterator moves it to the previous (older) row.
+	 */
+	reverse_row_iterator reverseRowIterator(int mark) { return reverse_row_iterator(this, mark); }
+	
 	//// RESERVATIONS //////////////////////////////////////////////
 private:
+	/**
+	 * Instead of flagging reservations on every push, a reservation
+	 * remembers the push count at which the first of its rows is going to
+	 * be overwritten, so that push() does not depend on the number of
+	 * reservations.
+	 */
 	struct Reservation {
 		int start;
 		int end;
 
-		bool alive;
-		bool dirty;
+		bool     alive;
+		uint64_t dirtyAt; //< Value of RingBuffer2D::pushCount_ at which the reservation becomes dirty.
 
 		Reservation() :
-			start(0), end(0), alive(false), dirty(false)
+			start(0), end(0), alive(false), dirtyAt(0)
 		{}
 		
-		void init(int start, int end) {
+		void init(int start, int end, uint64_t dirtyAt) {
 			this->start = start;
-			this->end = 0;
+			this->end = end;
 			this->alive = true;
-			this->dirty = false;
+			this->dirtyAt = dirtyAt;
 		}
 		
 		void free() {
@@ -591,7 +1037,13 @@ public:
 			reservations_.push_back(Reservation());
 		}
 		
-		reservations_[handle].init(start, end);
+		// Number of pushes until a row of the reservation is written to.
+		int head = mark();
+		int distance = 1;
+		if (!isInRange(head, start, end))
+			distance += normalizeRowIndex(start - head);
+		
+		reservations_[handle].init(start, end, pushCount_ + distance);
 
 		return handle;
 	}
@@ -616,7 +1068,121 @@ public:
 	 */
 	bool isDirty(int handle) {
 		assert((handle >= 0) && (handle < (int)reservations_.size()));
-		return reservations_[handle].dirty;
+		return pushCount_ >= reservations_[handle].dirtyAt;
+	}
+
+	//// CURSORS ///////////////////////////////////////////////////
+
+	/**
+	 * \brief Read position of a consumer of the buffer.
+	 *
+	 * Cursors let one writer thread and any number of reader threads
+	 * share the buffer without locking. Every row has a position
+	 * (generation), which is the number of rows pushed before it; unlike
+	 * marks, positions don't wrap around the capacity.
+	 *
+	 * The writer pushes rows as usual and calls \ref publish after the
+	 * rows are written. Publishing stores the head position with release
+	 * semantics, so a reader that sees the new head (\ref getPublished,
+	 * \ref available) also sees the published rows. Every reader keeps
+	 * its own cursors and the writer doesn't know about them, so the
+	 * writer never waits for a slow reader. Instead, a reader that falls
+	 * more than the capacity behind loses the oldest rows, which it
+	 * detects with \ref isOverrun. Since the writer claims a row in
+	 * \ref push before writing to it, a reader that copies rows out of the
+	 * buffer should check \ref isOverrun once more after the copy: if the
+	 * cursor is still not overrun, the copied rows were intact.
+	 *
+	 * \note \ref clear and \ref resize reset positions and must not run
+	 *       concurrently with readers.
+	 */
+	struct Cursor {
+		uint64_t position; //< Position of the row the cursor points to.
+
+		Cursor() : position(0) {}
+		explicit Cursor(uint64_t position) : position(position) {}
+
+		inline Cursor operator+(int delta) const { return Cursor(position + delta); }
+		inline Cursor& operator+=(int delta) { position += delta; return *this; }
+
+		inline bool operator==(const Cursor &other) const { return position == other.position; }
+		inline bool operator!=(const Cursor &other) const { return position != other.position; }
+	};
+
+	/**
+	 * \brief Makes all rows pushed so far visible to the readers.
+	 *
+	 * \note Only the writer thread may call this method.
+	 */
+	inline void publish()
+	{
+		// Only the writer modifies published_, so it can be read plainly.
+		__sync_fetch_and_add(&published_, pushCount_ - published_);
+	}
+
+	/**
+	 * \brief Returns the position after the last published row (with acquire semantics).
+	 */
+	inline uint64_t getPublished() const
+	{
+		return __sync_fetch_and_add(const_cast<uint64_t*>(&published_), 0);
+	}
+
+	/**
+	 * \brief Returns a cursor pointing \c back rows before the published head.
+	 *
+	 * The cursor doesn't point before the first row pushed after the last
+	 * \ref clear.
+	 */
+	Cursor cursor(int back = 0) const
+	{
+		uint64_t head = getPublished();
+		if ((back < 0) || (head < (uint64_t)back))
+			return Cursor(back < 0 ? head : 0);
+		return Cursor(head - back);
+	}
+
+	/**
+	 * \brief Returns a cursor pointing to the most recent row with the specified mark.
+	 */
+	Cursor cursorAt(int rowMark) const
+	{
+		uint64_t head = getPublished();
+		int      back = normalizeRowIndex(mark(Cursor(head)) - rowMark);
+		if (back == 0) back = capacity_;
+		return (head < (uint64_t)back) ? Cursor(0) : Cursor(head - back);
+	}
+
+	/**
+	 * \brief Converts a cursor to a mark usable with \ref at, \ref span and the iterators.
+	 */
+	inline int mark(const Cursor &cursor) const
+	{
+		if (powerOfTwo_)
+			return (int)(cursor.position & (uint64_t)indexMask_);
+		return (int)(cursor.position % (uint64_t)capacity_);
+	}
+
+	/**
+	 * \brief Returns the number of published rows at and after \c cursor.
+	 */
+	int available(const Cursor &cursor) const
+	{
+		uint64_t head = getPublished();
+		if (head <= cursor.position)
+			return 0;
+		uint64_t count = head - cursor.position;
+		return (count > (uint64_t)numeric_limits<int>::max()) ?
+			numeric_limits<int>::max() : (int)count;
+	}
+
+	/**
+	 * \brief Returns \c true if the row at \c cursor has been (or is being) overwritten.
+	 */
+	bool isOverrun(const Cursor &cursor) const
+	{
+		uint64_t claimed = __sync_fetch_and_add(const_cast<uint64_t*>(&pushCount_), 0);
+		return cursor.position + capacity_ < claimed;
 	}
 };
 
@@ -0,0 +1,339 @@
+/**
+ * \file   RowCodec.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the RowCodec class.
+ */
+
+#ifndef ROWCODEC_T8VQ2MXA
+#define ROWCODEC_T8VQ2MXA
+
+
+#include <stdint.h>
+#include <cmath>
+#include <cstring>
+#include <string>
+using namespace std;
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+
+/**
+ * \brief Number of decades below the row maximum covered by the log formats.
+ */
+#define ROW_LOG_DYNAMIC_RANGE 12.0f
+
+
+/**
+ * \brief Storage format of FFT rows.
+ */
+enum RowFormat {
+	ROW_FLOAT32, ///< 32-bit float per bin
+	ROW_FLOAT16, ///< IEEE 754 half precision float per bin
+	ROW_LOG16,   ///< 16-bit code of the logarithm of the magnitude per bin, scaled per row
+	ROW_LOG8     ///< 8-bit code of the logarithm of the magnitude per bin, scaled per row
+};
+
+
+/**
+ * \brief Converts a float to IEEE 754 half precision (rounding to nearest even).
+ */
+inline uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	
+	uint16_t sign     = (bits >> 16) & 0x8000;
+	int      exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+	
+	// Infinity and NaN
+	if (exponent == 0xff)
+		return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+	
+	int e = exponent - 127 + 15;
+	if (e >= 0x1f)
+		return sign | 0x7c00;
+	
+	uint32_t half;
+	uint32_t rest;
+	uint32_t middle;
+	
+	if (e <= 0) {
+		// Subnormal half
+		if (e < -10) return sign;
+		
+		mantissa |= 0x800000;
+		int shift = 14 - e;
+		half   = mantissa >> shift;
+		rest   = mantissa & ((1u << shift) - 1);
+		middle = 1u << (shift - 1);
+	} else {
+		half   = ((uint32_t)e << 10) | (mantissa >> 13);
+		rest   = mantissa & 0x1fff;
+		middle = 0x1000;
+	}
+	
+	// A carry from the mantissa correctly increments the exponent.
+	if ((rest > middle) || ((rest == middle) && (half & 1)))
+		half++;
+	
+	return sign | (uint16_t)half;
+}
+
+
+/**
+ * \brief Converts IEEE 754 half precision to a float.
+ */
+inline float halfToFloat(uint16_t value)
+{
+	uint32_t sign     = (uint32_t)(value & 0x8000) << 16;
+	int      exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+	
+	if (exponent == 0) {
+		float result = ldexp((float)mantissa, -24);
+		return sign ? -result : result;
+	}
+	
+	uint32_t bits;
+	if (exponent == 0x1f)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((uint32_t)(exponent + 112) << 23) | (mantissa << 13);
+	
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+
+/**
+ * \brief Scale of a log-encoded row.
+ *
+ * Code \c c of the row stands for magnitude 10^(offset + c * step).
+ */
+struct RowScale {
+	float offset;
+	float step;
+	
+	RowScale() : offset(0.0f), step(0.0f) {}
+};
+
+
+/**
+ * \brief Encodes FFT rows of float magnitudes to a storage format and back.
+ *
+ * An encoded row consists of a header (\ref RowScale for the log formats,
+ * empty otherwise) followed by the samples of all the bins. The log
+ * formats map the logarithm of the magnitude linearly between the row
+ * maximum and either the row minimum or \ref ROW_LOG_DYNAMIC_RANGE decades
+ * below the maximum, whichever is higher.
+ */
+class RowCodec {
+private:
+	RowFormat format_;
+	int       width_;
+	
+	int levels() const { return (format_ == ROW_LOG8) ? 0x100 : 0x10000; }
+	
+	template<class C>
+	void encodeLog(const float *values, uint8_t *row) const
+	{
+		C *codes = (C*)getSamples(row);
+		
+		float maxValue    = 0.0f;
+		float minPositive = HUGE_VAL;
+		for (int i = 0; i < width_; i++) {
+			float v = values[i];
+			if (v > maxValue) maxValue = v;
+			if ((v > 0.0f) && (v < minPositive)) minPositive = v;
+		}
+		
+		RowScale scale;
+		if (maxValue <= 0.0f) {
+			scale.offset = -30.0f;
+			scale.step   = 0.0f;
+			memcpy(row, &scale, sizeof(scale));
+			memset(codes, 0, sizeof(C) * width_);
+			return;
+		}
+		
+		float maxLog = log10f(maxValue);
+		float minLog = log10f(minPositive);
+		if (minLog < maxLog - ROW_LOG_DYNAMIC_RANGE)
+			minLog = maxLog - ROW_LOG_DYNAMIC_RANGE;
+		
+		scale.offset = minLog;
+		scale.step   = (maxLog - minLog) / (float)(levels() - 1);
+		memcpy(row, &scale, sizeof(scale));
+		
+		if (scale.step <= 0.0f) {
+			memset(codes, 0, sizeof(C) * width_);
+			return;
+		}
+		
+		float inverseStep = 1.0f / scale.step;
+		float maxCode     = (float)(levels() - 1);
+		for (int i = 0; i < width_; i++) {
+			float code = 0.0f;
+			if (values[i] > 0.0f) {
+				code = (log10f(values[i]) - minLog) * inverseStep + 0.5f;
+				if (code < 0.0f) code = 0.0f;
+				if (code > maxCode) code = maxCode;
+			}
+			codes[i] = (C)code;
+		}
+	}
+	
+	template<class C>
+	void decodeLog(const uint8_t *row, int from, int to, float *values) const
+	{
+		const C *codes = (const C*)getSamples(row);
+		RowScale scale = getScale(row);
+		
+		const float ln10 = 2.302585093f;
+		float offset = scale.offset * ln10;
+		float step   = scale.step * ln10;
+		
+		if ((format_ == ROW_LOG8) && ((to - from) > levels())) {
+			float table[0x100];
+			for (int c = 0; c < 0x100; c++)
+				table[c] = expf(offset + (float)c * step);
+			for (int i = from; i < to; i++)
+				values[i] = table[codes[i]];
+			return;
+		}
+		
+		for (int i = from; i < to; i++)
+			values[i] = expf(offset + (float)codes[i] * step);
+	}
+
+public:
+	RowCodec() : format_(ROW_FLOAT32), width_(0) {}
+	RowCodec(RowFormat format, int width) : format_(format), width_(width) {}
+	
+	RowFormat getFormat() const { return format_; }
+	int       getWidth()  const { return width_; }
+	
+	/**
+	 * \brief Returns \c true if the rows are stored as plain floats.
+	 */
+	bool isFloat() const { return format_ == ROW_FLOAT32; }
+	bool isLog()   const { return (format_ == ROW_LOG16) || (format_ == ROW_LOG8); }
+	
+	/**
+	 * \brief Returns size of one bin in bytes.
+	 */
+	int getSampleSize() const
+	{
+		switch (format_) {
+		case ROW_FLOAT16:
+		case ROW_LOG16:
+			return 2;
+		case ROW_LOG8:
+			return 1;
+		default:
+			return sizeof(float);
+		}
+	}
+	
+	int getHeaderSize() const { return isLog() ? sizeof(RowScale) : 0; }
+	
+	/**
+	 * \brief Returns size of an encoded row in bytes.
+	 */
+	int getRowSize() const { return getHeaderSize() + width_ * getSampleSize(); }
+	
+	const uint8_t* getSamples(const uint8_t *row) const { return row + getHeaderSize(); }
+	uint8_t*       getSamples(uint8_t *row)       const { return row + getHeaderSize(); }
+	
+	RowScale getScale(const uint8_t *row) const
+	{
+		RowScale scale;
+		if (isLog()) memcpy(&scale, row, sizeof(scale));
+		return scale;
+	}
+	
+	/**
+	 * \brief Encodes \ref getWidth() magnitudes to \c row.
+	 */
+	void encode(const float *values, uint8_t *row) const
+	{
+		switch (format_) {
+		case ROW_FLOAT32:
+			memcpy(row, values, sizeof(float) * width_);
+			break;
+		case ROW_FLOAT16: {
+			uint16_t *samples = (uint16_t*)row;
+			for (int i = 0; i < width_; i++)
+				samples[i] = floatToHalf(values[i]);
+			break;
+		}
+		case ROW_LOG16:
+			encodeLog<uint16_t>(values, row);
+			break;
+		case ROW_LOG8:
+			encodeLog<uint8_t>(values, row);
+			break;
+		}
+	}
+	
+	/**
+	 * \brief Decodes bins \c from -- \c to (exclusive) of \c row.
+	 *
+	 * \param values output array indexed by bin, only items \c from -- \c to are written
+	 */
+	void decode(const uint8_t *row, int from, int to, float *values) const
+	{
+		switch (format_) {
+		case ROW_FLOAT32:
+			memcpy(values + from, ((const float*)row) + from, sizeof(float) * (to - from));
+			break;
+		case ROW_FLOAT16: {
+			const uint16_t *samples = (const uint16_t*)row;
+			for (int i = from; i < to; i++)
+				values[i] = halfToFloat(samples[i]);
+			break;
+		}
+		case ROW_LOG16:
+			decodeLog<uint16_t>(row, from, to, values);
+			break;
+		case ROW_LOG8:
+			decodeLog<uint8_t>(row, from, to, values);
+			break;
+		}
+	}
+	
+	/**
+	 * \brief Returns the name of a format as used in the configuration.
+	 */
+	static const char* formatName(RowFormat format)
+	{
+		switch (format) {
+		case ROW_FLOAT16: return "float16";
+		case ROW_LOG16:   return "log16";
+		case ROW_LOG8:    return "log8";
+		default:          return "float32";
+		}
+	}
+	
+	/**
+	 * \brief Parses a format name ("float32", "float16", "log16" or "log8").
+	 */
+	static RowFormat parseFormat(const string &name)
+	{
+		if (name == "float16") return ROW_FLOAT16;
+		if (name == "log16")   return ROW_LOG16;
+		if (name == "log8")    return ROW_LOG8;
+		if (name != "float32") {
+			LOG_WARNING("Unknown row format \"" << name << "\", using float32.");
+		}
+		return ROW_FLOAT32;
+	}
+};
+
+
+#endif /* end of include guard: ROWCODEC_T8VQ2MXA */
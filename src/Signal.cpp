@@ -12,6 +12,7 @@
 #define DEF_SIG(name) Signal_<SIG##name> Signal::name(#name);
 DEF_SIG(INT);
 DEF_SIG(TERM);
+DEF_SIG(USR1);
 #undef DEF_SIG
 
 
@@ -122,6 +122,7 @@ public:
 	#define DEF_SIG(name) static Signal_<SIG##name> name;
 	DEF_SIG(INT);
 	DEF_SIG(TERM);
+	DEF_SIG(USR1);
 	#undef DEF_SIG
 };
 
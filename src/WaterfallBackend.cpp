@@ -7,11 +7,16 @@
  */
 
 #include "WaterfallBackend.h"
+#include "MetricsAgent.h"
 #include "config.h"
+#include "git_version.h"
 
 #include <cppapp/Logger.h>
 
 #include <iostream>
+#include <algorithm>
+
+#include <unistd.h>
 using namespace std;
 
 
@@ -39,6 +44,13 @@ int Recorder::fftMarkToRaw(int mark)
 }
 
 
+IQBuffer::Cursor Recorder::fftMarkToRawCursor(int mark)
+{
+	int wrapped = wrap(mark, rawHandles_->size());
+	return IQBuffer::Cursor(rawHandles_->at(wrapped).position);
+}
+
+
 WFTime Recorder::fftMarkToTime(int mark)
 {
 	int wrapped = wrap(mark, rawHandles_->size());
@@ -57,73 +69,85 @@ WFTime Recorder::fftMarkToTime(int mark)
 ////////////////////////////////////////////////////////////////////////////////
 
 
-void* SnapshotRecorder::threadMethod()
+/**
+ * Called by \ref SnapshotWriterPool threads.
+ */
+void SnapshotRecorder::writeSnapshot(const Snapshot &snapshot)
 {
-	vector<Snapshot> received;
-	vector<Snapshot> incomplete;
-	bool             work = true;
+	uint64_t started = LatencyHistogram::now();
+	queueLatency_.add(started - snapshot.queued);
 	
-	while (work) {
-		// Get all snapshots from the work queue
-		work = snapshots_.drain(received);
-		
-		// For each snapshot retrieved from the queue
-		FOR_EACH(received, snapshot) {
-			// If the snapshot doesn't end before the current
-			// buffer mark (i.e. the snapshot data is complete),
-			// write the snapshot data to file.
-			// Otherwise, put the snapshot in the list
-			// of incomplete snapshots.
-			if (buffer_->size(snapshot->start) >= snapshot->length) {
-			//if (buffer_->mark() >= snapshot->end()) {
-				write(*snapshot);
-				if (snapshot->includeRawData)
-					writeRaw(*snapshot);
-				
-				// Free the snapshot's buffer reservation.
-				// This is a mechanism that controls that the
-				// data in the ring buffer haven't been overwritten
-				// by next cycle.
-				{
-					MutexLock bufferLock(bufferMutex_);
-					buffer_->freeReservation(snapshot->reservation);
-				}
-			} else {
-				incomplete.push_back(*snapshot);
-			}
-		}
-		received.clear();
-		
-		// Put all of the incomplete snapshots back to the
-		// work queue to be processed later.
-		snapshots_.sendAll(incomplete);
-		incomplete.clear();
+	if (snapshot.hasEvent)
+		reportEvent(snapshot);
+	
+	// The backend doesn't wait for the recorder, so the rows may have
+	// been overwritten while the snapshot waited in the queue or while it
+	// was being written.
+	if (buffer_->isOverrun(snapshot.start)) {
+		LOG_WARNING("Snapshot \"" << getFileName(snapshot.time) <<
+				  "\" was overwritten in the buffer before it could be written, dropping it.");
+		return;
 	}
 	
-	return NULL;
+	write(snapshot);
+	if (snapshot.includeRawData)
+		writeRaw(snapshot);
+	
+	if (buffer_->isOverrun(snapshot.start)) {
+		LOG_WARNING("Snapshot \"" << getFileName(snapshot.time) <<
+				  "\" was overwritten in the buffer while being written, the file may be corrupted.");
+	}
+	
+	writeLatency_.add(LatencyHistogram::now() - started);
 }
 
 
-void SnapshotRecorder::startWriting()
+/**
+ * Submits the pending snapshots whose rows have all been published to
+ * \ref SnapshotWriterPool.
+ */
+void SnapshotRecorder::published(Cursor head)
 {
-	{
-		MutexLock bufferLock(bufferMutex_);
-		
-		if (nextSnapshot_.length == 0)
-			nextSnapshot_.length = buffer_->size(nextSnapshot_.start);
-		if (snapshotRows_ < nextSnapshot_.length)
-			nextSnapshot_.length = snapshotRows_;
-		int end = nextSnapshot_.start + nextSnapshot_.length;
-		
-		nextSnapshot_.reservation = buffer_->reserve(nextSnapshot_.start, end);
+	if (pending_.empty() || (pending_.front().end().position > head.position))
+		return;
+	
+	vector<Snapshot>::iterator keep = pending_.begin();
+	FOR_EACH(pending_, snapshot) {
+		if (snapshot->end().position <= head.position) {
+			// The raw data are located now, while the row is surely in
+			// the buffer and its handle is valid.
+			if (snapshot->includeRawData)
+				snapshot->rawStart = fftMarkToRawCursor(buffer_->mark(snapshot->start));
+			
+			SnapshotWriterPool::getInstance().submit(
+				this, *snapshot,
+				snapshot->includeRawData ?
+					SnapshotWriterPool::PRIORITY_EVENT :
+					SnapshotWriterPool::PRIORITY_ROUTINE);
+		} else {
+			*(keep++) = *snapshot;
+		}
 	}
+	pending_.erase(keep, pending_.end());
+}
+
+
+void SnapshotRecorder::startWriting()
+{
+	if (nextSnapshot_.length == 0)
+		nextSnapshot_.length = buffer_->available(nextSnapshot_.start);
+	if (snapshotRows_ < nextSnapshot_.length)
+		nextSnapshot_.length = snapshotRows_;
 	
-	snapshots_.send(nextSnapshot_);
+	nextSnapshot_.queued = LatencyHistogram::now();
+	// Nothing is written in the dry-run mode.
+	if (!backend_->isDryRun())
+		pending_.push_back(nextSnapshot_);
 	// Next snapshot wil start at the end fo the previous one.
 	nextSnapshot_ = Snapshot(nextSnapshot_.end());
 	// File name of the next snapshot will include the time at
 	// the start of the snapshot.
-	nextSnapshot_.fileName = getFileName(nextSnapshot_.start);
+	nextSnapshot_.time = getTime(nextSnapshot_.start);
 }
 
 
@@ -135,22 +159,39 @@ void SnapshotRecorder::writeHeader(FITSWriter *w)
 }
 
 
+/**
+ * \brief Returns FITS image type of snapshots of rows stored in \c format.
+ *
+ * Half precision floats have no FITS equivalent, so they are written as
+ * 32-bit floats.
+ */
+static int snapshotImageType(RowFormat format)
+{
+	switch (format) {
+	case ROW_LOG16: return USHORT_IMG;
+	case ROW_LOG8:  return BYTE_IMG;
+	default:        return FLOAT_IMG;
+	}
+}
+
+
 /**
  * \brief Writes a specified snapshot to a FITS file.
  */
 void SnapshotRecorder::write(Snapshot snapshot)
 {
-	WFTime time   = fftMarkToTime(snapshot.start);
-	string origin = backend_->getOrigin();
-	
-	int start  = snapshot.start;
+	int start  = buffer_->mark(snapshot.start);
 	int length = snapshot.length;
 	
+	WFTime time     = fftMarkToTime(start);
+	string origin   = backend_->getOrigin();
+	string baseName = getFileName(snapshot.time);
+	
 	float fftSampleRate = backend_->getFFTSampleRate();
 	
 	string fileName = "!";
 	//fileName += getFileName(time);
-	fileName += Path::join(outputDir_, snapshot.fileName);
+	fileName += Path::join(outputDir_, baseName);
 	
 	LOG_INFO("Writing snapshot \"" << (fileName.c_str() + 1) << "\"...");
 	
@@ -158,7 +199,7 @@ void SnapshotRecorder::write(Snapshot snapshot)
 		CSV_LOG_ENTRY(
 			backend_->getMetadataFile(), 
 			time,
-			Path::basename(snapshot.fileName) << ";"
+			Path::basename(baseName) << ";"
 				<< noise_ << ";"
 				<< peakFrequency_ << ";"
 				<< magnitude_ << ";"
@@ -168,14 +209,14 @@ void SnapshotRecorder::write(Snapshot snapshot)
 	
 	FITSWriter w;
 	
-	if (compressOutput_)
-		fileName = fileName + "[compress]";
 	if (!w.open(fileName.c_str()))
 		return;
+	w.setCompression(compression_);
+	
+	RowFormat format = rowCodec_->getFormat();
 	
 	int width = rightBin_ - leftBin_;
-	w.createImage(width, length, FLOAT_IMG);
-	//w.createImage(width, length, SHORT_IMG);
+	w.createImage(width, length, snapshotImageType(format));
 	
 	writeHeader(&w);
 	w.writeHeader("ORIGIN", origin.c_str(), "");
@@ -197,26 +238,141 @@ void SnapshotRecorder::write(Snapshot snapshot)
 	w.writeHeader("CDELT1", (float)backend_->binToFrequency(),
 			    "frequency difference between two neighbouring pixels in Hz");
 	
+	if (rowCodec_->isLog()) {
+		w.writeHeader("QUANTIZ", RowCodec::formatName(format), "pixels are log-scaled codes");
+		w.comment("Magnitude = 10^(OFFSET + pixel * STEP), OFFSET and STEP of every row");
+		w.comment("are stored in the ROWSCALE extension.");
+	}
+	
 	w.checkStatus("Error occured while writing FITS file header.");
 	
+	// Rows are contiguous within a chunk of the buffer, so the snapshot
+	// is written in runs of rows, taking the range of columns out of
+	// every row (see FITSWriter::writeRows).
+	int rowSize = buffer_->getWidth();
+	vector<float> values;
+	vector<float> scales;
+	
 	int rowIndex = start;
-	for (int y = 0; y < length; y++, rowIndex++) {
-		w.write(y, 1, (float*)(buffer_->at(rowIndex) + leftBin_));
+	for (int y = 0; y < length; ) {
+		int      rows;
+		uint8_t *data    = buffer_->span(rowIndex, length - y, &rows);
+		uint8_t *samples = rowCodec_->getSamples(data);
+		
+		switch (format) {
+		case ROW_FLOAT32:
+			w.writeRows(y, rows, ((float*)samples) + leftBin_, rowSize / sizeof(float));
+			break;
+		case ROW_FLOAT16:
+			// Half floats are decoded to floats first. Bins of the
+			// i-th row are decoded to i * width + bin, so the decoded
+			// rows are contiguous.
+			if ((int)values.size() < rows * width + leftBin_)
+				values.resize(rows * width + leftBin_);
+			for (int i = 0; i < rows; i++) {
+				rowCodec_->decode(data + i * rowSize, leftBin_, rightBin_,
+							   &(values[0]) + i * width);
+			}
+			w.writeRows(y, rows, &(values[0]) + leftBin_, width);
+			break;
+		case ROW_LOG16:
+			w.writeRows(y, rows, ((uint16_t*)samples) + leftBin_, rowSize / sizeof(uint16_t));
+			break;
+		case ROW_LOG8:
+			w.writeRows(y, rows, samples + leftBin_, rowSize);
+			break;
+		}
+		
+		if (rowCodec_->isLog()) {
+			for (int i = 0; i < rows; i++) {
+				RowScale scale = rowCodec_->getScale(data + i * rowSize);
+				scales.push_back(scale.offset);
+				scales.push_back(scale.step);
+			}
+		}
+		
+		y        += rows;
+		rowIndex += rows;
 	}
 	
 	w.checkStatus("Error occured while writing data to a FITS file.");
+	
+	if (rowCodec_->isLog()) {
+		// The scales are small and mustn't be quantized.
+		w.setCompression(FITSCompression());
+		w.createImage(2, length, FLOAT_IMG);
+		w.writeHeader("EXTNAME", "ROWSCALE", "scale of the log-scaled rows");
+		w.comment("Columns: OFFSET, STEP (log10 of magnitude).");
+		w.write(0, length, &(scales[0]));
+		w.checkStatus("Error occured while writing row scales to a FITS file.");
+	}
+	
 	w.close();
 	
 	LOG_DEBUG("Finished writing snapshot.");
+	
+	if (quicklook_.isEnabled())
+		writeQuicklook(snapshot);
+}
+
+
+/**
+ * Renders the snapshot to a PNG image next to the FITS file, decoding the
+ * rows straight from the buffer (see \ref Quicklook).
+ */
+void SnapshotRecorder::writeQuicklook(Snapshot snapshot)
+{
+	int width   = rightBin_ - leftBin_;
+	int rowSize = buffer_->getWidth();
+	
+	string fileName = getFileName(outputType_.c_str(), "png", snapshot.time);
+	
+	vector<float> values;
+	if (!rowCodec_->isFloat())
+		values.resize(rowCodec_->getWidth());
+	
+	quicklook_.begin(width, snapshot.length);
+	
+	int rowIndex = buffer_->mark(snapshot.start);
+	for (int y = 0; y < snapshot.length; ) {
+		int      rows;
+		uint8_t *data = buffer_->span(rowIndex, snapshot.length - y, &rows);
+		
+		for (int i = 0; i < rows; i++) {
+			const uint8_t *row = data + i * rowSize;
+			
+			if (rowCodec_->isFloat()) {
+				quicklook_.addRow(((const float*)rowCodec_->getSamples(row)) + leftBin_);
+			} else {
+				rowCodec_->decode(row, leftBin_, rightBin_, &(values[0]));
+				quicklook_.addRow(&(values[leftBin_]));
+			}
+		}
+		
+		y        += rows;
+		rowIndex += rows;
+	}
+	
+	quicklook_.render();
+	if (quicklook_.writePNG(fileName))
+		LOG_DEBUG("Written quicklook \"" << fileName << "\".");
 }
 
 
 void SnapshotRecorder::writeRaw(Snapshot snapshot)
 {
-	int start  = fftMarkToRaw(snapshot.start);
-	int length = fftSamplesToRaw(snapshot.length);
+	IQBuffer::Cursor rawStart = snapshot.rawStart;
+	int              start    = rawBuffer_->mark(rawStart);
+	int              length   = fftSamplesToRaw(snapshot.length);
 	
-	WFTime time   = fftMarkToTime(snapshot.start);
+	// Raw history may be shorter than FFT history.
+	if (rawBuffer_->isOverrun(rawStart) || (rawBuffer_->available(rawStart) < length)) {
+		LOG_WARNING("Raw data of snapshot \"" << getFileName(snapshot.time) <<
+				  "\" were overwritten in the buffer, not writing them.");
+		return;
+	}
+	
+	WFTime time   = fftMarkToTime(buffer_->mark(snapshot.start));
 	string origin = backend_->getOrigin();
 	
 	float sampleRate = (float)backend_->getStreamInfo().sampleRate;
@@ -232,37 +388,96 @@ void SnapshotRecorder::writeRaw(Snapshot snapshot)
 	if (!w.open(fileName.c_str()))
 		return;
 	
-	w.createImage(2, length, FLOAT_IMG);
-	//w.createImage(2, length, SHORT_IMG);
+	int imageType = rawInt16_ ? SHORT_IMG : FLOAT_IMG;
+	if (rawPlanar_)
+		w.createImage(length, 2, imageType);
+	else
+		w.createImage(2, length, imageType);
 	
 	writeHeader(&w);
+	if (rawInt16_)
+		w.writeScaling(1.0 / 0x7fff, 0.0);
 	w.writeHeader("ORIGIN", origin.c_str(), "");
 	w.date();
 	w.comment(WFTime::now().format("Local time: %Y-%m-%d %H:%M:%S %Z", true).c_str());
 	w.writeHeader("DATE-OBS", time.format("%Y-%m-%dT%H:%M:%S").c_str(), "observation date (UTC)");
 	
-	w.writeHeader("CTYPE2", "TIME",                      "in seconds");
-	w.writeHeader("CRPIX2", 1,                           ""          );
-	w.writeHeader("CRVAL2", (long long)time.toMilliseconds(),
+	// The time axis is the first one in the planar layout (one row of I
+	// samples followed by one row of Q samples) and the second one
+	// otherwise (one I/Q pair per row).
+	const char *timeAxis = rawPlanar_ ? "1" : "2";
+	const char *chanAxis = rawPlanar_ ? "2" : "1";
+	
+	w.writeHeader((string("CTYPE") + timeAxis).c_str(), "TIME", "in seconds");
+	w.writeHeader((string("CRPIX") + timeAxis).c_str(), 1,      ""          );
+	w.writeHeader((string("CRVAL") + timeAxis).c_str(), (long long)time.toMilliseconds(),
 			    "unix time of the first IQ sample in this file in ms");
-	w.writeHeader("CDELT2", ((float)MS_IN_SECOND) / (float)sampleRate,
+	w.writeHeader((string("CDELT") + timeAxis).c_str(), ((float)MS_IN_SECOND) / (float)sampleRate,
 			    "time difference between two IQ samples in ms");
 	
-	w.writeHeader("CTYPE1", "CHAN",                             "in Hz");
-	w.writeHeader("CRPIX1", 1.f,                                ""     );
-	w.writeHeader("CRVAL1", 0,                                  ""     );
-	w.writeHeader("CDELT1", 1,                                  ""     );
+	w.writeHeader((string("CTYPE") + chanAxis).c_str(), "CHAN", "in Hz");
+	w.writeHeader((string("CRPIX") + chanAxis).c_str(), 1.f,    ""     );
+	w.writeHeader((string("CRVAL") + chanAxis).c_str(), 0,      ""     );
+	w.writeHeader((string("CDELT") + chanAxis).c_str(), 1,      ""     );
 	
 	w.checkStatus("Error occured while writing FITS file header.");
 	
+	// Samples of a plane of the raw buffer are contiguous within a chunk,
+	// so the samples are written (or interleaved) in runs.
+	IQBuffer::Plane &planeI = rawBuffer_->plane(IQBuffer::PLANE_I);
+	IQBuffer::Plane &planeQ = rawBuffer_->plane(IQBuffer::PLANE_Q);
 	int rowIndex = start;
-	for (int y = 0; y < length; y++, rowIndex++) {
-		w.write(y, 1, rawBuffer_->at(rowIndex));
+	for (int x = 0; x < length; ) {
+		int rows;
+		float *i = planeI.span(rowIndex, length - x, &rows);
+		float *q = planeQ.span(rowIndex, rows, &rows);
+		
+		if (rawInt16_) {
+			// Converted in runs as well (see FFTBackend::floatToInt),
+			// planes one after the other or interleaved.
+			if ((int)rawInts_.size() < 2 * rows)
+				rawInts_.resize(2 * rows);
+			int16_t *ints = &(rawInts_[0]);
+			
+			if (rawPlanar_) {
+				for (int k = 0; k < rows; k++) {
+					ints[k]        = FFTBackend::floatToInt(i[k]);
+					ints[rows + k] = FFTBackend::floatToInt(q[k]);
+				}
+				w.write(x, 0, rows, ints, TSHORT);
+				w.write(x, 1, rows, ints + rows, TSHORT);
+			} else {
+				for (int k = 0; k < rows; k++) {
+					ints[2 * k]     = FFTBackend::floatToInt(i[k]);
+					ints[2 * k + 1] = FFTBackend::floatToInt(q[k]);
+				}
+				w.write(x, rows, ints);
+			}
+		} else if (rawPlanar_) {
+			w.write(x, 0, rows, i, TFLOAT);
+			w.write(x, 1, rows, q, TFLOAT);
+		} else {
+			if ((int)rawPairs_.size() < 2 * rows)
+				rawPairs_.resize(2 * rows);
+			for (int k = 0; k < rows; k++) {
+				rawPairs_[2 * k]     = i[k];
+				rawPairs_[2 * k + 1] = q[k];
+			}
+			w.write(x, rows, &(rawPairs_[0]));
+		}
+		
+		x        += rows;
+		rowIndex += rows;
 	}
 	
 	w.checkStatus("Error occured while writing data to a FITS file.");
 	w.close();
 	
+	if (rawBuffer_->isOverrun(rawStart)) {
+		LOG_WARNING("Raw data of snapshot \"" << getFileName(snapshot.time) <<
+				  "\" were overwritten in the buffer while being written, the file may be corrupted.");
+	}
+	
 	LOG_DEBUG("Finished writing raw snapshot.");
 }
 
@@ -277,10 +492,9 @@ void SnapshotRecorder::processNoiseMessage(const NoiseMessage &msg, void *data)
 }
 
 
-string SnapshotRecorder::getFileName(int mark)
+WFTime SnapshotRecorder::getTime(Cursor start)
 {
-	WFTime time = fftMarkToTime(mark);
-	return getFileName(time);
+	return fftMarkToTime(buffer_->mark(start));
 }
 
 
@@ -323,7 +537,7 @@ string SnapshotRecorder::getFileBasename(const char   *typ,
                                          WFTime        time)
 {
 	char fileName[1024];
-	sprintf(fileName, "%s%03d_%s_%s.%s",
+	snprintf(fileName, sizeof(fileName), "%s%03d_%s_%s.%s",
 		   time.format("%Y%m%d%H%M%S").c_str(),
 		   (int)(time.microseconds() / 1000),
 		   origin.c_str(),
@@ -391,37 +605,53 @@ void SnapshotRecorder::start()
 	//	rightBin_ = backend_->frequencyToBin(rightFrequency_);
 	//}
 	
-	nextSnapshot_ = Snapshot(0);
-	nextSnapshot_.fileName = getFileName(nextSnapshot_.start);
-	workerThread_ = new Thread(this, &SnapshotRecorder::threadMethod);
+	queueLatency_.setName(backend_->getLatencyPrefix() + "." + outputType_ + ".queue");
+	writeLatency_.setName(backend_->getLatencyPrefix() + "." + outputType_ + ".write");
+	
+	// Snapshots wait for their rows without allocating as long as the
+	// rows are published in time.
+	pending_.reserve(SNAPSHOT_QUEUE_SIZE);
+	
+	nextSnapshot_ = Snapshot(buffer_->cursor());
+	nextSnapshot_.time = getTime(nextSnapshot_.start);
+	SnapshotWriterPool::getInstance().attach();
 }
 
 
 void SnapshotRecorder::stop()
 {
-	if ((buffer_->size(nextSnapshot_.start) >= 0) && writeUnfinished_)
+	if (writeUnfinished_)
 		startWriting();
 	
-	snapshots_.close();
+	// No more rows will be published, snapshots still waiting for
+	// their rows are never complete.
+	published(buffer_->cursor());
+	if (!pending_.empty()) {
+		LOG_WARNING("Dropping " << pending_.size() << " incomplete " << outputType_ << " snapshot(s).");
+		pending_.clear();
+	}
 	
-	// Wait for the worker thread to stop and release the
-	// resources.
-	workerThread_->join();
-	delete workerThread_;
-	workerThread_ = NULL;
+	// Wait for the snapshots of this recorder to be written and
+	// release the resources.
+	SnapshotWriterPool::getInstance().flush(this);
+	SnapshotWriterPool::getInstance().detach();
 }
 
 
 void SnapshotRecorder::update()
 {
-	if (buffer_->size(nextSnapshot_.start) >= snapshotRows_ + 2) {
-		LOG_DEBUG("SnapshotRecorder: Snapshot full [start_: " << nextSnapshot_.start <<
+	if (buffer_->available(nextSnapshot_.start) >= snapshotRows_ + 2) {
+		LOG_DEBUG("SnapshotRecorder: Snapshot full [start_: " << nextSnapshot_.start.position <<
 				", snapshotRows_: " << snapshotRows_ <<
 				", snapshotLength_: " << snapshotLength_ <<
-				", buffer_->size(start_): " << buffer_->size(nextSnapshot_.start) <<
+				", buffer_->available(start_): " << buffer_->available(nextSnapshot_.start) <<
 				"].");
-		backend_->logProcessingTimes();
-		backend_->clearProcessingTime();
+		if (reportMetrics_) {
+			backend_->logProcessingTimes();
+			backend_->clearProcessingTime();
+			// Logged by the metrics agent's thread.
+			MetricsAgent::requestSnapshotDump();
+		}
 		startWriting();
 	}
 }
@@ -432,6 +662,9 @@ void SnapshotRecorder::update()
  * \li \c snapshot_length
  * \li \c low_freq
  * \li \c hi_freq
+ *
+ * See \ref readCompression for the compression parameters and
+ * \ref readQuicklook for the quicklook parameters.
  */
 Ref<DIObject> SnapshotRecorder::make(Ref<DynObject> config, Ref<DIObject> parent)
 {
@@ -443,7 +676,7 @@ Ref<DIObject> SnapshotRecorder::make(Ref<DynObject> config, Ref<DIObject> parent
 	float  leftFrequency  = config->getStrDouble("low_freq", 0);
 	float  rightFrequency = config->getStrDouble("hi_freq",  0);
 	
-	return new SnapshotRecorder(
+	Ref<SnapshotRecorder> result = new SnapshotRecorder(
 		parent,
 		snapshotLength,
 		leftFrequency,
@@ -453,11 +686,303 @@ Ref<DIObject> SnapshotRecorder::make(Ref<DynObject> config, Ref<DIObject> parent
 		compressOutput,
 		true
 	);
+	
+	result->setCompression(readCompression(config));
+	result->setQuicklook(readQuicklook(config));
+	
+	return result;
+}
+
+
+FITSCompression SnapshotRecorder::readCompression(Ref<DynObject> config)
+{
+	if (!config->getStrBool("compress_output", true))
+		return FITSCompression();
+	
+	string name = config->getStrString("compression", "rice");
+	
+	FITSCompression result(RICE_1);
+	if (!FITSCompression::parseType(name, &result.type))
+		LOG_WARNING("Unknown compression \"" << name << "\", using \"rice\".");
+	
+	result.tileWidth     = config->getStrInt("tile_width", 0);
+	result.tileHeight    = config->getStrInt("tile_height", 1);
+	result.quantizeLevel = config->getStrDouble("quantize_level", 4.0);
+	
+	return result;
+}
+
+
+
+Quicklook SnapshotRecorder::readQuicklook(Ref<DynObject> config)
+{
+	if (!config->getStrBool("quicklook", false))
+		return Quicklook();
+	
+	string name = config->getStrString("quicklook_colormap", "hot");
+	
+	Colormap colormap = COLORMAP_HOT;
+	if (!Quicklook::parseColormap(name, &colormap))
+		LOG_WARNING("Unknown colormap \"" << name << "\", using \"hot\".");
+	
+	return Quicklook(
+		config->getStrInt("quicklook_width", 1024),
+		config->getStrInt("quicklook_height", 1024),
+		config->getStrDouble("quicklook_low", 5.0),
+		config->getStrDouble("quicklook_high", 99.5),
+		colormap
+	);
 }
 
 CPPAPP_DI_METHOD("snapshot", SnapshotRecorder, make);
 
 
+////////////////////////////////////////////////////////////////////////////////
+// SNAPSHOT WRITER POOL
+////////////////////////////////////////////////////////////////////////////////
+
+
+SnapshotWriterPool::SnapshotWriterPool() :
+	threadCount_(2),
+	queueSize_(SNAPSHOT_QUEUE_SIZE),
+	users_(0),
+	sequence_(0),
+	stopping_(false),
+	maxDepth_(0),
+	dropped_(0),
+	unreported_(0)
+{
+}
+
+
+SnapshotWriterPool& SnapshotWriterPool::getInstance()
+{
+	static SnapshotWriterPool instance;
+	return instance;
+}
+
+
+void SnapshotWriterPool::configure(int threadCount, int queueSize)
+{
+	MutexLock lock(&mutex_);
+	
+	threadCount_ = max(threadCount, 1);
+	queueSize_   = max(queueSize, 1);
+}
+
+
+void SnapshotWriterPool::attach()
+{
+	MutexLock lock(&mutex_);
+	
+	if (users_++ > 0) return;
+	
+	LOG_INFO("Starting " << threadCount_ << " snapshot writer thread(s).");
+	
+	queue_.reserve(queueSize_);
+	running_.reserve(threadCount_);
+	stopping_ = false;
+	for (int i = 0; i < threadCount_; i++)
+		threads_.push_back(new Thread(this, &SnapshotWriterPool::threadMethod));
+}
+
+
+void SnapshotWriterPool::detach()
+{
+	{
+		MutexLock lock(&mutex_);
+		
+		if (--users_ > 0) return;
+		
+		stopping_ = true;
+		condition_.broadcast();
+	}
+	
+	// The threads write the remaining jobs before they stop.
+	FOR_EACH(threads_, it) {
+		(*it)->join();
+		delete *it;
+	}
+	threads_.clear();
+}
+
+
+/**
+ * Must be called with \ref mutex_ locked.
+ */
+bool SnapshotWriterPool::isQueued(SnapshotRecorder *recorder)
+{
+	FOR_EACH(queue_, job) {
+		if (job->recorder == recorder) return true;
+	}
+	return false;
+}
+
+
+/**
+ * Must be called with \ref mutex_ locked.
+ */
+bool SnapshotWriterPool::isRunning(SnapshotRecorder *recorder)
+{
+	return find(running_.begin(), running_.end(), recorder) != running_.end();
+}
+
+
+/**
+ * Must be called with \ref mutex_ locked.
+ *
+ * \returns index of the job to be written next in \ref queue_, -1 if
+ *          no job can be written now
+ */
+int SnapshotWriterPool::nextJob()
+{
+	int best = -1;
+	for (int i = 0; i < (int)queue_.size(); i++) {
+		const Job &job = queue_[i];
+		if (isRunning(job.recorder)) continue;
+		
+		if ((best < 0) ||
+		    (job.priority > queue_[best].priority) ||
+		    ((job.priority == queue_[best].priority) && (job.sequence < queue_[best].sequence)))
+			best = i;
+	}
+	return best;
+}
+
+
+/**
+ * Called on the processing thread, so it only counts the dropped job.
+ */
+void SnapshotWriterPool::drop()
+{
+	__sync_fetch_and_add(&dropped_, 1);
+	__sync_fetch_and_add(&unreported_, 1);
+}
+
+
+/**
+ * Logs the jobs dropped since the last call. Called by the writer threads
+ * without \ref mutex_ locked.
+ */
+void SnapshotWriterPool::reportDropped()
+{
+	uint32_t count = __sync_lock_test_and_set(&unreported_, 0);
+	if (count > 0)
+		LOG_WARNING(count << " snapshot(s) dropped, the writer queue is full.");
+}
+
+
+bool SnapshotWriterPool::submit(SnapshotRecorder *recorder, const Snapshot &snapshot, int priority)
+{
+	MutexLock lock(&mutex_);
+	
+	Job job;
+	job.recorder = recorder;
+	job.snapshot = snapshot;
+	job.priority = priority;
+	job.sequence = sequence_++;
+	
+	if ((int)queue_.size() >= queueSize_) {
+		// Find the newest job of the lowest priority.
+		int victim = 0;
+		for (int i = 1; i < (int)queue_.size(); i++) {
+			if ((queue_[i].priority < queue_[victim].priority) ||
+			    ((queue_[i].priority == queue_[victim].priority) && (queue_[i].sequence > queue_[victim].sequence)))
+				victim = i;
+		}
+		
+		if (queue_[victim].priority >= priority) {
+			drop();
+			return false;
+		}
+		
+		drop();
+		queue_[victim] = job;
+	} else {
+		queue_.push_back(job);
+	}
+	
+	maxDepth_ = max(maxDepth_, (int)queue_.size());
+	condition_.broadcast();
+	return true;
+}
+
+
+void SnapshotWriterPool::flush(SnapshotRecorder *recorder)
+{
+	MutexLock lock(&mutex_);
+	
+	while (isQueued(recorder) || isRunning(recorder))
+		condition_.wait(mutex_);
+}
+
+
+int SnapshotWriterPool::getDepth()
+{
+	MutexLock lock(&mutex_);
+	return queue_.size();
+}
+
+
+/**
+ * The statistics are copied under the lock and logged without it, so that
+ * \ref submit isn't blocked by the logging.
+ */
+void SnapshotWriterPool::dump(bool clear)
+{
+	int      depth;
+	int      maxDepth;
+	uint32_t dropped;
+	{
+		MutexLock lock(&mutex_);
+		
+		depth    = queue_.size();
+		maxDepth = maxDepth_;
+		dropped  = clear ? __sync_lock_test_and_set(&dropped_, 0) : dropped_;
+		
+		if (clear)
+			maxDepth_ = depth;
+	}
+	
+	LOG_INFO("Snapshot writer queue: depth = " << depth <<
+		    ", max depth = " << maxDepth <<
+		    ", dropped = " << dropped);
+}
+
+
+void* SnapshotWriterPool::threadMethod()
+{
+	MutexLock lock(&mutex_);
+	
+	while (true) {
+		int index = nextJob();
+		if (index < 0) {
+			if (stopping_ && queue_.empty()) break;
+			
+			condition_.wait(mutex_);
+			continue;
+		}
+		
+		Job job = queue_[index];
+		queue_[index] = queue_.back();
+		queue_.pop_back();
+		running_.push_back(job.recorder);
+		
+		// Write without holding the lock.
+		mutex_.unlock();
+		reportDropped();
+		job.recorder->writeSnapshot(job.snapshot);
+		mutex_.lock();
+		
+		running_.erase(find(running_.begin(), running_.end(), job.recorder));
+		// Wake up flush() and the threads waiting for the recorder.
+		condition_.broadcast();
+	}
+	
+	return NULL;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // WATERFALL BACKEND
 ////////////////////////////////////////////////////////////////////////////////
@@ -482,29 +1007,134 @@ Ref<CsvLog> WaterfallBackend::getMetadataFile()
 }
 
 
-void WaterfallBackend::processFFT(const fftw_complex *data, int size, DataInfo info, int rawMark)
+/**
+ * \brief Computes magnitudes of the FFT output bins from \c from to \c to.
+ *
+ * The magnitude of bin \c i is stored to \c row[i + shift]. If spectral
+ * kurtosis is enabled, the power is also accumulated in the same pass.
+ */
+void WaterfallBackend::computeMagnitudes(const fftw_complex *data,
+								 int                 from,
+								 int                 to,
+								 int                 shift,
+								 float              *row)
 {
-	//float *row = inBuffer_.addRow(info.timeOffset);
-	float *row = buffer_.push();
-	int    halfSize = size / 2;
-	
-	// Left half (0 -- half)
-	for (int i = 0; i < halfSize; i++) {
-		row[halfSize + i] = sqrt(
-			data[i][0] * data[i][0] +
-			data[i][1] * data[i][1]
-		);
+	bool    kurtosis = (skFrames_ > 0);
+	double *sum1     = kurtosis ? &(skSum1_[0]) : NULL;
+	double *sum2     = kurtosis ? &(skSum2_[0]) : NULL;
+	
+	if (isFixedPoint()) {
+		const int16_t *fixed = getFixedOutput();
+		float          scale = ldexp(1.0f, getFixedExponent());
+		
+		for (int i = from, j = from + shift; i < to; i++, j++) {
+			row[j] = scale * (float)FixedTransform::magnitude(fixed + 2 * i);
+			
+			if (kurtosis) {
+				double power = (double)row[j] * (double)row[j];
+				sum1[j] += power;
+				sum2[j] += power * power;
+			}
+		}
+	} else {
+		for (int i = from, j = from + shift; i < to; i++, j++) {
+			double power = (
+				data[i][0] * data[i][0] +
+				data[i][1] * data[i][1]
+			);
+			row[j] = sqrt(power);
+			
+			if (kurtosis) {
+				sum1[j] += power;
+				sum2[j] += power * power;
+			}
+		}
 	}
+}
+
+
+/**
+ * \brief Computes the RFI mask from the spectral kurtosis sums, writes it to
+ *        the mask rows of the block and starts a new block.
+ *
+ * Uses the generalized SK estimator
+ * SK = (M + 1) / (M - 1) * (M * S2 / S1^2 - 1), which has expected value 1
+ * and variance approximately 4 / M for Gaussian noise.
+ */
+void WaterfallBackend::updateRFIMask()
+{
+	double m     = (double)skFrames_;
+	double sigma = 2.0 / sqrt(m);
+	double low   = 1.0 - skThreshold_ * sigma;
+	double high  = 1.0 + skThreshold_ * sigma;
+	int    width = rfiMask_.size();
 	
-	// Right half (half -- size)
-	for (int i = halfSize; i < size; i++) {
-		row[i - halfSize] = sqrt(
-			data[i][0] * data[i][0] +
-			data[i][1] * data[i][1]
-		);
+	for (int i = 0; i < width; i++) {
+		double s1 = skSum1_[i];
+		double sk = 1.0;
+		
+		if (s1 > 0.0)
+			sk = ((m + 1.0) / (m - 1.0)) * ((m * skSum2_[i]) / (s1 * s1) - 1.0);
+		
+		rfiMask_[i] = ((sk < low) || (sk > high)) ? 1 : 0;
+		
+		skSum1_[i] = 0.0;
+		skSum2_[i] = 0.0;
 	}
+	
+	// The rows of the block are the last pushed rows.
+	int rows = min(skCount_, maskBuffer_.getCapacity());
+	int head = maskBuffer_.mark();
+	for (int i = 1; i <= rows; i++)
+		memcpy(maskBuffer_.at(head - i), &(rfiMask_[0]), width);
+	
+	skCount_ = 0;
+}
+
 
-	rawHandles_[buffer_.mark()] = RawDataHandle(rawMark, info.timeOffset);
+void WaterfallBackend::processFFT(const fftw_complex *data, int size, DataInfo info, const RawDataHandle &raw)
+{
+	//float *row = inBuffer_.addRow(info.timeOffset);
+	LatencyTimer latency;
+	
+	uint8_t *row      = buffer_.push();
+	int      halfSize = size / 2;
+	
+	// Rows stored as floats are computed in place, other formats are
+	// computed to a temporary row and encoded.
+	float *magnitudes = rowCodec_.isFloat() ? (float*)row : &(magnitudes_[0]);
+	
+	// Left half of the FFT output (0 -- half) goes to the right half of the
+	// row, right half (half -- size) goes to the left half.
+	computeMagnitudes(data, 0,        halfSize, halfSize,  magnitudes);
+	computeMagnitudes(data, halfSize, size,     -halfSize, magnitudes);
+	
+	if (!rowCodec_.isFloat())
+		rowCodec_.encode(magnitudes, row);
+	
+	// The mask row is written when the SK block of the row is complete.
+	bool maskComplete = false;
+	if (skFrames_ > 0) {
+		maskBuffer_.push();
+		skCount_++;
+		if (skCount_ >= skFrames_) {
+			updateRFIMask();
+			maskComplete = true;
+		}
+	}
+	latency.lap(magnitudeLatency_);
+	
+	rawHandles_[buffer_.mark()] = RawDataHandle(raw.mark, raw.position, info.timeOffset);
+	
+	// Make the row visible to recorders reading in other threads.
+	buffer_.publish();
+	if (maskComplete)
+		maskBuffer_.publish();
+	
+	Recorder::Cursor head = buffer_.cursor();
+	FOR_EACH(recorders_, it) {
+		(*it)->published(head);
+	}
 	
 	//LOG_DEBUG("Data stream time: " << info.timeOffset.format("%Y-%m-%d  %H:%M:%S"));
 	
@@ -533,6 +1163,7 @@ void WaterfallBackend::processFFT(const fftw_complex *data, int size, DataInfo i
 	
 	FOR_EACH(recorders_, it) {
 		(*it)->update();
+		latency.lap((*it)->getUpdateLatency());
 	}
 	
 	//if (inBuffer_.isFull()) {
@@ -546,13 +1177,24 @@ WaterfallBackend::WaterfallBackend(int    bins,
                                    string origin) :
 	FFTBackend(bins, overlap),
 	origin_(origin),
-	bufferChunkSize_(WATERFALL_BACKEND_CHUNK_SIZE)
+	bufferChunkSize_(WATERFALL_BACKEND_CHUNK_SIZE),
+	bufferPowerOfTwo_(false),
+	historyLength_(0.0f),
+	historyResidentChunks_(16),
+	skFrames_(0),
+	skThreshold_(3.0f),
+	skCount_(0),
+	historyThread_(NULL),
+	historyStopping_(false)
 {
+	magnitudeLatency_.setName(getLatencyPrefix() + ".magnitude");
 }
 
 
 WaterfallBackend::~WaterfallBackend()
 {
+	stopHistoryThread();
+	
 	FOR_EACH(recorders_, it) {
 		*it = NULL;
 	}
@@ -563,7 +1205,8 @@ WaterfallBackend::~WaterfallBackend()
 void WaterfallBackend::addRecorder(Ref<Recorder> recorder)
 {
 	recorders_.push_back(recorder);
-	recorder->setBuffer(&buffer_, &rawBuffer_, &bufferMutex_, &rawHandles_);
+	recorder->setBuffer(&buffer_, getRawBuffer(), &rawHandles_,
+					(skFrames_ > 0) ? &maskBuffer_ : NULL, &rowCodec_);
 }
 
 
@@ -572,23 +1215,69 @@ void WaterfallBackend::addRecorder(Ref<Recorder> recorder)
  */
 void WaterfallBackend::startStream(StreamInfo info)
 {
+	// The buffers are resized below.
+	stopHistoryThread();
+	
 	FFTBackend::startStream(info);
 	
-	int bufferSize = 1;
+	int bufferSize    = 1;
+	int rawBufferSize = 1;
 	FOR_EACH(recorders_, it) {
 		int requested = (*it)->requestBufferSize();
 		if (requested > bufferSize)
 			bufferSize = requested;
+		
+		requested = (*it)->requestRawBufferSize();
+		if (requested > rawBufferSize)
+			rawBufferSize = requested;
 	}
 	
+	// The FFT history may be longer than what the recorders need, but
+	// the raw data are only kept for the recorders.
+	int historySize = max(bufferSize, timeToFFTSamples(historyLength_));
+	
 	// TODO: Make the chunk size an config option.
-	buffer_.resize(getBins(), bufferChunkSize_, bufferSize);
+	buffer_.setPowerOfTwo(bufferPowerOfTwo_);
+	buffer_.setAllocationPolicy(bufferPolicy_);
+	buffer_.setBackingFile(historyDir_, historyResidentChunks_);
+	rowCodec_ = RowCodec(rowCodec_.getFormat(), getBins());
+	magnitudes_.resize(getBins());
+	buffer_.resize(rowCodec_.getRowSize(), bufferChunkSize_, historySize);
 	rawHandles_.resize(buffer_.getCapacity());
 	
-	resizeRawBuffer(fftSamplesToRaw(bufferSize));
-	LOG_DEBUG("Number of raw samples in the buffer = " << fftSamplesToRaw(bufferSize));
+	if (skFrames_ > 0) {
+		// Same number of rows per chunk as the FFT buffer, so that the
+		// mask rows have the same marks as the FFT rows.
+		maskBuffer_.setPowerOfTwo(bufferPowerOfTwo_);
+		maskBuffer_.setAllocationPolicy(bufferPolicy_);
+		maskBuffer_.setBackingFile(historyDir_, historyResidentChunks_);
+		maskBuffer_.resizeRows(getBins(), buffer_.getChunkRows(), historySize);
+		CPPAPP_ASSERT(maskBuffer_.getCapacity() == buffer_.getCapacity());
+		
+		skCount_ = 0;
+		skSum1_.assign(getBins(), 0.0);
+		skSum2_.assign(getBins(), 0.0);
+		rfiMask_.assign(getBins(), 0);
+	}
+	
+	if (buffer_.isFileBacked())
+		startHistoryThread();
+	
+	resizeRawBuffer(max(fftSamplesToRaw(bufferSize), rawBufferSize));
+	LOG_DEBUG("Number of raw samples in the buffer = " << getRawBuffer()->getCapacity());
+	LOG_INFO("Allocated " << (buffer_.getMemorySize() >> 20) << " MiB for " <<
+		    RowCodec::formatName(rowCodec_.getFormat()) << " FFT rows" <<
+		    (buffer_.isFileBacked() ? " (in " + historyDir_ + ")" : string()) << ", " <<
+		    (getRawBuffer()->getMemorySize() >> 20) << " MiB for raw data.");
 	
 	FOR_EACH(recorders_, it) {
+		// The backend may have been attached as an engine to another
+		// backend after the recorders were added, so the raw buffer
+		// must be set again.
+		(*it)->setBuffer(&buffer_, getRawBuffer(), &rawHandles_,
+					  (skFrames_ > 0) ? &maskBuffer_ : NULL, &rowCodec_);
+		(*it)->getUpdateLatency().setName(
+			getLatencyPrefix() + "." + (*it)->getLatencyName() + ".update");
 		(*it)->start();
 	}
 }
@@ -604,6 +1293,68 @@ void WaterfallBackend::endStream()
 	FOR_EACH(recorders_, it) {
 		(*it)->stop();
 	}
+	
+	stopHistoryThread();
+}
+
+
+void WaterfallBackend::startHistoryThread()
+{
+	historyStopping_ = false;
+	historyThread_   = new Thread(this, &WaterfallBackend::historyThreadMethod);
+}
+
+
+void WaterfallBackend::stopHistoryThread()
+{
+	if (historyThread_ == NULL) return;
+	
+	historyStopping_ = true;
+	historyThread_->join();
+	delete historyThread_;
+	historyThread_ = NULL;
+}
+
+
+/**
+ * Ages the chunks of the file-backed FFT and mask buffers, which may wait
+ * for the disk, instead of the processing thread.
+ */
+void* WaterfallBackend::historyThreadMethod()
+{
+	while (!historyStopping_) {
+		usleep(HISTORY_POLL_INTERVAL * 1000);
+		
+		buffer_.ageChunks();
+		if (skFrames_ > 0)
+			maskBuffer_.ageChunks();
+	}
+	
+	return NULL;
+}
+
+
+void WaterfallBackend::reportMemory(vector<MemoryUsage> &usage)
+{
+	string prefix = getLatencyPrefix();
+	
+	ostringstream rows;
+	rows << buffer_.getCapacity() << " " << RowCodec::formatName(rowCodec_.getFormat()) <<
+		" rows, " << (double)buffer_.getCapacity() / (double)getFFTSampleRate() << " s";
+	if (buffer_.isFileBacked())
+		rows << ", file-backed in " << historyDir_;
+	usage.push_back(MemoryUsage(prefix + ".rows", buffer_.getMemorySize(), rows.str()));
+	
+	if (skFrames_ > 0) {
+		usage.push_back(MemoryUsage(prefix + ".rfi_mask", maskBuffer_.getMemorySize(),
+			maskBuffer_.isFileBacked() ? "file-backed" : ""));
+	}
+	
+	usage.push_back(MemoryUsage(prefix + ".raw_handles",
+		sizeof(RawDataHandle) * rawHandles_.capacity() + sizeof(float) * magnitudes_.capacity() +
+		2 * sizeof(double) * skSum1_.capacity() + rfiMask_.capacity()));
+	
+	FFTBackend::reportMemory(usage);
 }
 
 
@@ -617,6 +1368,22 @@ bool WaterfallBackend::injectDependency(Ref<DIObject> obj, std::string key)
 }
 
 
+/**
+ * \brief Reads a buffer allocation policy from config keys starting with \c prefix.
+ */
+static AllocationPolicy makeAllocationPolicy(Ref<DynObject> config, const string &prefix)
+{
+	AllocationPolicy policy;
+	
+	policy.hugePages = AllocationPolicy::parseHugePages(
+		config->getStrString((prefix + "huge_pages").c_str(), "none"));
+	policy.populate = config->getStrBool((prefix + "populate").c_str(), false);
+	policy.lock     = config->getStrBool((prefix + "lock").c_str(), false);
+	
+	return policy;
+}
+
+
 Ref<DIObject> WaterfallBackend::make(Ref<DynObject> config, Ref<DIObject> parent)
 {
 	int bins      = config->getStrInt("bins",        32768);
@@ -634,12 +1401,43 @@ Ref<DIObject> WaterfallBackend::make(Ref<DynObject> config, Ref<DIObject> parent
 	
 	backend->setBufferChunkSize(
 		config->getStrInt("buffer_chunk_size", WATERFALL_BACKEND_CHUNK_SIZE));
+	backend->setBufferPowerOfTwo(
+		config->getStrBool("buffer_power_of_two", false));
+	backend->setBufferPolicy(makeAllocationPolicy(config, "buffer_"));
+	backend->setRowFormat(RowCodec::parseFormat(
+		config->getStrString("row_format", "float32")));
+	
+	backend->setHistory(
+		config->getStrDouble("history_length", 0),
+		config->getStrString("history_dir", ""),
+		config->getStrInt("history_resident_chunks", 16));
+	backend->setRawAllocationPolicy(makeAllocationPolicy(config, "raw_buffer_"));
 	
 	backend->setGain(
 		config->getStrDouble("iq_gain", 0));
 	backend->setPhaseShift(
 		config->getStrInt("iq_phase_shift", 0));
 	
+	backend->setFixedPoint(
+		config->getStrBool("fixed_point", false));
+	
+	backend->setSKFrames(
+		config->getStrInt("sk_frames", 0));
+	backend->setSKThreshold(
+		config->getStrDouble("sk_threshold", 3.0));
+	
+	ImpulseBlanker &blanker = backend->getBlanker();
+	blanker.setThreshold(
+		config->getStrDouble("blanker_threshold", 0));
+	blanker.setBlockSize(
+		config->getStrInt("blanker_block_size", 16));
+	blanker.setHoldBlocks(
+		config->getStrInt("blanker_hold_blocks", 2));
+	blanker.setAverageSize(
+		config->getStrInt("blanker_average_size", 65536));
+	blanker.setInterpolate(
+		config->getStrBool("blanker_interpolate", true));
+	
 	return backend;
 }
 
@@ -13,6 +13,8 @@
 #include "FFTBackend.h"
 #include "FITSWriter.h"
 #include "RingBuffer.h"
+#include "RowCodec.h"
+#include "Quicklook.h"
 #include "Channel.h"
 #include "BolidMessage.h"
 #include "CsvLog.h"
@@ -27,6 +29,9 @@ using namespace std;
 
 #define WATERFALL_BACKEND_CHUNK_SIZE (1024 * 1024)
 
+/// Number of snapshots a recorder queues for writing without allocating.
+#define SNAPSHOT_QUEUE_SIZE 16
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // RECORDER
@@ -40,44 +45,117 @@ class WaterfallBackend;
  * \brief Base class for FFT data recorders.
  */
 class Recorder : public DIObject {
+public:
+	typedef RingBuffer2D<uint8_t>::Cursor Cursor;
+
 protected:
 	Ref<WaterfallBackend>   backend_; ///< This recorder's backend.
-	RingBuffer2D<float>    *buffer_; ///< FFT data buffer to record from.
+	RingBuffer2D<uint8_t>  *buffer_; ///< FFT data buffer to record from (rows encoded by \ref rowCodec_).
 	FFTBackend::IQBuffer   *rawBuffer_; ///< I/Q data buffer to record from.
-	Mutex                  *bufferMutex_; ///< Controls access to \ref buffer_.
 	vector<RawDataHandle>  *rawHandles_;
+	RingBuffer2D<uint8_t>  *rfiMask_; ///< RFI mask rows parallel to \ref buffer_, \c NULL if disabled.
+	const RowCodec         *rowCodec_; ///< Storage format of the rows in \ref buffer_.
+	
+	LatencyHistogram        updateLatency_; ///< Latency of \ref update.
 	
 public:
 	Recorder(Ref<WaterfallBackend>  backend):
 		backend_(backend),
 		buffer_(NULL),
 		rawBuffer_(NULL),
-		bufferMutex_(NULL),
-		rawHandles_(NULL)
+		rawHandles_(NULL),
+		rfiMask_(NULL),
+		rowCodec_(NULL)
 	{}
 	
 	virtual ~Recorder() {
-		backend_     = NULL;
-		buffer_      = NULL;
-		bufferMutex_ = NULL;
+		backend_ = NULL;
+		buffer_  = NULL;
 	}
 	
-	void setBuffer(RingBuffer2D<float> *buffer,
+	/**
+	 * \brief Sets the buffers to record from.
+	 *
+	 * The backend publishes every FFT row (see \ref RingBuffer2D::Cursor)
+	 * after the row, its raw data handle and its RFI mask are written, so
+	 * recorders running in other threads can read the buffers using
+	 * cursors without locking.
+	 */
+	void setBuffer(RingBuffer2D<uint8_t> *buffer,
 				FFTBackend::IQBuffer *rawBuffer,
-				Mutex *bufferMutex,
-				vector<RawDataHandle> *rawHandles)
+				vector<RawDataHandle> *rawHandles,
+				RingBuffer2D<uint8_t> *rfiMask,
+				const RowCodec *rowCodec)
 	{
 		buffer_      = buffer;
 		rawBuffer_   = rawBuffer;
-		bufferMutex_ = bufferMutex;
 		rawHandles_  = rawHandles;
+		rfiMask_     = rfiMask;
+		rowCodec_    = rowCodec;
+	}
+	
+	/**
+	 * \brief Returns magnitudes of bins \c from -- \c to (exclusive) of the FFT row at \c mark.
+	 *
+	 * If the rows are stored as floats, the returned pointer points
+	 * directly to the buffer. Otherwise, the bins are decoded to
+	 * \c scratch, which is resized to the row width if needed.
+	 *
+	 * \returns pointer to the magnitudes indexed by bin (only items
+	 *          \c from -- \c to are valid)
+	 */
+	inline float* getRow(int mark, int from, int to, vector<float> &scratch)
+	{
+		uint8_t *row = buffer_->at(mark);
+		if (rowCodec_->isFloat())
+			return (float*)row;
+		
+		if ((int)scratch.size() < rowCodec_->getWidth())
+			scratch.resize(rowCodec_->getWidth());
+		rowCodec_->decode(row, from, to, &(scratch[0]));
+		return &(scratch[0]);
 	}
 	
+	/**
+	 * \brief Returns the RFI mask of the FFT row at \c row.
+	 *
+	 * Bins with a non-zero mask value are contaminated by RFI. The mask
+	 * rows are published when the spectral kurtosis block of the row is
+	 * complete, which may be later than the FFT row. See
+	 * \ref WaterfallBackend for details.
+	 *
+	 * \returns pointer to a mask row with the same width as the FFT row
+	 *          or \c NULL if the RFI mask is disabled or the mask of the
+	 *          row is not published yet
+	 */
+	inline const uint8_t* getRFIMask(Cursor row)
+	{
+		if ((rfiMask_ == NULL) || (rfiMask_->available(row) == 0)) return NULL;
+		return rfiMask_->at(rfiMask_->mark(row));
+	}
+	
+	/**
+	 * \brief Returns the latency histogram of \ref update calls.
+	 */
+	LatencyHistogram& getUpdateLatency() { return updateLatency_; }
+	/**
+	 * \brief Returns a short name of the recorder used in latency histogram names.
+	 */
+	virtual string getLatencyName() { return "recorder"; }
+	
 	int getSampleRate();
 	int getFFTSampleRate();
 	
 	inline int fftMarkToRaw(int mark);
 	inline WFTime fftMarkToTime(int mark);
+	/**
+	 * \brief Returns a cursor of the raw buffer pointing to the raw data of
+	 *        the FFT row at \c mark.
+	 *
+	 * Unlike \ref fftMarkToRaw, the cursor tells whether the raw data were
+	 * overwritten since (see \ref IQBuffer::isOverrun).
+	 */
+	IQBuffer::Cursor fftMarkToRawCursor(int mark);
 	/**
 	 * \brief Converts number of FFT samples to number raw I/Q samples.
 	 */
@@ -86,7 +164,17 @@ public:
 		return ((double)sampleCount / (double)getFFTSampleRate()) * (double)getSampleRate();
 	}
 	
+	/**
+	 * \brief Returns the number of FFT rows the recorder needs to be kept
+	 *        in the buffer.
+	 */
 	virtual int requestBufferSize() { return 0; }
+	/**
+	 * \brief Returns the number of raw I/Q samples the recorder needs to be
+	 *        kept in the raw buffer, beyond the raw data of the FFT rows
+	 *        requested by \ref requestBufferSize.
+	 */
+	virtual int requestRawBufferSize() { return 0; }
 	
 	/**
 	 * \brief Callback called at the beginning of the FFT stream.
@@ -100,6 +188,12 @@ public:
 	 * \brief Callback periodically called on FFT input.
 	 */
 	virtual void update() = 0;
+	/**
+	 * \brief Callback called from the processing thread after new rows are published.
+	 *
+	 * \param head cursor pointing after the last published row
+	 */
+	virtual void published(Cursor head) {}
 };
 
 
@@ -113,29 +207,46 @@ public:
  */
 class SnapshotRecorder : public Recorder {
 protected:
+	/**
+	 * \brief Detection recorded by a snapshot (see \ref reportEvent).
+	 */
+	struct Event {
+		WFTime time;          ///< Time of the detection.
+		float  noise;
+		float  peakFrequency; ///< In Hz.
+		float  magnitude;
+		float  duration;      ///< In seconds.
+	};
+	
 	/**
 	 * \brief Specifies a snapshot within \ref Recorder::buffer_ buffer.
 	 */
 	struct Snapshot {
-		int start; ///< Start position of the snapshot in \ref Recorder::buffer_ buffer.
-		int length; ///< Length of the snapshot in number of FFT rows.
-		
-		int reservation; ///< Handle of the buffer reservation. See \ref RingBuffer2D for more information.
+		Cursor start; ///< Start position of the snapshot in \ref Recorder::buffer_ buffer.
+		int    length; ///< Length of the snapshot in number of FFT rows.
 		
 		bool includeRawData;
-
-		string fileName;
+		IQBuffer::Cursor rawStart; ///< Raw data of the first row, set when the snapshot is complete (see \ref published).
+		
+		WFTime time; ///< Time of the first row, determines the file name (see \ref getFileName).
+		
+		uint64_t queued; ///< Time the snapshot was queued for writing (see \ref LatencyHistogram::now).
+		
+		bool  hasEvent; ///< The snapshot records \ref event.
+		Event event;
 		
 		Snapshot() :
-			start(0), length(0),
-			reservation(-1),
-			includeRawData(false)
+			start(), length(0),
+			includeRawData(false),
+			queued(0),
+			hasEvent(false)
 		{}
 		
-		Snapshot(int start) :
+		Snapshot(Cursor start) :
 			start(start), length(0),
-			reservation(-1),
-			includeRawData(false)
+			includeRawData(false),
+			queued(0),
+			hasEvent(false)
 		{}
 		
 		/**
@@ -146,32 +257,48 @@ protected:
 		 * \returns the position in \ref WaterfallBackend buffer after the last
 		 *          row of this snapshot
 		 */
-		inline int end() const { return start + length; }
+		inline Cursor end() const { return start + length; }
 	};
 	
 	string outputDir_; ///< Directory to store the resulting snapshot files in.
 	string outputType_; ///< Short string identifying the type of the output (snapshots/bolids).
-	bool   compressOutput_; ///< Output compressed file.
+	FITSCompression compression_; ///< Compression of the snapshot images.
+	Quicklook       quicklook_;   ///< Renderer of the PNG quicklook images (see \ref writeQuicklook).
 	
 	int   snapshotLength_;
 	float leftFrequency_;
 	float rightFrequency_;
 	bool  writeUnfinished_;
+	bool  rawPlanar_; ///< Write raw I/Q data as two planes instead of I/Q pairs.
+	bool  rawInt16_;  ///< Write raw I/Q data as 16-bit integers instead of floats.
+	bool  reportMetrics_; ///< Log the processing times and dump the metrics at every snapshot.
+	
+	vector<float>   rawPairs_; ///< Raw I/Q data interleaved for writing (see \ref writeRaw).
+	vector<int16_t> rawInts_;  ///< Raw I/Q data converted to integers for writing (see \ref writeRaw).
 	
 	int      snapshotRows_;
 	int      leftBin_;
 	int      rightBin_;
 	Snapshot nextSnapshot_;
 	
-	typedef MethodThread<void, SnapshotRecorder> Thread;
-	Thread            *workerThread_;
-	Channel<Snapshot>  snapshots_;
+	vector<Snapshot>   pending_; ///< Snapshots waiting for their rows to be published (see \ref published).
+	LatencyHistogram   queueLatency_; ///< Time between queueing a snapshot and writing it.
+	LatencyHistogram   writeLatency_; ///< Time spent writing a snapshot.
 	
-	void*        threadMethod();
 	void         startWriting();
+	void         writeSnapshot(const Snapshot &snapshot);
 	virtual void writeHeader(FITSWriter *writer);
 	virtual void write(Snapshot snapshot);
 	virtual void writeRaw(Snapshot snapshot);
+	void         writeQuicklook(Snapshot snapshot);
+	
+	/**
+	 * \brief Reports the event of a snapshot (metadata, console, log).
+	 *
+	 * Called by the writer thread before the snapshot is written, so that
+	 * the processing thread doesn't format or log anything.
+	 */
+	virtual void reportEvent(const Snapshot &snapshot) {}
 	
 	bool        listenToNoise_;
 	float       noise_;
@@ -180,7 +307,10 @@ protected:
 	
 	static void processNoiseMessage(const NoiseMessage &msg, void *data);
 	
-	string getFileName(int mark);
+	/**
+	 * \brief Returns the time of the row at \c start.
+	 */
+	WFTime getTime(Cursor start);
 
 public:
 	SnapshotRecorder(Ref<WaterfallBackend>  backend,
@@ -194,11 +324,14 @@ public:
 		Recorder(backend),
 		outputDir_(outputDir),
 		outputType_(outputType),
-		compressOutput_(compressOutput),
+		compression_(compressOutput ? RICE_1 : NOCOMPRESS),
 		snapshotLength_(snapshotLength),
 		leftFrequency_(leftFrequency),
 		rightFrequency_(rightFrequency),
 		writeUnfinished_(true),
+		rawPlanar_(false),
+		rawInt16_(false),
+		reportMetrics_(true),
 		listenToNoise_(listenToNoise)
 	{
 		ORDER_PAIR(leftFrequency_, rightFrequency_);
@@ -218,11 +351,182 @@ public:
 	
 	virtual int requestBufferSize();
 	
+	virtual string getLatencyName() { return outputType_; }
+	
+	/**
+	 * \brief Selects the layout of raw I/Q data files.
+	 *
+	 * By default, raw data are written as an image of 2 x N pixels with one
+	 * I/Q pair per row. In the planar layout, the image has N x 2 pixels,
+	 * the first row holding the I samples and the second one the Q
+	 * samples, which are written straight from \ref IQBuffer planes.
+	 */
+	void setRawPlanar(bool value) { rawPlanar_ = value; }
+	
+	/**
+	 * \brief Selects 16-bit integer raw I/Q data files.
+	 *
+	 * Samples are clipped to -1 -- 1 and stored as 16-bit integers with
+	 * BSCALE = 1 / 32767, which halves the size of the files.
+	 */
+	void setRawInt16(bool value) { rawInt16_ = value; }
+	
+	/**
+	 * \brief Sets the compression of the snapshot images (raw data are
+	 *        never compressed).
+	 */
+	void setCompression(const FITSCompression &compression) { compression_ = compression; }
+	
+	/**
+	 * \brief Reads the compression parameters from the config of a recorder.
+	 *
+	 * The config keys are \c compress_output, \c compression,
+	 * \c tile_width, \c tile_height and \c quantize_level.
+	 */
+	static FITSCompression readCompression(Ref<DynObject> config);
+	
+	/**
+	 * \brief Enables PNG quicklook images of the snapshots, rendered
+	 *        straight from the buffer after the FITS file is written.
+	 */
+	void setQuicklook(const Quicklook &quicklook) { quicklook_ = quicklook; }
+	
+	/**
+	 * \brief Reads the quicklook parameters from the config of a recorder.
+	 *
+	 * The config keys are \c quicklook, \c quicklook_width,
+	 * \c quicklook_height, \c quicklook_low, \c quicklook_high and
+	 * \c quicklook_colormap.
+	 */
+	static Quicklook readQuicklook(Ref<DynObject> config);
+	
 	virtual void start();
 	virtual void stop();
 	virtual void update();
+	virtual void published(Cursor head);
 	
 	static Ref<DIObject> make(Ref<DynObject> config, Ref<DIObject> parent);
+	
+	friend class SnapshotWriterPool;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SNAPSHOT WRITER POOL
+////////////////////////////////////////////////////////////////////////////////
+
+
+/**
+ * \brief Pool of threads writing the snapshots of all \ref SnapshotRecorder
+ *        instances.
+ *
+ * Recorders submit their snapshots once all rows are published. Jobs are
+ * taken by priority (snapshots with raw data of an event first), then in
+ * the order of submission. Jobs of one recorder are written one at a time
+ * and in order, so a slow write only delays the other recorders if all
+ * threads are busy.
+ *
+ * The queue is bounded and preallocated. When it is full, the newest job
+ * of the lowest priority is dropped to make room for a job of a higher
+ * priority, otherwise the submitted job is dropped. Drops are only
+ * counted on the submitting (processing) thread and logged later by the
+ * writer threads and \ref dump.
+ *
+ * The threads run while at least one recorder is attached (see
+ * \ref attach).
+ */
+class SnapshotWriterPool {
+public:
+	static const int PRIORITY_ROUTINE = 0;
+	static const int PRIORITY_EVENT   = 1;
+
+private:
+	typedef SnapshotRecorder::Snapshot Snapshot;
+	
+	struct Job {
+		SnapshotRecorder *recorder;
+		Snapshot          snapshot;
+		int               priority;
+		uint64_t          sequence; ///< Order of submission.
+	};
+	
+	typedef MethodThread<void, SnapshotWriterPool> Thread;
+	
+	int threadCount_;
+	int queueSize_;
+	int users_; ///< Number of attached recorders.
+	
+	vector<Thread*>           threads_;
+	vector<Job>               queue_;
+	vector<SnapshotRecorder*> running_; ///< Recorders whose job is being written.
+	uint64_t                  sequence_;
+	bool                      stopping_;
+	
+	int               maxDepth_;   ///< Maximal queue depth since the last \ref dump.
+	volatile uint32_t dropped_;    ///< Number of jobs dropped since the last \ref dump, updated atomically.
+	volatile uint32_t unreported_; ///< Number of dropped jobs not yet logged (see \ref reportDropped).
+	
+	Mutex     mutex_;
+	Condition condition_;
+	
+	SnapshotWriterPool();
+	SnapshotWriterPool(const SnapshotWriterPool& other);
+	
+	bool isQueued(SnapshotRecorder *recorder);
+	bool isRunning(SnapshotRecorder *recorder);
+	int  nextJob();
+	void drop();
+	void reportDropped();
+	
+	void* threadMethod();
+
+public:
+	static SnapshotWriterPool& getInstance();
+	
+	/**
+	 * \brief Sets the number of threads and the queue size.
+	 *
+	 * Takes effect when the threads are started by the first \ref attach.
+	 */
+	void configure(int threadCount, int queueSize);
+	
+	/**
+	 * \brief Registers a recorder, starting the threads for the first one.
+	 */
+	void attach();
+	/**
+	 * \brief Unregisters a recorder, stopping the threads after the last one.
+	 */
+	void detach();
+	
+	/**
+	 * \brief Queues a complete snapshot for writing.
+	 *
+	 * Doesn't allocate, so it can be called from the processing thread.
+	 *
+	 * \returns \c false if the snapshot was dropped
+	 */
+	bool submit(SnapshotRecorder *recorder, const Snapshot &snapshot, int priority);
+	
+	/**
+	 * \brief Waits until all snapshots of \c recorder are written.
+	 */
+	void flush(SnapshotRecorder *recorder);
+	
+	int getDepth();
+	
+	/**
+	 * \brief Returns the number of jobs dropped since the last \ref dump
+	 *        with \c clear set.
+	 */
+	uint32_t getDropped() const { return dropped_; }
+	
+	/**
+	 * \brief Logs the queue depth and the number of dropped jobs.
+	 *
+	 * \param clear if \c true, the maximal depth and the drop count are reset
+	 */
+	void dump(bool clear = false);
 };
 
 
@@ -235,10 +539,19 @@ public:
  * \brief Represents a backend that calculates FFT from the input and records
  *        the result through multiple recorders.
  *
+ * Optionally, the backend computes spectral kurtosis (SK) of every bin over
+ * blocks of \c sk_frames FFT rows while calculating the magnitudes. Bins
+ * with the SK estimate deviating from 1 (the value for Gaussian noise) by
+ * more than \c sk_threshold standard deviations are marked in an RFI mask.
+ * When a block is complete, its mask is written to the mask rows of all
+ * the FFT rows of the block and published, see \ref Recorder::getRFIMask.
+ * The mask rows thus lag the FFT rows by up to \c sk_frames - 1 rows,
+ * and the rows of the last incomplete block of a stream have no mask.
  */
 class WaterfallBackend : public FFTBackend {
 public:
-	typedef RingBuffer2D<float> FFTBuffer;
+	typedef RingBuffer2D<uint8_t> FFTBuffer;
+	typedef RingBuffer2D<uint8_t> MaskBuffer;
 
 private:
 	WaterfallBackend(const WaterfallBackend& other);
@@ -247,19 +560,49 @@ private:
 	
 	FFTBuffer              buffer_;
 	int                    bufferChunkSize_;
-	Mutex                  bufferMutex_;
+	bool                   bufferPowerOfTwo_; ///< use the power-of-two layout for \ref buffer_
+	RowCodec               rowCodec_;         ///< storage format of the rows in \ref buffer_
+	vector<float>          magnitudes_;       ///< magnitudes of the current row when not stored as floats
+	AllocationPolicy       bufferPolicy_;     ///< allocation policy of \ref buffer_ and \ref maskBuffer_
+	float                  historyLength_;    ///< minimal length of \ref buffer_ in seconds
+	string                 historyDir_;       ///< directory of the file backing \ref buffer_, empty to keep it in RAM
+	int                    historyResidentChunks_; ///< number of recent chunks of a file-backed \ref buffer_ kept in RAM
 	vector<RawDataHandle>  rawHandles_;
 	
 	vector<Ref<Recorder> > recorders_;
 	
+	int                    skFrames_;    ///< number of FFT rows in a spectral kurtosis block, 0 disables SK
+	float                  skThreshold_; ///< RFI threshold in standard deviations of the SK estimate
+	int                    skCount_;     ///< number of rows accumulated in the current SK block
+	vector<double>         skSum1_;      ///< sum of power per bin (in row order)
+	vector<double>         skSum2_;      ///< sum of squared power per bin (in row order)
+	vector<uint8_t>        rfiMask_;     ///< RFI mask of the last complete SK block
+	MaskBuffer             maskBuffer_;  ///< RFI mask rows parallel to \ref buffer_
+	
+	LatencyHistogram       magnitudeLatency_; ///< magnitude (and SK) calculation of one FFT row
+	
+	typedef MethodThread<void, WaterfallBackend> Thread;
+	
+	Thread                *historyThread_;   ///< ages the chunks of a file-backed history, \c NULL if not running
+	volatile bool          historyStopping_;
+	
+	void computeMagnitudes(const fftw_complex *data, int from, int to, int shift, float *row);
+	void updateRFIMask();
+	
+	void  startHistoryThread();
+	void  stopHistoryThread();
+	void* historyThreadMethod();
+	
 	string                 metadataPath_;
 	Ref<CsvLog>            metadataFile_;
 	Mutex                  metadataFileLock_;
 
 protected:
-	virtual void processFFT(const fftw_complex *data, int size, DataInfo info, int rawMark);
+	virtual void processFFT(const fftw_complex *data, int size, DataInfo info, const RawDataHandle &raw);
 	
 public:
+	static const int HISTORY_POLL_INTERVAL = 50; ///< In milliseconds.
+	
 	WaterfallBackend(int bins,
 				  int overlap,
 				  string origin);
@@ -273,13 +616,60 @@ public:
 	int getBufferChunkSize() { return bufferChunkSize_; }
 	void setBufferChunkSize(int value) { bufferChunkSize_ = value; }
 	
+	RowFormat getRowFormat() { return rowCodec_.getFormat(); }
+	/**
+	 * \brief Sets the storage format of the FFT rows for the next stream.
+	 *
+	 * Formats other than \c ROW_FLOAT32 reduce the memory used by the FFT
+	 * buffer and the size of the snapshot files (see \ref RowCodec).
+	 */
+	void setRowFormat(RowFormat format) { rowCodec_ = RowCodec(format, getBins()); }
+	
+	bool getBufferPowerOfTwo() { return bufferPowerOfTwo_; }
+	/**
+	 * \brief Selects the power-of-two layout of the FFT buffer (see \ref RingBuffer2D::setPowerOfTwo).
+	 */
+	void setBufferPowerOfTwo(bool value) { bufferPowerOfTwo_ = value; }
+	
+	const AllocationPolicy& getBufferPolicy() { return bufferPolicy_; }
+	void setBufferPolicy(const AllocationPolicy &value) { bufferPolicy_ = value; }
+	
+	/**
+	 * \brief Sets the length of the FFT history kept by the backend.
+	 *
+	 * The FFT buffer holds at least \c length seconds of FFT rows, even
+	 * if the recorders need less, so that the recorders can look back
+	 * further. If \c directory is not empty, the buffer is backed by a
+	 * file in that directory and only \c residentChunks recent chunks are
+	 * kept in RAM (see \ref RingBuffer2D::setBackingFile). The chunks are
+	 * aged by a housekeeping thread every \ref HISTORY_POLL_INTERVAL, so
+	 * that the processing thread never waits for the disk. Raw I/Q data
+	 * are only kept for as long as the recorders request.
+	 */
+	void setHistory(float length, const string &directory, int residentChunks)
+	{
+		historyLength_         = length;
+		historyDir_            = directory;
+		historyResidentChunks_ = residentChunks;
+	}
+	
+	float getHistoryLength() { return historyLength_; }
+	
+	int  getSKFrames() { return skFrames_; }
+	void setSKFrames(int value) { skFrames_ = (value < 2) ? 0 : value; }
+	
+	float getSKThreshold() { return skThreshold_; }
+	void  setSKThreshold(float value) { skThreshold_ = value; }
+	
 	void addRecorder(Ref<Recorder> recorder);
 	
 	virtual void startStream(StreamInfo info);
 	virtual void endStream();
 	
+	virtual void reportMemory(vector<MemoryUsage> &usage);
+	
 	virtual bool injectDependency(Ref<DIObject> obj, std::string key);
-
+	
 	static Ref<DIObject> make(Ref<DynObject> config, Ref<DIObject> parent);
 	
 	inline int fftSamplesToRaw(int sampleCount)
@@ -10,6 +10,7 @@
 #define UTILS_Q7Z8RACX
 
 
+#include <stdint.h>
 #include <utility>
 using namespace std;
 
@@ -54,6 +55,20 @@ pair<T, T> orderPair(T a, T b)
 }
 
 
+/**
+ * \brief Stores integer \c value to \c dest in little endian byte order.
+ *
+ * \returns pointer after the stored value
+ */
+template<class T>
+inline uint8_t* putLE(uint8_t *dest, T value)
+{
+	for (size_t i = 0; i < sizeof(T); i++)
+		dest[i] = (uint8_t)((uint64_t)value >> (8 * i));
+	return dest + sizeof(T);
+}
+
+
 #define ORDER_PAIR(a, b) { \
 	if ((a) > (b)) { \
 		VAR(temp__, (a)); \
@@ -0,0 +1,248 @@
+/**
+ * \file   AllocationTest.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the AllocationTest class.
+ */
+
+#ifndef ALLOCATIONTEST_V8HC3TNE
+#define ALLOCATIONTEST_V8HC3TNE
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "../src/WaterfallBackend.h"
+#include "../src/BolidRecorder.h"
+#include "../src/BolidMessage.h"
+
+
+/// Number of calls to operator new by the calling thread since its start.
+static __thread int allocationCount = 0;
+
+
+// The allocation functions are replaced for the whole test program, the
+// counting is cheap enough not to matter for the other tests. Only the
+// allocations of the processing thread are counted, the snapshot writer
+// threads may allocate.
+void* operator new(size_t size)
+{
+	allocationCount++;
+	void *result = malloc(size == 0 ? 1 : size);
+	if (result == NULL)
+		throw std::bad_alloc();
+	return result;
+}
+
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+
+__attribute__((noinline)) void operator delete(void *ptr) throw()
+{
+	free(ptr);
+}
+
+
+void operator delete[](void *ptr) throw()
+{
+	operator delete(ptr);
+}
+
+
+/**
+ * \brief Checks that the per-frame processing path doesn't allocate after warm-up.
+ *
+ * The test feeds blocks of synthetic noise, the way a frontend would, to
+ * a \ref WaterfallBackend with a \ref BolidRecorder, so every block goes
+ * through \ref FFTBackend::process (I/Q correction, blanking, raw
+ * history, windowing and FFT), \ref WaterfallBackend::processFFT (row
+ * encoding, spectral kurtosis, publishing) and \ref BolidRecorder::update
+ * (detection and noise messages), and counts the calls to operator new.
+ *
+ * Bursts of a tone in the detection band are detected as meteors, so the
+ * measured blocks also queue snapshots with raw data, submit them to the
+ * \ref SnapshotWriterPool and send bolid messages. The snapshots and the
+ * metadata are written to a temporary directory.
+ */
+class AllocationTest : public TestCase {
+public:
+	static const int SAMPLE_RATE     = 48000;
+	static const int BLOCK_COUNT     = 400;
+	static const int MEASURED_BLOCK  = 200; ///< First block counted.
+	static const int BURST_PERIOD    = 96000; ///< In samples.
+	static const int BURST_LENGTH    = 9600;  ///< In samples.
+	
+	static int noiseMessages_;
+	static int bolidMessages_;
+	
+	static void onNoise(const NoiseMessage &msg, void *data)
+	{
+		noiseMessages_++;
+	}
+	
+	static void onBolid(const BolidMessage &msg, void *data)
+	{
+		bolidMessages_++;
+	}
+	
+	AllocationTest()
+	{
+		TEST_ADD(AllocationTest, testSteadyState);
+		TEST_ADD(AllocationTest, testSteadyStateFixedPoint);
+		
+		addListener<NoiseMessage>(&AllocationTest::onNoise, NULL);
+		addListener<BolidMessage>(&AllocationTest::onBolid, NULL);
+	}
+	
+	/**
+	 * \brief Returns the number of lines of the metadata files in \c dir
+	 *        with entries of \c type snapshots, deletes the files.
+	 */
+	static int readMetadata(const string &dir, const string &type)
+	{
+		int lines = 0;
+		
+		DIR *d = opendir(dir.c_str());
+		struct dirent *entry;
+		while ((entry = readdir(d)) != NULL) {
+			if (entry->d_name[0] == '.') continue;
+			
+			string name = Path::join(dir, entry->d_name);
+			if (name.find("_meta.csv") != string::npos) {
+				ifstream file(name.c_str());
+				string   line;
+				while (getline(file, line)) {
+					if (line.find("_" + type + ".") != string::npos)
+						lines++;
+				}
+			}
+			unlink(name.c_str());
+		}
+		closedir(d);
+		rmdir(dir.c_str());
+		
+		return lines;
+	}
+	
+	void runBackend(bool fixedPoint)
+	{
+		const int bins       = 256;
+		const int blockSize  = 1024;
+		const int blockCount = 16;
+		
+		char dir[] = "/tmp/allocationtestXXXXXX";
+		TEST_ASSERT(mkdtemp(dir) != NULL, "temporary directory should be created");
+		
+		// Noise generated in advance, as in CapacityPlanner::calibrate.
+		vector<vector<Complex> > blocks(blockCount, vector<Complex>(blockSize));
+		srand(1);
+		FOR_EACH(blocks, block) {
+			FOR_EACH(*block, sample) {
+				double u1 = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+				double u2 = (double)rand() / (double)RAND_MAX;
+				double r  = 0.1 * sqrt(-2.0 * log(u1));
+				sample->real = r * cos(2.0 * M_PI * u2);
+				sample->imag = r * sin(2.0 * M_PI * u2);
+			}
+		}
+		
+		// Tone at 11 kHz, in the detection band of the recorder.
+		vector<Complex> tone(BURST_PERIOD);
+		for (int i = 0; i < BURST_PERIOD; i++) {
+			double phase = 2.0 * M_PI * 11000.0 * (double)i / (double)SAMPLE_RATE;
+			tone[i].real = cos(phase);
+			tone[i].imag = sin(phase);
+		}
+		vector<Complex> data(blockSize);
+		
+		Ref<WaterfallBackend> backend = new WaterfallBackend(bins, bins / 4, "test");
+		backend->setFixedPoint(fixedPoint);
+		backend->setRowFormat(ROW_LOG8);
+		backend->setSKFrames(16);
+		backend->getBlanker().setThreshold(10.0f);
+		backend->setMetadataPath(dir);
+		backend->addRecorder(new BolidRecorder(
+			backend, 2, 0.0f, 0.0f, dir, "bolids", false,
+			10000.0f, 12000.0f, 5000.0f, 15000.0f,
+			0.5, 0.5, 1000.0f, 2.0f, 60.0));
+		
+		noiseMessages_ = 0;
+		bolidMessages_ = 0;
+		
+		StreamInfo streamInfo;
+		streamInfo.sampleRate = SAMPLE_RATE;
+		streamInfo.timeOffset = WFTime::now();
+		backend->startStream(streamInfo);
+		
+		DataInfo info;
+		info.timeOffset = streamInfo.timeOffset;
+		
+		int before       = 0;
+		int bolidsBefore = 0;
+		for (int i = 0; i < BLOCK_COUNT; i++) {
+			if (i == MEASURED_BLOCK) {
+				before       = allocationCount;
+				bolidsBefore = bolidMessages_;
+			}
+			
+			// A burst of the tone ends every BURST_PERIOD samples.
+			const vector<Complex> &noise = blocks[i % blockCount];
+			for (int k = 0; k < blockSize; k++) {
+				int t = (int)((info.offset + k) % BURST_PERIOD);
+				data[k] = noise[k];
+				if (t >= BURST_PERIOD - BURST_LENGTH) {
+					data[k].real += tone[t].real;
+					data[k].imag += tone[t].imag;
+				}
+			}
+			
+			backend->process(data, info);
+			
+			info.offset    += blockSize;
+			info.timeOffset = streamInfo.timeOffset.addSamples(info.offset, SAMPLE_RATE);
+		}
+		
+		TEST_EQUALS(0, allocationCount - before, "steady state should not allocate");
+		
+		int rows = (BLOCK_COUNT * blockSize - bins) / (bins - bins / 4) + 1;
+		TEST_EQUALS(rows, noiseMessages_, "every FFT row should be passed to the recorder");
+		TEST_ASSERT(bolidMessages_ - bolidsBefore >= 2, "bursts should be detected after warm-up");
+		
+		backend->endStream();
+		
+		// The metadata entries are written by the writer threads, one
+		// for each detected burst.
+		TEST_EQUALS(bolidMessages_, readMetadata(dir, "bolids"), "every burst should be reported");
+	}
+	
+	void testSteadyState()
+	{
+		runBackend(false);
+	}
+	
+	void testSteadyStateFixedPoint()
+	{
+		runBackend(true);
+	}
+};
+
+int AllocationTest::noiseMessages_ = 0;
+int AllocationTest::bolidMessages_ = 0;
+
+RUN_SUITE(AllocationTest);
+
+
+#endif /* end of include guard: ALLOCATIONTEST_V8HC3TNE */
@@ -0,0 +1,196 @@
+/**
+ * \file   BasebandRecorderTest.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the BasebandRecorderTest class.
+ */
+
+#ifndef BASEBANDRECORDERTEST_P6WQ2JZN
+#define BASEBANDRECORDERTEST_P6WQ2JZN
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "../src/BasebandRecorder.h"
+
+
+/**
+ * \brief \ref BasebandRecorder with access to the sizes of the buffers.
+ */
+class BufferSizeRecorder : public BasebandRecorder {
+public:
+	int fftCapacity;
+	int rawCapacity;
+	
+	BufferSizeRecorder(Ref<WaterfallBackend> backend, string outputDir,
+				    double bufferLength, int blockSize) :
+		BasebandRecorder(backend, outputDir, "base", FORMAT_WAV, false,
+					  0, 0, bufferLength, blockSize),
+		fftCapacity(0), rawCapacity(0)
+	{}
+	
+	virtual void start()
+	{
+		fftCapacity = buffer_->getCapacity();
+		rawCapacity = rawBuffer_->getCapacity();
+		BasebandRecorder::start();
+	}
+};
+
+
+/**
+ * \brief Records the raw input to a WAV file and reads it back.
+ */
+class BasebandRecorderTest : public TestCase {
+public:
+	static const int SAMPLE_RATE = 48000;
+	static const int BINS        = 256;
+	static const int BLOCK_SIZE  = 4096;
+	
+	BasebandRecorderTest()
+	{
+		TEST_ADD(BasebandRecorderTest, testWAVFile);
+		TEST_ADD(BasebandRecorderTest, testBufferSize);
+	}
+	
+	static uint32_t getLE32(const std::vector<uint8_t> &data, size_t offset)
+	{
+		return (uint32_t)data[offset] | ((uint32_t)data[offset + 1] << 8) |
+			((uint32_t)data[offset + 2] << 16) | ((uint32_t)data[offset + 3] << 24);
+	}
+	
+	static bool hasBytes(const std::vector<uint8_t> &data, size_t offset, const char *bytes)
+	{
+		size_t size = strlen(bytes);
+		return (offset + size <= data.size()) && (memcmp(&(data[offset]), bytes, size) == 0);
+	}
+	
+	/**
+	 * \brief Feeds \c blocks blocks of \c blockSize samples to a backend
+	 *        with \c recorder.
+	 */
+	static void run(Ref<WaterfallBackend> backend, Recorder *recorder,
+				 std::vector<Complex> *samples, int blocks, int blockSize)
+	{
+		backend->addRecorder(recorder);
+		
+		StreamInfo streamInfo;
+		streamInfo.sampleRate = SAMPLE_RATE;
+		streamInfo.timeOffset = WFTime(1700000000, 0);
+		backend->startStream(streamInfo);
+		
+		std::vector<Complex> data(blockSize);
+		DataInfo             info;
+		info.timeOffset = streamInfo.timeOffset;
+		srand(3);
+		for (int block = 0; block < blocks; block++) {
+			FOR_EACH(data, sample) {
+				sample->real = (double)rand() / (double)RAND_MAX - 0.5;
+				sample->imag = (double)rand() / (double)RAND_MAX - 0.5;
+			}
+			if (samples != NULL)
+				samples->insert(samples->end(), data.begin(), data.end());
+			
+			backend->process(data, info);
+			info.offset    += blockSize;
+			info.timeOffset = streamInfo.timeOffset.addSamples(info.offset, SAMPLE_RATE);
+		}
+		
+		backend->endStream();
+	}
+	
+	void testWAVFile()
+	{
+		char dir[] = "/tmp/basebandtestXXXXXX";
+		TEST_ASSERT(mkdtemp(dir) != NULL, "temporary directory should be created");
+		
+		// Not a whole number of blocks, so that the last block is short.
+		const int blocks    = 100;
+		const int blockSize = 1000;
+		
+		std::vector<Complex> samples;
+		Ref<WaterfallBackend> backend = new WaterfallBackend(BINS, 0, "test");
+		run(backend, new BufferSizeRecorder(backend, dir, 1.0, BLOCK_SIZE),
+		    &samples, blocks, blockSize);
+		
+		std::vector<string> names;
+		DIR *d = opendir(dir);
+		struct dirent *entry;
+		while ((entry = readdir(d)) != NULL) {
+			if (entry->d_name[0] != '.')
+				names.push_back(Path::join(dir, entry->d_name));
+		}
+		closedir(d);
+		TEST_EQUALS(1, (int)names.size(), "one file should be written");
+		if (names.size() != 1) return;
+		
+		std::vector<uint8_t> data;
+		FILE *file = fopen(names[0].c_str(), "rb");
+		int byte;
+		while ((byte = fgetc(file)) != EOF)
+			data.push_back((uint8_t)byte);
+		fclose(file);
+		unlink(names[0].c_str());
+		rmdir(dir);
+		
+		uint32_t dataBytes = blocks * blockSize * 2 * sizeof(float);
+		TEST_EQUALS((size_t)(BLOCK_SIZE + dataBytes), data.size(), "file size");
+		
+		// RIFF header, format chunk, the padding and the data chunk
+		// header end at the block size.
+		TEST_ASSERT(hasBytes(data, 0, "RIFF"), "RIFF chunk");
+		TEST_EQUALS(data.size() - 8, (size_t)getLE32(data, 4), "RIFF chunk size");
+		TEST_ASSERT(hasBytes(data, 8, "WAVEfmt "), "format chunk");
+		TEST_EQUALS(16u, getLE32(data, 16), "format chunk size");
+		TEST_EQUALS((uint32_t)SAMPLE_RATE, getLE32(data, 24), "sample rate");
+		TEST_ASSERT(hasBytes(data, 36, "JUNK"), "padding chunk");
+		TEST_EQUALS((uint32_t)(BLOCK_SIZE - 52), getLE32(data, 40), "padding chunk size");
+		TEST_ASSERT(hasBytes(data, BLOCK_SIZE - 8, "data"), "data chunk");
+		TEST_EQUALS(dataBytes, getLE32(data, BLOCK_SIZE - 4), "data chunk size");
+		
+		int errors = 0;
+		for (size_t i = 0; i < samples.size(); i++) {
+			float iq[2];
+			memcpy(iq, &(data[BLOCK_SIZE + i * sizeof(iq)]), sizeof(iq));
+			if ((iq[0] != (float)samples[i].real) || (iq[1] != (float)samples[i].imag))
+				errors++;
+		}
+		TEST_EQUALS(0, errors, "samples should be written in order");
+	}
+	
+	void testBufferSize()
+	{
+		const double bufferLength[2] = { 0.1, 30.0 };
+		int          fftCapacity[2];
+		int          rawCapacity[2];
+		
+		for (int i = 0; i < 2; i++) {
+			Ref<WaterfallBackend> backend = new WaterfallBackend(BINS, 0, "test");
+			backend->setDryRun(true);
+			BufferSizeRecorder *recorder = new BufferSizeRecorder(backend, "/tmp", bufferLength[i], BLOCK_SIZE);
+			run(backend, recorder, NULL, 1, BINS);
+			fftCapacity[i] = recorder->fftCapacity;
+			rawCapacity[i] = recorder->rawCapacity;
+		}
+		
+		// The recorder needs the raw history only.
+		TEST_ASSERT(rawCapacity[1] >= bufferLength[1] * SAMPLE_RATE,
+				  "raw buffer should hold the requested history");
+		TEST_EQUALS(fftCapacity[0], fftCapacity[1],
+				  "FFT buffer should not grow with the raw history");
+	}
+};
+
+RUN_SUITE(BasebandRecorderTest);
+
+
+#endif /* end of include guard: BASEBANDRECORDERTEST_P6WQ2JZN */
@@ -0,0 +1,188 @@
+/**
+ * \file   ChunkFileTest.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the ChunkFileTest class.
+ */
+
+#ifndef CHUNKFILETEST_M7KD3PWX
+#define CHUNKFILETEST_M7KD3PWX
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "../src/ChunkFile.h"
+
+
+/**
+ * \brief Writes a chunked waterfall file and reads it back the way the
+ *        \c wfc2fits script does.
+ *
+ * The offsets and sizes match the struct formats of \c wfc2fits:
+ * \c FILE_HEADER "<8sIIIId32s", \c CHUNK_HEADER "<4sIIIqddQQ",
+ * \c INDEX_HEADER "<4sI", \c INDEX_ENTRY "<QqII" and \c TRAILER "<Q8s".
+ */
+class ChunkFileTest : public TestCase {
+public:
+	ChunkFileTest()
+	{
+		TEST_ADD(ChunkFileTest, testRoundTrip);
+	}
+	
+	template<class T>
+	static T getLE(const std::vector<uint8_t> &data, size_t offset)
+	{
+		uint64_t value = 0;
+		for (size_t i = 0; i < sizeof(T); i++)
+			value |= (uint64_t)data[offset + i] << (8 * i);
+		return (T)value;
+	}
+	
+	static double getDouble(const std::vector<uint8_t> &data, size_t offset)
+	{
+		uint64_t bits = getLE<uint64_t>(data, offset);
+		double   value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+	
+	static bool hasBytes(const std::vector<uint8_t> &data, size_t offset, const char *bytes, size_t size)
+	{
+		return (offset + size <= data.size()) && (memcmp(&(data[offset]), bytes, size) == 0);
+	}
+	
+	/**
+	 * \brief Fills the \c y-th row of a chunk, compressible if \c smooth.
+	 */
+	static void fillRow(uint8_t *row, int width, int y, bool smooth)
+	{
+		for (int x = 0; x < width; x++)
+			row[x] = smooth ? (uint8_t)y : (uint8_t)((x * 131 + y * 71) ^ (x >> 2));
+	}
+	
+	void testRoundTrip()
+	{
+		char path[] = "/tmp/chunkfiletestXXXXXX";
+		int  fd     = mkstemp(path);
+		TEST_ASSERT(fd >= 0, "temporary file should be created");
+		close(fd);
+		
+		const int    width   = 300;
+		const double rowRate = 32768.0 / 24576.0 * 8.7890625;
+		const int    rows[2] = { 4, 3 };
+		
+		ChunkFileWriter writer;
+		writer.setCompression(CHUNK_ZLIB);
+		TEST_ASSERT(writer.open(path, RowCodec(ROW_LOG8, width), rowRate, "test-station"),
+				  "file should be opened");
+		
+		for (int c = 0; c < 2; c++) {
+			// The first chunk compresses well, the second one is noise
+			// and is stored uncompressed.
+			writer.beginChunk(rows[c], WFTime(1700000000 + c, 250000), 9000.0 + c, 2.5);
+			for (int y = 0; y < rows[c]; y++) {
+				fillRow(writer.getRow(y), width, y, c == 0);
+				
+				RowScale scale;
+				scale.offset = -3.0f + y;
+				scale.step   = 0.05f;
+				writer.setScale(y, scale);
+			}
+			TEST_ASSERT(writer.endChunk(), "chunk should be written");
+		}
+		writer.close();
+		
+		std::vector<uint8_t> data;
+		FILE *file = fopen(path, "rb");
+		TEST_ASSERT(file != NULL, "file should be readable");
+		int byte;
+		while ((byte = fgetc(file)) != EOF)
+			data.push_back((uint8_t)byte);
+		fclose(file);
+		unlink(path);
+		
+		// File header
+		TEST_ASSERT(hasBytes(data, 0, "RADIOWFC", 8), "file magic");
+		TEST_EQUALS(1u, getLE<uint32_t>(data, 8), "version");
+		TEST_EQUALS(128u, getLE<uint32_t>(data, 12), "file header size");
+		TEST_EQUALS((uint32_t)ROW_LOG8, getLE<uint32_t>(data, 16), "row format");
+		TEST_EQUALS((uint32_t)width, getLE<uint32_t>(data, 20), "row width");
+		TEST_EQUALS(rowRate, getDouble(data, 24), "row rate");
+		TEST_ASSERT(hasBytes(data, 32, "test-station\0", 13), "origin");
+		
+		// Trailer and index
+		size_t   size        = data.size();
+		uint64_t indexOffset = getLE<uint64_t>(data, size - 16);
+		TEST_ASSERT(hasBytes(data, size - 8, "WFCTRAIL", 8), "trailer magic");
+		TEST_ASSERT(hasBytes(data, indexOffset, "INDX", 4), "index magic");
+		TEST_EQUALS(2u, getLE<uint32_t>(data, indexOffset + 4), "index count");
+		TEST_EQUALS(indexOffset + 8 + 2 * 24 + 16, (uint64_t)size, "index and trailer end the file");
+		
+		// Chunks, walked by their headers and checked against the index.
+		size_t offset = 128;
+		for (int c = 0; c < 2; c++) {
+			size_t entry = indexOffset + 8 + c * 24;
+			TEST_EQUALS((uint64_t)offset, getLE<uint64_t>(data, entry), "index offset");
+			TEST_EQUALS((int64_t)(1700000000 + c) * 1000000 + 250000, getLE<int64_t>(data, entry + 8),
+					  "index time");
+			TEST_EQUALS((uint32_t)rows[c], getLE<uint32_t>(data, entry + 16), "index rows");
+			
+			TEST_ASSERT(hasBytes(data, offset, "CHNK", 4), "chunk magic");
+			uint32_t codec       = getLE<uint32_t>(data, offset + 4);
+			uint64_t payloadSize = getLE<uint64_t>(data, offset + 40);
+			uint64_t storedSize  = getLE<uint64_t>(data, offset + 48);
+			
+			TEST_EQUALS((uint32_t)(c == 0 ? CHUNK_ZLIB : CHUNK_RAW), codec, "chunk codec");
+			TEST_EQUALS((uint32_t)rows[c], getLE<uint32_t>(data, offset + 8), "chunk rows");
+			TEST_EQUALS((int64_t)(1700000000 + c) * 1000000 + 250000, getLE<int64_t>(data, offset + 16),
+					  "chunk time");
+			TEST_EQUALS(9000.0 + c, getDouble(data, offset + 24), "chunk left frequency");
+			TEST_EQUALS(2.5, getDouble(data, offset + 32), "chunk bin width");
+			TEST_EQUALS((uint64_t)rows[c] * (width + 8), payloadSize, "payload is samples and scales");
+			TEST_ASSERT(offset + 56 + storedSize <= indexOffset, "stored payload fits before the index");
+			
+			std::vector<uint8_t> payload(payloadSize);
+			if (codec == CHUNK_ZLIB) {
+				TEST_ASSERT(storedSize < payloadSize, "compressed payload should be smaller");
+				uLongf decoded = payloadSize;
+				TEST_EQUALS(Z_OK, uncompress(&(payload[0]), &decoded, &(data[offset + 56]), storedSize),
+						  "payload should decompress");
+				TEST_EQUALS((uint64_t)decoded, payloadSize, "decompressed payload size");
+			} else {
+				TEST_EQUALS(payloadSize, storedSize, "raw payload is stored as is");
+				memcpy(&(payload[0]), &(data[offset + 56]), payloadSize);
+			}
+			
+			std::vector<uint8_t> expected(width);
+			for (int y = 0; y < rows[c]; y++) {
+				fillRow(&(expected[0]), width, y, c == 0);
+				TEST_ASSERT(memcmp(&(payload[y * width]), &(expected[0]), width) == 0, "row samples");
+				
+				float offsetScale, step;
+				uint32_t bits = getLE<uint32_t>(payload, rows[c] * width + y * 8);
+				memcpy(&offsetScale, &bits, sizeof(float));
+				bits = getLE<uint32_t>(payload, rows[c] * width + y * 8 + 4);
+				memcpy(&step, &bits, sizeof(float));
+				TEST_EQUALS(-3.0f + y, offsetScale, "row scale offset");
+				TEST_EQUALS(0.05f, step, "row scale step");
+			}
+			
+			offset += 56 + storedSize;
+		}
+		TEST_EQUALS((uint64_t)offset, indexOffset, "index follows the last chunk");
+	}
+};
+
+RUN_SUITE(ChunkFileTest);
+
+
+#endif /* end of include guard: CHUNKFILETEST_M7KD3PWX */
@@ -0,0 +1,242 @@
+/**
+ * \file   FixedFFTTest.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the FixedFFTTest class.
+ */
+
+#ifndef FIXEDFFTTEST_P2VZ8QLD
+#define FIXEDFFTTEST_P2VZ8QLD
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include <complex>
+
+#include "../src/FixedFFT.h"
+#include "../src/FFTBackend.h"
+
+
+/**
+ * \brief \ref FFTBackend keeping the magnitudes of all computed windows.
+ */
+class SpectrumBackend : public FFTBackend {
+public:
+	vector<vector<double> > spectra;
+	
+	SpectrumBackend(int bins, int overlap, bool fixedPoint) :
+		FFTBackend(bins, overlap)
+	{
+		setFixedPoint(fixedPoint);
+		resizeRawBuffer(4096);
+	}
+	
+protected:
+	virtual void processFFT(const fftw_complex *data, int size, DataInfo info, const RawDataHandle &raw)
+	{
+		vector<double> spectrum(size);
+		for (int i = 0; i < size; i++) {
+			if (isFixedPoint())
+				spectrum[i] = ldexp((double)BlockFloatFFT<>::magnitude(getFixedOutput() + 2 * i),
+								getFixedExponent());
+			else
+				spectrum[i] = sqrt(data[i][0] * data[i][0] + data[i][1] * data[i][1]);
+		}
+		spectra.push_back(spectrum);
+	}
+};
+
+
+/**
+ * \brief Compares the fixed-point FFT against a double precision FFT.
+ */
+class FixedFFTTest : public TestCase {
+public:
+	FixedFFTTest()
+	{
+		TEST_ADD(FixedFFTTest, testIsqrt);
+		TEST_ADD(FixedFFTTest, testZero);
+		TEST_ADD(FixedFFTTest, testAccuracy);
+		TEST_ADD(FixedFFTTest, testBackend);
+	}
+	
+	/**
+	 * \brief Reference double precision radix-2 FFT.
+	 */
+	static void referenceFFT(vector<complex<double> > &x)
+	{
+		int n = x.size();
+		
+		for (int i = 1, j = 0; i < n; i++) {
+			int bit = n >> 1;
+			for (; j & bit; bit >>= 1) j ^= bit;
+			j ^= bit;
+			if (i < j) swap(x[i], x[j]);
+		}
+		
+		for (int len = 2; len <= n; len <<= 1) {
+			complex<double> wl = polar(1.0, -2.0 * M_PI / len);
+			for (int i = 0; i < n; i += len) {
+				complex<double> w = 1.0;
+				for (int j = 0; j < len / 2; j++) {
+					complex<double> u = x[i + j];
+					complex<double> v = x[i + j + len / 2] * w;
+					x[i + j]           = u + v;
+					x[i + j + len / 2] = u - v;
+					w *= wl;
+				}
+			}
+		}
+	}
+	
+	void testIsqrt()
+	{
+		for (uint32_t v = 0; v < 100000; v++) {
+			uint32_t r = isqrt32(v);
+			TEST_ASSERT((r * r <= v) && ((r + 1) * (r + 1) > v),
+					  "isqrt32 should return floor of the square root");
+		}
+		TEST_EQUALS(46339u, isqrt32(2147352578u),
+				  "isqrt32 should handle the largest magnitude");
+	}
+	
+	void testZero()
+	{
+		int bins = 64;
+		vector<double>  in(2 * bins, 0.0);
+		vector<int16_t> data(2 * bins);
+		
+		BlockFloatFFT<> fft(bins);
+		BlockFloatFFT<>::quantize(&(in[0]), bins, &(data[0]));
+		fft.transform(&(data[0]));
+		
+		for (int i = 0; i < 2 * bins; i++) {
+			TEST_EQUALS(0, (int)data[i], "FFT of zeros should be zero");
+		}
+	}
+	
+	void testAccuracy(int bins, double scale)
+	{
+		vector<double>           in(2 * bins);
+		vector<int16_t>          data(2 * bins);
+		vector<complex<double> > reference(bins);
+		
+		// Windowed tone with some noise
+		srand(bins);
+		for (int i = 0; i < bins; i++) {
+			double w = 0.5 - 0.5 * cos(2.0 * M_PI * i / (bins - 1));
+			double phase = 2.0 * M_PI * 37.3 * i / bins;
+			in[2 * i]     = scale * w * (0.5 * cos(phase) + 0.01 * ((double)rand() / RAND_MAX - 0.5));
+			in[2 * i + 1] = scale * w * (0.5 * sin(phase) + 0.01 * ((double)rand() / RAND_MAX - 0.5));
+			reference[i]  = complex<double>(in[2 * i], in[2 * i + 1]);
+		}
+		
+		BlockFloatFFT<> fft(bins);
+		int exponent = BlockFloatFFT<>::quantize(&(in[0]), bins, &(data[0]));
+		exponent += fft.transform(&(data[0]));
+		referenceFFT(reference);
+		
+		double peak     = 0.0;
+		double maxError = 0.0;
+		int    peakBin  = 0;
+		int    fixedPeakBin = 0;
+		double fixedPeak    = 0.0;
+		
+		for (int i = 0; i < bins; i++) {
+			double expected = abs(reference[i]);
+			double actual   = ldexp((double)BlockFloatFFT<>::magnitude(&(data[2 * i])), exponent);
+			
+			if (expected > peak) { peak = expected; peakBin = i; }
+			if (actual > fixedPeak) { fixedPeak = actual; fixedPeakBin = i; }
+			if (fabs(expected - actual) > maxError) maxError = fabs(expected - actual);
+		}
+		
+		TEST_EQUALS(peakBin, fixedPeakBin,
+				  "fixed-point FFT should find the same peak as the double FFT");
+		TEST_ASSERT(maxError < peak * 1e-3,
+				  "fixed-point magnitude error should be below -60 dB of the peak");
+	}
+	
+	void testAccuracy()
+	{
+		testAccuracy(256,   1.0);
+		testAccuracy(4096,  1.0);
+		testAccuracy(32768, 1.0);
+		// WAV frontend passes raw 16-bit sample values
+		testAccuracy(4096,  32767.0);
+		testAccuracy(4096,  1e-3);
+	}
+	
+	/**
+	 * \brief Compares the fixed-point path of \ref FFTBackend against FFTW
+	 *        for input of the full scale \c scale, with a 40 dB louder
+	 *        section in the middle.
+	 */
+	void testBackend(double scale)
+	{
+		const int bins   = 256;
+		const int blocks = 40;
+		
+		Ref<SpectrumBackend> fixed = new SpectrumBackend(bins, bins / 2, true);
+		Ref<SpectrumBackend> fftw  = new SpectrumBackend(bins, bins / 2, false);
+		
+		StreamInfo streamInfo;
+		streamInfo.sampleRate = 48000;
+		fixed->startStream(streamInfo);
+		fftw->startStream(streamInfo);
+		TEST_ASSERT(fixed->isFixedPoint(), "fixed point should be used");
+		
+		vector<Complex> data(1000);
+		DataInfo        info;
+		srand(7);
+		for (int block = 0; block < blocks; block++) {
+			double level = ((block >= 10) && (block < 20)) ? 0.5 : 0.005;
+			for (int i = 0; i < (int)data.size(); i++) {
+				double phase = 2.0 * M_PI * 37.3 * (double)(info.offset + i) / bins;
+				data[i].real = scale * (level * cos(phase) + 1e-4 * ((double)rand() / RAND_MAX - 0.5));
+				data[i].imag = scale * (level * sin(phase) + 1e-4 * ((double)rand() / RAND_MAX - 0.5));
+			}
+			fixed->process(data, info);
+			fftw->process(data, info);
+			info.offset += data.size();
+		}
+		
+		TEST_ASSERT(!fftw->spectra.empty(), "windows should be computed");
+		TEST_EQUALS(fftw->spectra.size(), fixed->spectra.size(), "same number of windows");
+		
+		int wrongPeaks = 0;
+		int errors     = 0;
+		for (size_t w = 0; w < min(fftw->spectra.size(), fixed->spectra.size()); w++) {
+			const vector<double> &expected = fftw->spectra[w];
+			const vector<double> &actual   = fixed->spectra[w];
+			
+			int    peakBin      = max_element(expected.begin(), expected.end()) - expected.begin();
+			int    fixedPeakBin = max_element(actual.begin(), actual.end()) - actual.begin();
+			double maxError     = 0.0;
+			for (int i = 0; i < bins; i++)
+				maxError = max(maxError, fabs(expected[i] - actual[i]));
+			
+			if (peakBin != fixedPeakBin) wrongPeaks++;
+			if (maxError >= expected[peakBin] * 2e-3) errors++;
+		}
+		TEST_EQUALS(0, wrongPeaks, "fixed-point backend should find the same peaks as FFTW");
+		TEST_EQUALS(0, errors, "fixed-point backend error should be below -54 dB of the peak");
+		
+		fixed->endStream();
+		fftw->endStream();
+	}
+	
+	void testBackend()
+	{
+		// JACK frontend
+		testBackend(1.0);
+		// WAV frontend
+		testBackend(32767.0);
+	}
+};
+
+RUN_SUITE(FixedFFTTest);
+
+
+#endif /* end of include guard: FIXEDFFTTEST_P2VZ8QLD */
@@ -0,0 +1,81 @@
+/**
+ * \file   IQBufferTest.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the IQBufferTest class.
+ */
+
+#ifndef IQBUFFERTEST_Q2MZ8RWC
+#define IQBUFFERTEST_Q2MZ8RWC
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include <vector>
+
+#include "../src/IQBuffer.h"
+
+
+/**
+ * \brief Checks that the planar I/Q buffer splits samples into the planes.
+ */
+class IQBufferTest : public TestCase {
+public:
+	struct Sample {
+		double real;
+		double imag;
+	};
+	
+	IQBufferTest()
+	{
+		TEST_ADD(IQBufferTest, testPlanes);
+	}
+	
+	void testPlanes()
+	{
+		IQBuffer buffer;
+		buffer.resize(sizeof(float) * 16, 16 * 4);
+		int capacity = buffer.getCapacity();
+		
+		std::vector<Sample> block(23);
+		int pushed = 0;
+		for (int b = 0; b < 5; b++) {
+			for (int i = 0; i < (int)block.size(); i++) {
+				block[i].real = pushed + i;
+				block[i].imag = -(pushed + i);
+			}
+			buffer.push(&(block[0]), block.size());
+			buffer.publish();
+			pushed += block.size();
+		}
+		
+		TEST_EQUALS(pushed % capacity, buffer.mark(), "wrong head after push");
+		
+		IQBuffer::Cursor cursor = buffer.cursor(capacity);
+		TEST_EQUALS(capacity, buffer.available(cursor), "all samples should be available");
+		TEST_ASSERT(!buffer.isOverrun(cursor), "oldest sample should be intact");
+		
+		// Both planes use the same marks.
+		int mark  = buffer.mark(cursor);
+		int count = capacity;
+		int value = pushed - capacity;
+		while (count > 0) {
+			int rows;
+			float *i = buffer.plane(IQBuffer::PLANE_I).span(mark, count, &rows);
+			float *q = buffer.plane(IQBuffer::PLANE_Q).span(mark, rows, &rows);
+			for (int k = 0; k < rows; k++) {
+				TEST_EQUALS((float)(value + k), i[k], "I plane contains wrong data");
+				TEST_EQUALS((float)-(value + k), q[k], "Q plane contains wrong data");
+			}
+			mark  += rows;
+			count -= rows;
+			value += rows;
+		}
+	}
+};
+
+RUN_SUITE(IQBufferTest);
+
+
+#endif /* end of include guard: IQBUFFERTEST_Q2MZ8RWC */
@@ -0,0 +1,159 @@
+/**
+ * \file   ImpulseBlankerTest.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the ImpulseBlankerTest class.
+ */
+
+#ifndef IMPULSEBLANKERTEST_W3HX7QDM
+#define IMPULSEBLANKERTEST_W3HX7QDM
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include <cmath>
+#include <vector>
+
+#include "../src/FFTBackend.h"
+
+
+/**
+ * \brief Tests \ref ImpulseBlanker with the default block size (16),
+ *        hold (2 blocks) and average size (65536 samples).
+ */
+class ImpulseBlankerTest : public TestCase {
+public:
+	static const int BLOCK_SIZE = 16;
+	static const int HOLD       = 2;
+	
+	ImpulseBlankerTest()
+	{
+		TEST_ADD(ImpulseBlankerTest, testImpulse);
+		TEST_ADD(ImpulseBlankerTest, testLevelStep);
+		TEST_ADD(ImpulseBlankerTest, testInterpolation);
+	}
+	
+	/**
+	 * \brief Fills \c data with a tone of the amplitude \c amplitude
+	 *        (constant power), starting at the sample \c offset.
+	 */
+	static void tone(vector<Complex> &data, double amplitude, int offset)
+	{
+		for (int i = 0; i < (int)data.size(); i++) {
+			double phase = 0.01 * (double)(offset + i);
+			data[i].real = amplitude * cos(phase);
+			data[i].imag = amplitude * sin(phase);
+		}
+	}
+	
+	static double power(const Complex &c)
+	{
+		return c.real * c.real + c.imag * c.imag;
+	}
+	
+	void testImpulse()
+	{
+		ImpulseBlanker blanker;
+		blanker.setThreshold(10.0f);
+		
+		vector<Complex> data(4096);
+		tone(data, 1.0, 0);
+		blanker.process(&(data[0]), data.size());
+		TEST_EQUALS(0, (int)blanker.getImpulses(), "steady tone should not be blanked");
+		
+		// One block 100 times stronger.
+		const int impulse = 64 * BLOCK_SIZE;
+		tone(data, 1.0, 4096);
+		for (int i = impulse; i < impulse + BLOCK_SIZE; i++) {
+			data[i].real *= 10.0;
+			data[i].imag *= 10.0;
+		}
+		blanker.process(&(data[0]), data.size());
+		
+		TEST_EQUALS(1, (int)blanker.getImpulses(), "impulse should be counted");
+		TEST_EQUALS((HOLD + 1) * BLOCK_SIZE, (int)blanker.getBlankedSamples(),
+				  "impulse block and hold blocks should be blanked");
+		TEST_EQUALS(2 * 4096, (int)blanker.getTotalSamples(), "all samples should be counted");
+		
+		bool removed = true;
+		for (int i = impulse; i < impulse + BLOCK_SIZE; i++)
+			removed = removed && (power(data[i]) <= 1.0 + 1e-9);
+		TEST_ASSERT(removed, "impulse should be removed");
+	}
+	
+	void testLevelStep()
+	{
+		ImpulseBlanker blanker;
+		blanker.setThreshold(10.0f);
+		
+		vector<Complex> data(4096);
+		tone(data, 1.0, 0);
+		blanker.process(&(data[0]), data.size());
+		
+		// 100x step in power, fed in blocks until it isn't blanked.
+		int offset  = 4096;
+		int blanked = 0;
+		for (int i = 0; i < 8; i++) {
+			tone(data, 10.0, offset);
+			blanker.process(&(data[0]), data.size());
+			offset += data.size();
+			
+			if ((int)blanker.getBlankedSamples() == blanked)
+				break;
+			blanked = blanker.getBlankedSamples();
+		}
+		
+		// The average grows by 9 * 16 / 65536 per block while blanked.
+		TEST_ASSERT((blanked > 15000) && (blanked < 19000),
+				  "step should be accepted after about 17k samples");
+		TEST_EQUALS(1, (int)blanker.getImpulses(), "step should be one impulse");
+		
+		tone(data, 10.0, offset);
+		blanker.process(&(data[0]), data.size());
+		TEST_EQUALS(blanked, (int)blanker.getBlankedSamples(), "new level should not be blanked");
+		TEST_ASSERT(fabs(power(data[100]) - 100.0) < 1e-6, "new level should be passed through");
+	}
+	
+	void testInterpolation()
+	{
+		ImpulseBlanker blanker;
+		blanker.setThreshold(10.0f);
+		
+		// Slow ramp, so that the neighbours of the blanked section differ.
+		vector<Complex> data(4096);
+		for (int i = 0; i < (int)data.size(); i++) {
+			data[i].real = 1.0 + 1e-4 * (double)i;
+			data[i].imag = -1.0 + 2e-4 * (double)i;
+		}
+		
+		const int impulse = 128 * BLOCK_SIZE;
+		for (int i = impulse; i < impulse + BLOCK_SIZE; i++) {
+			data[i].real = 30.0;
+			data[i].imag = -30.0;
+		}
+		blanker.process(&(data[0]), data.size());
+		
+		int end = impulse + (HOLD + 1) * BLOCK_SIZE;
+		TEST_EQUALS(end - impulse, (int)blanker.getBlankedSamples(), "impulse should be blanked");
+		
+		const Complex &before = data[impulse - 1];
+		const Complex &after  = data[end];
+		bool between = true;
+		bool ordered = true;
+		for (int i = impulse; i < end; i++) {
+			between = between &&
+				(data[i].real > before.real) && (data[i].real < after.real) &&
+				(data[i].imag > before.imag) && (data[i].imag < after.imag);
+			if (i > impulse)
+				ordered = ordered && (data[i].real > data[i - 1].real) && (data[i].imag > data[i - 1].imag);
+		}
+		TEST_ASSERT(between, "interpolated samples should lie between their neighbours");
+		TEST_ASSERT(ordered, "interpolated samples should be monotonic");
+	}
+};
+
+RUN_SUITE(ImpulseBlankerTest);
+
+
+#endif /* end of include guard: IMPULSEBLANKERTEST_W3HX7QDM */
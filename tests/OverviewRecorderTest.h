@@ -0,0 +1,331 @@
+/**
+ * \file   OverviewRecorderTest.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the OverviewRecorderTest class.
+ */
+
+#ifndef OVERVIEWRECORDERTEST_K8RM2WQT
+#define OVERVIEWRECORDERTEST_K8RM2WQT
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "../src/OverviewRecorder.h"
+#include "ChunkFileTest.h"
+
+
+/**
+ * \brief Collects the decoded FFT rows of a \ref WaterfallBackend as they
+ *        are published.
+ */
+class RowRecorder : public Recorder {
+public:
+	vector<vector<float> > rows;
+	
+	RowRecorder(Ref<WaterfallBackend> backend) :
+		Recorder(backend)
+	{}
+	
+	virtual void update()
+	{
+		int head = buffer_->cursor().position;
+		int width = rowCodec_->getWidth();
+		
+		while ((int)rows.size() < head) {
+			int      count;
+			uint8_t *row = buffer_->span(buffer_->mark(Cursor(rows.size())), 1, &count);
+			
+			rows.push_back(vector<float>(width));
+			rowCodec_->decode(row, 0, width, &(rows.back()[0]));
+		}
+	}
+};
+
+
+/**
+ * \brief Records a decimated overview of noise and compares the chunked
+ *        waterfall file with the FFT rows.
+ *
+ * With 64 bins and no overlap at 48 kHz, the backend computes 750 FFT
+ * rows per second, so every one-second snapshot has 750 rows.
+ */
+class OverviewRecorderTest : public TestCase {
+public:
+	static const int SAMPLE_RATE   = 48000;
+	static const int BINS          = 64;
+	static const int SNAPSHOT_ROWS = 750;
+	
+	/**
+	 * \brief One chunk of the written file.
+	 */
+	struct Chunk {
+		int64_t                time;      ///< Microseconds since the epoch.
+		double                 binWidth;
+		vector<vector<float> > rows;
+	};
+	
+	/**
+	 * \brief The written file and the FFT rows it was computed from.
+	 */
+	struct Result {
+		int                    width;
+		double                 rowRate;
+		vector<Chunk>          chunks;
+		vector<vector<float> > fftRows;
+		
+		int getRowCount() const
+		{
+			int count = 0;
+			for (size_t c = 0; c < chunks.size(); c++)
+				count += chunks[c].rows.size();
+			return count;
+		}
+	};
+	
+	OverviewRecorderTest()
+	{
+		TEST_ADD(OverviewRecorderTest, testDecimation);
+		TEST_ADD(OverviewRecorderTest, testCarryOver);
+		TEST_ADD(OverviewRecorderTest, testHeader);
+	}
+	
+	static int64_t getMicroseconds(int fftRow)
+	{
+		return (int64_t)1700000000 * 1000000 + (int64_t)fftRow * BINS * 1000000 / SAMPLE_RATE;
+	}
+	
+	/**
+	 * \brief Records \c fftRows FFT rows of noise and reads the file back.
+	 */
+	static Result run(int fftRows, int timeDecimation, int freqDecimation,
+				   OverviewRecorder::DecimationMode mode)
+	{
+		Result result;
+		
+		char dir[] = "/tmp/overviewtestXXXXXX";
+		if (mkdtemp(dir) == NULL) return result;
+		
+		Ref<WaterfallBackend> backend = new WaterfallBackend(BINS, 0, "test");
+		backend->setRowFormat(ROW_FLOAT32);
+		
+		Ref<RowRecorder> rowRecorder = new RowRecorder(backend);
+		backend->addRecorder(rowRecorder.get());
+		backend->addRecorder(new OverviewRecorder(backend, 1, 86400, 0, 0, dir, "overview", CHUNK_RAW,
+										   timeDecimation, freqDecimation, mode));
+		
+		StreamInfo streamInfo;
+		streamInfo.sampleRate = SAMPLE_RATE;
+		streamInfo.timeOffset = WFTime(1700000000, 0);
+		backend->startStream(streamInfo);
+		
+		vector<Complex> data(BINS);
+		DataInfo        info;
+		info.timeOffset = streamInfo.timeOffset;
+		srand(5);
+		for (int row = 0; row < fftRows; row++) {
+			FOR_EACH(data, sample) {
+				sample->real = (double)rand() / (double)RAND_MAX - 0.5;
+				sample->imag = (double)rand() / (double)RAND_MAX - 0.5;
+			}
+			backend->process(data, info);
+			info.offset    += BINS;
+			info.timeOffset = streamInfo.timeOffset.addSamples(info.offset, SAMPLE_RATE);
+		}
+		backend->endStream();
+		
+		result.fftRows = rowRecorder->rows;
+		
+		vector<string> names;
+		DIR *d = opendir(dir);
+		struct dirent *entry;
+		while ((entry = readdir(d)) != NULL) {
+			if (entry->d_name[0] != '.')
+				names.push_back(Path::join(dir, entry->d_name));
+		}
+		closedir(d);
+		
+		vector<uint8_t> file;
+		if (names.size() == 1) {
+			FILE *f = fopen(names[0].c_str(), "rb");
+			int byte;
+			while ((byte = fgetc(f)) != EOF)
+				file.push_back((uint8_t)byte);
+			fclose(f);
+		}
+		FOR_EACH(names, name) {
+			unlink(name->c_str());
+		}
+		rmdir(dir);
+		
+		if (file.size() < 128) return result;
+		
+		// Chunks are raw, so the payloads are the float rows.
+		result.width   = ChunkFileTest::getLE<uint32_t>(file, 20);
+		result.rowRate = ChunkFileTest::getDouble(file, 24);
+		
+		uint64_t indexOffset = ChunkFileTest::getLE<uint64_t>(file, file.size() - 16);
+		size_t   offset      = 128;
+		while (offset < indexOffset) {
+			Chunk    chunk;
+			int      rows        = ChunkFileTest::getLE<uint32_t>(file, offset + 8);
+			uint64_t payloadSize = ChunkFileTest::getLE<uint64_t>(file, offset + 40);
+			chunk.time     = ChunkFileTest::getLE<int64_t>(file, offset + 16);
+			chunk.binWidth = ChunkFileTest::getDouble(file, offset + 32);
+			
+			for (int y = 0; y < rows; y++) {
+				chunk.rows.push_back(vector<float>(result.width));
+				memcpy(&(chunk.rows.back()[0]), &(file[offset + 56 + y * result.width * sizeof(float)]),
+					  result.width * sizeof(float));
+			}
+			result.chunks.push_back(chunk);
+			
+			offset += 56 + payloadSize;
+		}
+		
+		return result;
+	}
+	
+	/**
+	 * \brief Computes the \c index-th decimated row from the FFT rows.
+	 */
+	static vector<float> decimate(const Result &result, int index, int timeDecimation, int freqDecimation,
+							OverviewRecorder::DecimationMode mode)
+	{
+		int width = (BINS + freqDecimation - 1) / freqDecimation;
+		
+		vector<double> sums(width, 0.0);
+		vector<int>    counts(width, 0);
+		for (int row = index * timeDecimation; row < (index + 1) * timeDecimation; row++) {
+			for (int bin = 0; bin < BINS; bin++) {
+				double value = result.fftRows[row][bin];
+				int    i     = bin / freqDecimation;
+				if (mode == OverviewRecorder::DECIMATE_MAX)
+					sums[i] = max(sums[i], value);
+				else
+					sums[i] += value;
+				counts[i]++;
+			}
+		}
+		
+		vector<float> output(width);
+		for (int i = 0; i < width; i++)
+			output[i] = (mode == OverviewRecorder::DECIMATE_MAX) ? sums[i] : sums[i] / counts[i];
+		return output;
+	}
+	
+	/**
+	 * \returns number of decimated rows of \c result differing from the
+	 *          rows computed from the FFT rows
+	 */
+	static int countWrongRows(const Result &result, int timeDecimation, int freqDecimation,
+						 OverviewRecorder::DecimationMode mode)
+	{
+		int wrong = 0;
+		int index = 0;
+		FOR_EACH(result.chunks, chunk) {
+			FOR_EACH(chunk->rows, row) {
+				if ((index + 1) * timeDecimation > (int)result.fftRows.size()) {
+					wrong++;
+					continue;
+				}
+				
+				vector<float> expected = decimate(result, index, timeDecimation, freqDecimation, mode);
+				for (int i = 0; i < (int)expected.size(); i++) {
+					if (fabs((*row)[i] - expected[i]) > 1e-5 * expected[i]) {
+						wrong++;
+						break;
+					}
+				}
+				index++;
+			}
+		}
+		return wrong;
+	}
+	
+	void testDecimation()
+	{
+		// 64 bins merged by 5, so the last bin merges 4 bins.
+		const int timeDecimation = 4;
+		const int freqDecimation = 5;
+		const int fftRows        = 2 * SNAPSHOT_ROWS;
+		
+		OverviewRecorder::DecimationMode modes[2] = {
+			OverviewRecorder::DECIMATE_MEAN,
+			OverviewRecorder::DECIMATE_MAX
+		};
+		
+		for (int m = 0; m < 2; m++) {
+			Result result = run(fftRows, timeDecimation, freqDecimation, modes[m]);
+			
+			TEST_EQUALS(13, result.width, "13 decimated bins");
+			TEST_EQUALS(fftRows, (int)result.fftRows.size(), "all FFT rows should be published");
+			TEST_EQUALS(fftRows / timeDecimation, result.getRowCount(), "all decimated rows should be written");
+			TEST_EQUALS(0, countWrongRows(result, timeDecimation, freqDecimation, modes[m]),
+					  "decimated rows should match the FFT rows");
+		}
+	}
+	
+	void testCarryOver()
+	{
+		// 750 = 11 * 64 + 46, the 46 rows left after the first snapshot
+		// start the first row of the second one.
+		const int timeDecimation = 64;
+		const int fftRows        = 3 * SNAPSHOT_ROWS;
+		
+		Result result = run(fftRows, timeDecimation, 1, OverviewRecorder::DECIMATE_MEAN);
+		
+		TEST_EQUALS(3, (int)result.chunks.size(), "one chunk per snapshot");
+		if (result.chunks.size() != 3) return;
+		
+		TEST_EQUALS(11, (int)result.chunks[0].rows.size(), "first chunk rows");
+		TEST_EQUALS(12, (int)result.chunks[1].rows.size(), "second chunk rows with the carried rows");
+		TEST_EQUALS(fftRows / timeDecimation, result.getRowCount(), "all decimated rows should be written");
+		TEST_EQUALS(0, countWrongRows(result, timeDecimation, 1, OverviewRecorder::DECIMATE_MEAN),
+				  "decimated rows should match the FFT rows");
+		
+		int first = 0;
+		for (int c = 0; c < 3; c++) {
+			int64_t expected = getMicroseconds(first * timeDecimation);
+			TEST_ASSERT(llabs(result.chunks[c].time - expected) <= 1,
+					  "chunk time should be the time of its first FFT row");
+			first += result.chunks[c].rows.size();
+		}
+	}
+	
+	void testHeader()
+	{
+		// 750 / 64 Hz
+		Result result = run(2 * SNAPSHOT_ROWS, 64, 5, OverviewRecorder::DECIMATE_MEAN);
+		TEST_EQUALS(11.71875, result.rowRate, "fractional row rate");
+		TEST_ASSERT(!result.chunks.empty(), "chunks should be written");
+		if (!result.chunks.empty())
+			TEST_EQUALS(5.0 * SAMPLE_RATE / BINS, result.chunks[0].binWidth, "bin width");
+		
+		// Below 1 Hz, the decimated rows span the snapshots.
+		const int timeDecimation = 1000;
+		result = run(3 * SNAPSHOT_ROWS, timeDecimation, 1, OverviewRecorder::DECIMATE_MEAN);
+		TEST_EQUALS(0.75, result.rowRate, "row rate below 1 Hz");
+		TEST_EQUALS(2, result.getRowCount(), "decimated rows should be written");
+		TEST_EQUALS(0, countWrongRows(result, timeDecimation, 1, OverviewRecorder::DECIMATE_MEAN),
+				  "decimated rows should match the FFT rows");
+		if (!result.chunks.empty())
+			TEST_ASSERT(llabs(result.chunks[0].time - getMicroseconds(0)) <= 1,
+					  "chunk time should be the time of its first FFT row");
+	}
+};
+
+RUN_SUITE(OverviewRecorderTest);
+
+
+#endif /* end of include guard: OVERVIEWRECORDERTEST_K8RM2WQT */
@@ -0,0 +1,102 @@
+/**
+ * \file   QuicklookTest.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the QuicklookTest class.
+ */
+
+#ifndef QUICKLOOKTEST_W2NR6TJC
+#define QUICKLOOKTEST_W2NR6TJC
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include <vector>
+
+#include "../src/Quicklook.h"
+
+
+/**
+ * \brief Checks downsampling and scaling of quicklook images.
+ */
+class QuicklookTest : public TestCase {
+public:
+	QuicklookTest()
+	{
+		TEST_ADD(QuicklookTest, testSize);
+		TEST_ADD(QuicklookTest, testScaling);
+		TEST_ADD(QuicklookTest, testUnalignedRows);
+	}
+	
+	void testSize()
+	{
+		Quicklook quicklook(100, 50, 5.0f, 95.0f, COLORMAP_GRAY);
+		
+		quicklook.begin(1000, 120);
+		TEST_EQUALS(100, quicklook.getWidth(), "10 bins should be merged to a pixel");
+		TEST_EQUALS(40, quicklook.getHeight(), "3 rows should be merged to a pixel");
+		
+		quicklook.begin(80, 30);
+		TEST_EQUALS(80, quicklook.getWidth(), "small images should not be scaled up");
+		TEST_EQUALS(30, quicklook.getHeight(), "small images should not be scaled up");
+	}
+	
+	void testScaling()
+	{
+		// Left half of the image is 10x weaker than the right half, the
+		// percentiles stretch them to the ends of the colormap.
+		int width = 64;
+		int height = 20;
+		Quicklook quicklook(16, 10, 5.0f, 95.0f, COLORMAP_GRAY);
+		quicklook.begin(width, height);
+		
+		std::vector<float> row(width);
+		for (int x = 0; x < width; x++)
+			row[x] = (x < width / 2) ? 1.0f : 10.0f;
+		for (int y = 0; y < height; y++)
+			quicklook.addRow(&(row[0]));
+		quicklook.render();
+		
+		const uint8_t *pixels = quicklook.getPixels();
+		int last = (quicklook.getWidth() - 1) * 3;
+		TEST_EQUALS(0, (int)pixels[0], "weak pixels should be black");
+		TEST_EQUALS(255, (int)pixels[last], "strong pixels should be white");
+		TEST_EQUALS(255, (int)pixels[(quicklook.getHeight() - 1) * quicklook.getWidth() * 3 + last],
+				  "all rows should be rendered");
+	}
+	
+	void testUnalignedRows()
+	{
+		// Rows not aligned to the vector size and with a width that is
+		// not a multiple of it, bins 3 and 36 (the scalar tail) are strong.
+		int width  = 37;
+		int height = 4;
+		Quicklook quicklook(64, 2, 0.0f, 100.0f, COLORMAP_GRAY);
+		quicklook.begin(width, height);
+		
+		std::vector<float> buffer(width + 1, 1.0f);
+		float *row = &(buffer[1]);
+		row[3]  = 10.0f;
+		row[36] = 10.0f;
+		for (int y = 0; y < height; y++)
+			quicklook.addRow(row);
+		quicklook.render();
+		
+		TEST_EQUALS(width, quicklook.getWidth(), "bins should not be downsampled");
+		TEST_EQUALS(2, quicklook.getHeight(), "rows should be downsampled");
+		
+		const uint8_t *pixels = quicklook.getPixels();
+		for (int y = 0; y < quicklook.getHeight(); y++) {
+			for (int x = 0; x < width; x++) {
+				int expected = ((x == 3) || (x == 36)) ? 255 : 0;
+				TEST_EQUALS(expected, (int)pixels[(y * width + x) * 3], "wrong pixel");
+			}
+		}
+	}
+};
+
+RUN_SUITE(QuicklookTest);
+
+
+#endif /* end of include guard: QUICKLOOKTEST_W2NR6TJC */
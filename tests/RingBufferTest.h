@@ -29,6 +29,9 @@ public:
 		TEST_ADD(RingBufferTest, testCopyConstructor);
 		TEST_ADD(RingBufferTest, testCopyConstructorOverlap);
 		TEST_ADD(RingBufferTest, testPush);
+		TEST_ADD(RingBufferTest, testBulkPush);
+		TEST_ADD(RingBufferTest, testPeekPop);
+		TEST_ADD(RingBufferTest, testResize);
 	}
 	
 	void testConstructor()
@@ -101,7 +104,7 @@ public:
 		//			  "the elements poped from the copy should be equal "
 		//			  "to the original");
 		//}
-
+	
 	}
 	
 	void testPush()
@@ -142,6 +145,79 @@ public:
 			//}
 		}
 	}
+	
+	void testBulkPush()
+	{
+		int cap = 10;
+		RingBuffer<int> buffer(cap);
+		
+		int items[25];
+		for (int i = 0; i < 25; i++) items[i] = i;
+		
+		// Pushes of various lengths, wrapping around the end.
+		int pushed = 0;
+		for (int count = 1; count <= 7; count++) {
+			buffer.push(items + (pushed % 18), count);
+			for (int i = 1; (i <= count) && (i <= cap); i++) {
+				TEST_EQUALS(items[(pushed % 18) + count - i], buffer.at(buffer.head() - i),
+						  "bulk pushed items should be at the head");
+			}
+			pushed += count;
+		}
+		TEST_ASSERT(buffer.isFull(), "buffer should be full");
+		
+		// Pushing more than the capacity keeps the last items.
+		buffer.push(items, 25);
+		TEST_EQUALS(cap, buffer.getSize(), "buffer should stay full");
+		for (int i = 1; i <= cap; i++)
+			TEST_EQUALS(25 - i, buffer.at(buffer.head() - i), "last items should be kept");
+	}
+	
+	void testPeekPop()
+	{
+		int cap = 8;
+		RingBuffer<int> buffer(cap);
+		int out[16];
+		
+		TEST_EQUALS(0, buffer.peek(out, 4), "empty buffer should have nothing to peek");
+		
+		for (int i = 0; i < 13; i++)
+			buffer.push(i);
+		
+		// Oldest items are 5 -- 12 and they wrap around the end.
+		TEST_EQUALS(cap, buffer.peek(out, 16), "peek should copy at most the size");
+		for (int i = 0; i < cap; i++)
+			TEST_EQUALS(5 + i, out[i], "peek should copy oldest items first");
+		TEST_EQUALS(cap, buffer.getSize(), "peek should not remove items");
+		
+		TEST_EQUALS(3, buffer.pop(out, 3), "pop should copy the requested items");
+		TEST_EQUALS(7, out[2], "pop should remove oldest items first");
+		TEST_EQUALS(cap - 3, buffer.getSize(), "pop should remove items");
+		
+		int more[4] = { 13, 14, 15, 16 };
+		buffer.push(more, 4);
+		TEST_EQUALS(cap, buffer.pop(out, 16), "pop should remove all items");
+		for (int i = 0; i < cap; i++)
+			TEST_EQUALS(9 + i, out[i], "popped items should be in push order");
+		TEST_ASSERT(buffer.isEmpty(), "buffer should be empty after popping everything");
+	}
+	
+	void testResize()
+	{
+		RingBuffer<int> buffer(6);
+		for (int i = 0; i < 9; i++)
+			buffer.push(i);
+		
+		buffer.resize(10);
+		TEST_EQUALS(10, buffer.getCapacity(), "buffer should grow");
+		TEST_EQUALS(6, buffer.getSize(), "resize should keep the items");
+		
+		buffer.push(9);
+		int out[10];
+		TEST_EQUALS(7, buffer.peek(out, 10), "push after resize should add an item");
+		for (int i = 0; i < 7; i++)
+			TEST_EQUALS(3 + i, out[i], "resize should keep the item order");
+	}
 };
 
 RUN_SUITE(RingBufferTest);
@@ -156,6 +232,16 @@ public:
 		TEST_ADD(RingBuffer2DTest, testPush);
 		TEST_ADD(RingBuffer2DTest, testMark);
 		TEST_ADD(RingBuffer2DTest, testReservations);
+		TEST_ADD(RingBuffer2DTest, testReservationOverwrite);
+		TEST_ADD(RingBuffer2DTest, testPowerOfTwo);
+		TEST_ADD(RingBuffer2DTest, testIterators);
+		TEST_ADD(RingBuffer2DTest, testSpans);
+		TEST_ADD(RingBuffer2DTest, testBulkPush);
+		TEST_ADD(RingBuffer2DTest, testAllocationPolicy);
+		TEST_ADD(RingBuffer2DTest, testHugePageChunks);
+		TEST_ADD(RingBuffer2DTest, testBackingFile);
+		TEST_ADD(RingBuffer2DTest, testChunkAging);
+		TEST_ADD(RingBuffer2DTest, testCursors);
 	}
 	
 	template<class T>
@@ -225,7 +311,7 @@ public:
 		testPush(16, sizeof(int) * 16 * 8, 16 * 8 * 8);
 		testPush(16, sizeof(int) * 16 * 8 - 1, 16 * 8 * 8);
 	}
-
+	
 	void testMark(int width, int chunkSize, int capacity)
 	{
 		RingBuffer2D<int> buffer(width, chunkSize, capacity);
@@ -274,10 +360,339 @@ public:
 	{
 		testReservations(16, sizeof(int) * 16 * 8, 16 * 8 * 8);
 		testReservations(16, sizeof(int) * 16 * 8 - 1, 16 * 8 * 8);
-
+		
 		testReservations(16, sizeof(int) * 16 * 8, 16 * 8 * 31);
 		testReservations(16, sizeof(int) * 16 * 8 - 1, 16 * 8 * 31);
 	}
+	
+	void testReservationOverwrite()
+	{
+		RingBuffer2D<int> buffer(16, sizeof(int) * 16 * 8, 16 * 8 * 8);
+		int capacity = buffer.getCapacity();
+		
+		for (int i = 0; i < 20; i++)
+			fillRow(&buffer, i);
+		
+		// Rows 5 -- 10 were already written, they are overwritten
+		// only after the head wraps around to row 5.
+		int behind = buffer.reserve(5, 10);
+		// The head row is overwritten by the next push.
+		int atHead = buffer.reserve(buffer.mark(), buffer.mark() + 3);
+		
+		TEST_ASSERT(!buffer.isDirty(behind), "reservation should not be dirty");
+		TEST_ASSERT(!buffer.isDirty(atHead), "reservation should not be dirty");
+		
+		fillRow(&buffer, 0);
+		TEST_ASSERT(buffer.isDirty(atHead), "written reservation should be dirty");
+		
+		for (int i = 0; i < capacity - 16; i++)
+			fillRow(&buffer, i);
+		TEST_ASSERT(!buffer.isDirty(behind), "head should be just before the reservation");
+		
+		fillRow(&buffer, 0);
+		TEST_ASSERT(buffer.isDirty(behind), "written reservation should be dirty");
+		
+		// Freed handles are reused with a fresh state.
+		buffer.freeReservation(behind);
+		int reused = buffer.reserve(buffer.mark() + 1, buffer.mark() + 2);
+		TEST_EQUALS(behind, reused, "freed handle should be reused");
+		TEST_ASSERT(!buffer.isDirty(reused), "new reservation should not be dirty");
+	}
+	
+	void testPowerOfTwo()
+	{
+		RingBuffer2D<int> buffer;
+		buffer.setPowerOfTwo(true);
+		buffer.resize(16, sizeof(int) * 16 * 6, 16 * 6 * 5);
+		
+		TEST_EQUALS(4, buffer.getChunkRows(), "chunk rows should be rounded down");
+		TEST_EQUALS(4 * 128, buffer.getCapacity(), "chunk count should be rounded up");
+		
+		int capacity = buffer.getCapacity();
+		for (int i = 0; i < capacity + 7; i++)
+			fillRow(&buffer, i);
+		
+		for (int i = 1; i <= capacity; i++) {
+			int mark = buffer.mark() - i;
+			TEST_EQUALS(capacity + 7 - i, buffer.at(mark)[0], "wrong row");
+			TEST_EQUALS(buffer.at(mark), buffer.at(mark + capacity), "marks should wrap around");
+		}
+	}
+	
+	void testIterators(bool powerOfTwo)
+	{
+		RingBuffer2D<int> buffer;
+		buffer.setPowerOfTwo(powerOfTwo);
+		buffer.resize(16, sizeof(int) * 16 * 8 - 1, 16 * 8 * 8);
+		
+		int capacity = buffer.getCapacity();
+		for (int i = 0; i < capacity + 13; i++)
+			fillRow(&buffer, i);
+		
+		int start = buffer.mark() - capacity;
+		RingBuffer2D<int>::row_iterator it = buffer.rowIterator(start);
+		for (int i = 0; i < capacity; i++, ++it) {
+			TEST_EQUALS(buffer.at(start + i), *it, "iterator points to a wrong row");
+			TEST_EQUALS(13 + i, (*it)[0], "iterator points to a wrong row");
+		}
+		TEST_ASSERT(it == buffer.rowIterator(start + capacity), "iterator should reach the end");
+		
+		RingBuffer2D<int>::reverse_row_iterator rit = buffer.reverseRowIterator(buffer.mark() - 1);
+		for (int i = 0; i < capacity; i++, ++rit) {
+			TEST_EQUALS(capacity + 12 - i, (*rit)[0], "reverse iterator points to a wrong row");
+		}
+	}
+	
+	void testIterators()
+	{
+		testIterators(false);
+		testIterators(true);
+	}
+	
+	void testSpans(bool powerOfTwo)
+	{
+		RingBuffer2D<int> buffer;
+		buffer.setPowerOfTwo(powerOfTwo);
+		buffer.resize(3, sizeof(int) * 3 * 8, 8 * 5);
+		
+		int capacity = buffer.getCapacity();
+		for (int i = 0; i < capacity + 5; i++)
+			fillRow(&buffer, i);
+		
+		int mark  = buffer.mark() - capacity;
+		int count = capacity;
+		int value = 5;
+		while (count > 0) {
+			int rows;
+			int *data = buffer.span(mark, count, &rows);
+			
+			TEST_ASSERT((rows > 0) && (rows <= buffer.getChunkRows()), "wrong span length");
+			for (int i = 0; i < rows * buffer.getWidth(); i++) {
+				TEST_EQUALS(value + i / buffer.getWidth(), data[i], "span contains wrong data");
+			}
+			
+			mark  += rows;
+			count -= rows;
+			value += rows;
+		}
+		TEST_EQUALS(capacity + 5, value, "spans should cover all rows");
+	}
+	
+	void testSpans()
+	{
+		testSpans(false);
+		testSpans(true);
+	}
+	
+	void testBulkPush()
+	{
+		RingBuffer2D<int> buffer;
+		buffer.resize(2, sizeof(int) * 2 * 7, 7 * 3);
+		int capacity = buffer.getCapacity();
+		
+		// Runs end at chunk boundaries and wrap around the capacity.
+		int value = 0;
+		while (value < capacity + 10) {
+			int rows;
+			int *data = buffer.push(5, &rows);
+			TEST_ASSERT((rows > 0) && (rows <= 5), "wrong run length");
+			for (int i = 0; i < rows * 2; i++)
+				data[i] = value + i / 2;
+			value += rows;
+		}
+		
+		TEST_EQUALS(capacity, buffer.getSize(), "bulk push should fill the buffer");
+		TEST_EQUALS(value % capacity, buffer.mark(), "wrong head after bulk push");
+		
+		buffer.publish();
+		RingBuffer2D<int>::Cursor oldest = buffer.cursor(capacity);
+		TEST_EQUALS(value - capacity, (int)oldest.position, "bulk push should claim all rows");
+		for (int i = 0; i < capacity; i++) {
+			TEST_EQUALS(value - capacity + i, buffer.at(buffer.mark(oldest + i))[1],
+					  "bulk pushed row contains wrong data");
+		}
+	}
+	
+	void testAllocationPolicy(const AllocationPolicy &policy)
+	{
+		RingBuffer2D<int> buffer;
+		buffer.setAllocationPolicy(policy);
+		buffer.resize(16, sizeof(int) * 16 * 8, 16 * 8 * 8);
+		
+		TEST_ASSERT(buffer.getMemorySize() >= sizeof(int) * 16 * buffer.getCapacity(),
+				  "buffer should allocate memory for all rows");
+		
+		for (int i = 0; i < buffer.getCapacity(); i++) {
+			int *row = fillRow(&buffer, i);
+			if ((i % buffer.getChunkRows()) == 0) {
+				TEST_EQUALS(0, (int)((size_t)row % 64), "chunks should be aligned to 64 bytes");
+			}
+		}
+		TEST_EQUALS(7, buffer.at(7)[15], "wrong row");
+	}
+	
+	void testAllocationPolicy()
+	{
+		AllocationPolicy policy;
+		testAllocationPolicy(policy);
+		
+		policy.populate = true;
+		testAllocationPolicy(policy);
+		
+		policy.hugePages = AllocationPolicy::HUGE_PAGES_TRANSPARENT;
+		testAllocationPolicy(policy);
+	}
+	
+	void testHugePageChunks()
+	{
+		// Rows of 4000 B don't divide a huge page, a chunk of 1 MiB is
+		// rounded up to a whole huge page and filled with rows.
+		AllocationPolicy policy;
+		policy.hugePages = AllocationPolicy::HUGE_PAGES_TRANSPARENT;
+		
+		RingBuffer2D<int> buffer;
+		buffer.setAllocationPolicy(policy);
+		buffer.resize(1000, 1024 * 1024, 2000);
+		
+		TEST_EQUALS(HUGE_PAGE_SIZE / 4000, buffer.getChunkRows(), "chunks should fill a huge page");
+		TEST_EQUALS((size_t)4 * HUGE_PAGE_SIZE, buffer.getMemorySize(),
+				  "chunks should not be padded beyond a huge page");
+		
+		// A parallel buffer keeps the rows per chunk.
+		RingBuffer2D<uint8_t> mask;
+		mask.setAllocationPolicy(policy);
+		mask.resizeRows(1000, buffer.getChunkRows(), 2000);
+		TEST_EQUALS(buffer.getChunkRows(), mask.getChunkRows(), "parallel buffer should keep the chunk rows");
+		TEST_EQUALS(buffer.getCapacity(), mask.getCapacity(), "parallel buffer should have the same capacity");
+		
+		for (int i = 0; i < buffer.getCapacity() + 3; i++)
+			fillRow(&buffer, i);
+		TEST_EQUALS(buffer.getCapacity() + 2, buffer.at(buffer.mark() - 1)[999], "wrong row");
+	}
+	
+	void testBackingFile()
+	{
+		RingBuffer2D<int> buffer;
+		buffer.setBackingFile("/tmp", 2);
+		buffer.resize(16, sizeof(int) * 16 * 8 - 1, 16 * 8 * 8);
+		
+		TEST_ASSERT(buffer.isFileBacked(), "buffer should be file-backed");
+		
+		int capacity = buffer.getCapacity();
+		int handle   = -1;
+		for (int i = 0; i < capacity * 2 + 3; i++) {
+			fillRow(&buffer, i);
+			if (i == capacity)
+				handle = buffer.reserve(0, 8);
+		}
+		
+		TEST_ASSERT(buffer.isDirty(handle), "overwritten reservation should be dirty");
+		for (int i = 1; i <= capacity; i++) {
+			TEST_EQUALS(capacity * 2 + 3 - i, buffer.at(buffer.mark() - i)[0],
+					  "wrong row in file-backed buffer");
+		}
+	}
+	
+	/**
+	 * \brief Returns the number of pages of the chunk \c chunk in RAM.
+	 */
+	static int residentPages(RingBuffer2D<int> *buffer, int chunk)
+	{
+		size_t page  = sysconf(_SC_PAGESIZE);
+		size_t size  = sizeof(int) * buffer->getWidth() * buffer->getChunkRows();
+		int    count = (size + page - 1) / page;
+		
+		std::vector<unsigned char> pages(count);
+		if (mincore(buffer->at(chunk * buffer->getChunkRows()), size, &(pages[0])) != 0)
+			return -1;
+		
+		int resident = 0;
+		for (int i = 0; i < count; i++)
+			resident += pages[i] & 1;
+		return resident;
+	}
+	
+	void testChunkAging()
+	{
+		// Rows of one page, chunks of eight pages. /var/tmp is used,
+		// because pages of tmpfs can't be released.
+		int width = sysconf(_SC_PAGESIZE) / sizeof(int);
+		
+		RingBuffer2D<int> buffer;
+		buffer.setBackingFile("/var/tmp", 2);
+		buffer.resize(width, sizeof(int) * width * 8, 8 * 8);
+		TEST_EQUALS(8, buffer.getChunkRows(), "wrong chunk size");
+		
+		// The head enters chunk 6, pushing doesn't release anything.
+		for (int i = 0; i < 6 * 8 + 1; i++)
+			fillRow(&buffer, i);
+		TEST_EQUALS(8, residentPages(&buffer, 0), "pushing should not release chunks");
+		
+		// Chunks more than two chunks behind the head are released.
+		buffer.ageChunks();
+		for (int chunk = 0; chunk < 5; chunk++)
+			TEST_EQUALS(0, residentPages(&buffer, chunk), "old chunk should be released");
+		TEST_EQUALS(8, residentPages(&buffer, 5), "recent chunk should stay resident");
+		TEST_ASSERT(residentPages(&buffer, 6) > 0, "head chunk should stay resident");
+		
+		// Released rows are read back from the file.
+		for (int i = 0; i < 6 * 8 + 1; i++)
+			TEST_EQUALS(i, buffer.at(i)[width - 1], "released row should keep its data");
+	}
+	
+	void testCursors(bool powerOfTwo)
+	{
+		RingBuffer2D<int> buffer;
+		buffer.setPowerOfTwo(powerOfTwo);
+		buffer.resize(4, sizeof(int) * 4 * 6, 6 * 5);
+		int capacity = buffer.getCapacity();
+		
+		RingBuffer2D<int>::Cursor cursor = buffer.cursor();
+		
+		// Pushed rows are not visible until published.
+		fillRow(&buffer, 0);
+		fillRow(&buffer, 1);
+		TEST_EQUALS(0, buffer.available(cursor), "unpublished rows should not be available");
+		buffer.publish();
+		TEST_EQUALS(2, buffer.available(cursor), "published rows should be available");
+		TEST_EQUALS(1, buffer.at(buffer.mark(cursor + 1))[0], "cursor should point to the pushed row");
+		
+		// Cursors don't point before the first row.
+		TEST_ASSERT(buffer.cursor(5) == cursor, "cursor should not point before the first row");
+		
+		for (int i = 2; i < capacity + 10; i++) {
+			fillRow(&buffer, i);
+			buffer.publish();
+		}
+		
+		// The buffer holds the last capacity rows.
+		RingBuffer2D<int>::Cursor oldest = buffer.cursor(capacity);
+		TEST_EQUALS(10, buffer.at(buffer.mark(oldest))[0], "wrong oldest row");
+		TEST_ASSERT(!buffer.isOverrun(oldest), "oldest row should be intact");
+		TEST_ASSERT(buffer.isOverrun(cursor), "first row should be overrun");
+		TEST_EQUALS(capacity + 10, buffer.available(cursor), "available should count all rows since the cursor");
+		
+		// Claiming the next row overruns the oldest one before it is
+		// published.
+		fillRow(&buffer, 0);
+		TEST_ASSERT(buffer.isOverrun(oldest), "claimed row should overrun the oldest row");
+		TEST_ASSERT(!buffer.isOverrun(oldest + 1), "next row should be intact");
+		buffer.publish();
+		
+		// The most recent row with a mark.
+		RingBuffer2D<int>::Cursor recent = buffer.cursorAt(buffer.mark(oldest + 3));
+		TEST_ASSERT(recent == oldest + 3, "cursorAt should find the most recent row");
+		
+		// Clearing resets the positions.
+		buffer.clear();
+		TEST_EQUALS(0, buffer.available(RingBuffer2D<int>::Cursor()), "cleared buffer should be empty");
+	}
+	
+	void testCursors()
+	{
+		testCursors(false);
+		testCursors(true);
+	}
 };
 
 RUN_SUITE(RingBuffer2DTest);
@@ -0,0 +1,101 @@
+/**
+ * \file   RowCodecTest.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the RowCodecTest class.
+ */
+
+#ifndef ROWCODECTEST_K4WN7RZE
+#define ROWCODECTEST_K4WN7RZE
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include <vector>
+
+#include "../src/RowCodec.h"
+
+
+/**
+ * \brief Checks round trips of the FFT row storage formats.
+ */
+class RowCodecTest : public TestCase {
+public:
+	RowCodecTest()
+	{
+		TEST_ADD(RowCodecTest, testHalf);
+		TEST_ADD(RowCodecTest, testRowSize);
+		TEST_ADD(RowCodecTest, testLogFormats);
+	}
+
+	void testHalf()
+	{
+		TEST_EQUALS(0x3c00, floatToHalf(1.0f), "1.0 should be exact in half precision");
+		TEST_EQUALS(0xc000, floatToHalf(-2.0f), "-2.0 should be exact in half precision");
+		TEST_EQUALS(0x7c00, floatToHalf(1e6f), "too large values should become infinity");
+		TEST_EQUALS(1.0f, halfToFloat(0x3c00), "half 1.0 should decode exactly");
+
+		for (float v = 1e-4f; v < 6e4f; v *= 1.37f) {
+			float r = halfToFloat(floatToHalf(v));
+			TEST_ASSERT(fabs(r - v) <= v * (1.0f / 2048.0f),
+					  "half round trip should be within half an ulp");
+		}
+	}
+
+	void testRowSize()
+	{
+		TEST_EQUALS(4 * 100, RowCodec(ROW_FLOAT32, 100).getRowSize(), "float32 row size");
+		TEST_EQUALS(2 * 100, RowCodec(ROW_FLOAT16, 100).getRowSize(), "float16 row size");
+		TEST_EQUALS((int)sizeof(RowScale) + 2 * 100, RowCodec(ROW_LOG16, 100).getRowSize(),
+				  "log16 row size");
+		TEST_EQUALS((int)sizeof(RowScale) + 100, RowCodec(ROW_LOG8, 100).getRowSize(),
+				  "log8 row size");
+	}
+
+	void testLogFormat(RowFormat format, float tolerance)
+	{
+		int width = 1000;
+		RowCodec codec(format, width);
+
+		vector<float> values(width);
+		for (int i = 0; i < width; i++)
+			values[i] = powf(10.0f, -6.0f + 9.0f * (float)i / (float)width);
+
+		vector<uint8_t> row(codec.getRowSize());
+		codec.encode(&(values[0]), &(row[0]));
+
+		vector<float> decoded(width, -1.0f);
+		codec.decode(&(row[0]), 10, width, &(decoded[0]));
+
+		TEST_EQUALS(-1.0f, decoded[9], "bins outside the range should not be written");
+
+		float maxError = 0.0f;
+		for (int i = 10; i < width; i++) {
+			float error = fabs(decoded[i] / values[i] - 1.0f);
+			if (error > maxError) maxError = error;
+		}
+		TEST_ASSERT(maxError < tolerance,
+				  "log format relative error should be below the quantization step");
+	}
+
+	void testLogFormats()
+	{
+		// 9 decades over 65535 and 255 steps
+		testLogFormat(ROW_LOG16, 2e-4f);
+		testLogFormat(ROW_LOG8,  5e-2f);
+
+		RowCodec codec(ROW_LOG8, 4);
+		float zeros[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		vector<uint8_t> row(codec.getRowSize());
+		codec.encode(zeros, &(row[0]));
+		float decoded[4];
+		codec.decode(&(row[0]), 0, 4, decoded);
+		TEST_ASSERT(decoded[0] < 1e-20f, "empty row should decode to (almost) zero");
+	}
+};
+
+RUN_SUITE(RowCodecTest);
+
+
+#endif /* end of include guard: ROWCODECTEST_K4WN7RZE */
@@ -0,0 +1,228 @@
+/**
+ * \file   SnapshotWriterPoolTest.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the SnapshotWriterPoolTest class.
+ */
+
+#ifndef SNAPSHOTWRITERPOOLTEST_Q3NV7HXB
+#define SNAPSHOTWRITERPOOLTEST_Q3NV7HXB
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+#include "../src/WaterfallBackend.h"
+
+
+/**
+ * \brief Order of the snapshots written by \ref PoolRecorder instances.
+ */
+struct WriteLog {
+	Mutex                       mutex;
+	Condition                   condition;
+	vector<pair<int, int> >     writes; ///< Recorder and snapshot ids in the order of writing.
+	bool                        open;   ///< Writes wait until set.
+	
+	WriteLog() : open(true) {}
+	
+	void setOpen()
+	{
+		MutexLock lock(&mutex);
+		open = true;
+		condition.broadcast();
+	}
+	
+	int getCount()
+	{
+		MutexLock lock(&mutex);
+		return writes.size();
+	}
+	
+	/**
+	 * \returns \c false if less than \c count snapshots were written
+	 *          within a second
+	 */
+	bool waitFor(int count)
+	{
+		for (int i = 0; (i < 1000) && (getCount() < count); i++)
+			usleep(1000);
+		return getCount() >= count;
+	}
+};
+
+
+/**
+ * \brief \ref SnapshotRecorder logging the snapshots written by
+ *        \ref SnapshotWriterPool instead of writing them.
+ *
+ * The snapshots are identified by their length, their rows are never read.
+ */
+class PoolRecorder : public SnapshotRecorder {
+private:
+	WriteLog     *log_;
+	int           id_;
+	int           delay_;  ///< Microseconds spent in every write.
+	volatile int  active_; ///< Number of writes running, updated atomically.
+
+public:
+	bool overlapped; ///< Set if two snapshots were written at once.
+	
+	PoolRecorder(Ref<WaterfallBackend> backend, WriteLog *log, int id, int delay) :
+		SnapshotRecorder(backend, 1, 0, 0, "/tmp", "pool", false, false),
+		log_(log), id_(id), delay_(delay), active_(0),
+		overlapped(false)
+	{
+		writeUnfinished_ = false;
+	}
+	
+	bool submit(int snapshotId, int priority)
+	{
+		Snapshot snapshot(buffer_->cursor());
+		snapshot.length = snapshotId;
+		snapshot.queued = LatencyHistogram::now();
+		return SnapshotWriterPool::getInstance().submit(this, snapshot, priority);
+	}
+
+protected:
+	virtual void write(Snapshot snapshot)
+	{
+		if (__sync_add_and_fetch(&active_, 1) > 1)
+			overlapped = true;
+		
+		{
+			MutexLock lock(&log_->mutex);
+			log_->writes.push_back(make_pair(id_, snapshot.length));
+			while (!log_->open)
+				log_->condition.wait(log_->mutex);
+		}
+		
+		if (delay_ > 0)
+			usleep(delay_);
+		__sync_sub_and_fetch(&active_, 1);
+	}
+};
+
+
+/**
+ * \brief Tests the priorities, the bounded queue and the per-recorder
+ *        ordering of \ref SnapshotWriterPool.
+ */
+class SnapshotWriterPoolTest : public TestCase {
+public:
+	static const int BINS = 64;
+	
+	SnapshotWriterPoolTest()
+	{
+		TEST_ADD(SnapshotWriterPoolTest, testPriority);
+		TEST_ADD(SnapshotWriterPoolTest, testRecorderOrder);
+	}
+	
+	static void startStream(Ref<WaterfallBackend> backend)
+	{
+		StreamInfo streamInfo;
+		streamInfo.sampleRate = 48000;
+		streamInfo.timeOffset = WFTime(1700000000, 0);
+		backend->startStream(streamInfo);
+	}
+	
+	void testPriority()
+	{
+		const int routine = SnapshotWriterPool::PRIORITY_ROUTINE;
+		const int event   = SnapshotWriterPool::PRIORITY_EVENT;
+		
+		SnapshotWriterPool &pool = SnapshotWriterPool::getInstance();
+		pool.configure(1, 4);
+		
+		WriteLog log;
+		log.open = false;
+		
+		Ref<WaterfallBackend> backend  = new WaterfallBackend(BINS, 0, "test");
+		Ref<PoolRecorder>     recorder = new PoolRecorder(backend, &log, 0, 0);
+		backend->addRecorder(recorder.get());
+		startStream(backend);
+		
+		uint32_t dropped = pool.getDropped();
+		
+		// The only thread waits in the first snapshot, so the next ones
+		// stay in the queue.
+		recorder->submit(0, routine);
+		TEST_ASSERT(log.waitFor(1), "first snapshot should be started");
+		for (int id = 1; id <= 4; id++)
+			TEST_ASSERT(recorder->submit(id, routine), "routine snapshot should be queued");
+		TEST_EQUALS(4, pool.getDepth(), "queue should be full");
+		TEST_EQUALS(dropped, pool.getDropped(), "nothing should be dropped yet");
+		
+		// The newest routine snapshot (4) makes room for the event.
+		TEST_ASSERT(recorder->submit(5, event), "event should be queued");
+		TEST_EQUALS(4, pool.getDepth(), "queue should stay full");
+		TEST_EQUALS(dropped + 1, pool.getDropped(), "evicted snapshot should be counted");
+		
+		// Only routine snapshots are left, nothing to evict for another one.
+		TEST_ASSERT(!recorder->submit(6, routine), "routine snapshot should be dropped");
+		TEST_EQUALS(dropped + 2, pool.getDropped(), "dropped snapshot should be counted");
+		
+		log.setOpen();
+		backend->endStream();
+		
+		const int expected[] = { 0, 5, 1, 2, 3 };
+		const int count      = sizeof(expected) / sizeof(expected[0]);
+		TEST_EQUALS(count, (int)log.writes.size(), "all queued snapshots should be written");
+		for (int i = 0; i < min(count, (int)log.writes.size()); i++)
+			TEST_EQUALS(expected[i], log.writes[i].second, "event first, then routine snapshots in order");
+		
+		pool.configure(2, SNAPSHOT_QUEUE_SIZE);
+	}
+	
+	void testRecorderOrder()
+	{
+		const int recorderCount = 3;
+		const int snapshots     = 20;
+		
+		SnapshotWriterPool &pool = SnapshotWriterPool::getInstance();
+		pool.configure(4, recorderCount * snapshots);
+		
+		WriteLog log;
+		
+		Ref<WaterfallBackend>     backend = new WaterfallBackend(BINS, 0, "test");
+		vector<Ref<PoolRecorder> > recorders;
+		for (int r = 0; r < recorderCount; r++) {
+			recorders.push_back(new PoolRecorder(backend, &log, r, 200));
+			backend->addRecorder(recorders.back().get());
+		}
+		startStream(backend);
+		
+		for (int id = 0; id < snapshots; id++) {
+			FOR_EACH(recorders, recorder) {
+				TEST_ASSERT((*recorder)->submit(id, SnapshotWriterPool::PRIORITY_ROUTINE),
+						  "snapshot should be queued");
+			}
+		}
+		backend->endStream();
+		
+		TEST_EQUALS(recorderCount * snapshots, (int)log.writes.size(), "all snapshots should be written");
+		
+		vector<int> next(recorderCount, 0);
+		int         outOfOrder = 0;
+		FOR_EACH(log.writes, write) {
+			if (write->second != next[write->first]) outOfOrder++;
+			next[write->first] = write->second + 1;
+		}
+		TEST_EQUALS(0, outOfOrder, "snapshots of a recorder should be written in order");
+		
+		FOR_EACH(recorders, recorder) {
+			TEST_ASSERT(!(*recorder)->overlapped, "snapshots of a recorder should be written one at a time");
+		}
+		
+		pool.configure(2, SNAPSHOT_QUEUE_SIZE);
+	}
+};
+
+RUN_SUITE(SnapshotWriterPoolTest);
+
+
+#endif /* end of include guard: SNAPSHOTWRITERPOOLTEST_Q3NV7HXB */
@@ -0,0 +1,160 @@
+/**
+ * \file   WaterfallBackendTest.h
+ * \author Jan Milík <milikjan@fit.cvut.cz>
+ * \date   2026-10-19
+ *
+ * \brief  Header file for the WaterfallBackendTest class.
+ */
+
+#ifndef WATERFALLBACKENDTEST_R4TN8XKD
+#define WATERFALLBACKENDTEST_R4TN8XKD
+
+#include <cppapp/cppapp.h>
+using namespace cppapp;
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "../src/WaterfallBackend.h"
+
+
+/**
+ * \brief Collects the RFI mask rows of a \ref WaterfallBackend as they are published.
+ */
+class MaskRecorder : public Recorder {
+public:
+	vector<vector<uint8_t> > masks; ///< Mask rows in the order of the FFT rows.
+	int                      rows;  ///< Number of published FFT rows.
+	int                      maxLag; ///< Maximal number of FFT rows without a mask.
+	
+	MaskRecorder(Ref<WaterfallBackend> backend) :
+		Recorder(backend), rows(0), maxLag(0)
+	{}
+	
+	virtual void update()
+	{
+		rows = buffer_->cursor().position;
+		
+		const uint8_t *mask;
+		while ((mask = getRFIMask(Cursor(masks.size()))) != NULL)
+			masks.push_back(vector<uint8_t>(mask, mask + rowCodec_->getWidth()));
+		
+		maxLag = max(maxLag, rows - (int)masks.size());
+	}
+};
+
+
+/**
+ * \brief Tests the spectral kurtosis RFI mask of \ref WaterfallBackend.
+ */
+class WaterfallBackendTest : public TestCase {
+public:
+	static const int SAMPLE_RATE = 48000;
+	static const int BINS        = 64;
+	static const int SK_FRAMES   = 64;
+	
+	WaterfallBackendTest()
+	{
+		TEST_ADD(WaterfallBackendTest, testRFIMask);
+	}
+	
+	/**
+	 * \brief Returns the row index of the FFT bin \c bin (the rows start
+	 *        with the negative frequencies).
+	 */
+	static int binColumn(int bin)
+	{
+		return bin + BINS / 2;
+	}
+	
+	void testRFIMask()
+	{
+		// Blocks 0 and 1 are Gaussian noise. From block 2 on, a constant
+		// carrier (SK close to 0) is added in bin 8 and a tone pulsed in
+		// one of eight rows (SK far above 1) in bin 20.
+		const int    blocks     = 5;
+		const int    rfiStart   = 2 * SK_FRAMES;
+		const int    carrierBin = 8;
+		const int    pulseBin   = 20;
+		
+		Ref<WaterfallBackend> backend = new WaterfallBackend(BINS, 0, "test");
+		backend->setSKFrames(SK_FRAMES);
+		backend->setSKThreshold(3.0f);
+		
+		Ref<MaskRecorder> recorder = new MaskRecorder(backend);
+		backend->addRecorder(recorder.get());
+		
+		StreamInfo streamInfo;
+		streamInfo.sampleRate = SAMPLE_RATE;
+		backend->startStream(streamInfo);
+		
+		// Half a block more, so that the last block is incomplete.
+		int rowCount = blocks * SK_FRAMES + SK_FRAMES / 2;
+		
+		vector<Complex> data(BINS);
+		DataInfo        info;
+		srand(2);
+		for (int row = 0; row < rowCount; row++) {
+			for (int i = 0; i < BINS; i++) {
+				double u1 = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+				double u2 = (double)rand() / (double)RAND_MAX;
+				double r  = 0.01 * sqrt(-2.0 * log(u1));
+				data[i].real = r * cos(2.0 * M_PI * u2);
+				data[i].imag = r * sin(2.0 * M_PI * u2);
+				
+				if (row >= rfiStart) {
+					double t     = (double)(row * BINS + i);
+					double phase = 2.0 * M_PI * carrierBin * t / BINS;
+					data[i].real += 0.5 * cos(phase);
+					data[i].imag += 0.5 * sin(phase);
+					
+					if ((row % 8) == 0) {
+						phase = 2.0 * M_PI * pulseBin * t / BINS;
+						data[i].real += 0.5 * cos(phase);
+						data[i].imag += 0.5 * sin(phase);
+					}
+				}
+			}
+			
+			backend->process(data, info);
+			info.offset += BINS;
+		}
+		
+		TEST_EQUALS(rowCount, recorder->rows, "all rows should be published");
+		TEST_EQUALS(blocks * SK_FRAMES, (int)recorder->masks.size(),
+				  "the masks of the complete blocks should be published");
+		TEST_EQUALS(SK_FRAMES - 1, recorder->maxLag, "masks should lag by less than a block");
+		
+		int falseMarks = 0;
+		int noiseBins  = 0;
+		for (int row = 0; row < (int)recorder->masks.size(); row++) {
+			const vector<uint8_t> &mask = recorder->masks[row];
+			bool rfi = (row >= rfiStart);
+			
+			// The masks belong to the rows' own block.
+			TEST_EQUALS(rfi, mask[binColumn(carrierBin)] != 0, "carrier should be marked in its block only");
+			TEST_EQUALS(rfi, mask[binColumn(pulseBin)] != 0, "pulses should be marked in their block only");
+			if (row % SK_FRAMES != 0)
+				TEST_ASSERT(mask == recorder->masks[row - 1], "the rows of a block should share the mask");
+			
+			// Bins far from the RFI (the window leaks into a few
+			// neighbours) only see noise.
+			for (int bin = -BINS / 2; bin < BINS / 2; bin++) {
+				if (rfi && ((abs(bin - carrierBin) <= 3) || (abs(bin - pulseBin) <= 3)))
+					continue;
+				noiseBins++;
+				if (mask[binColumn(bin)] != 0)
+					falseMarks++;
+			}
+		}
+		TEST_ASSERT(falseMarks * 100 < noiseBins * 5, "noise should rarely exceed the threshold");
+		
+		backend->endStream();
+	}
+};
+
+RUN_SUITE(WaterfallBackendTest);
+
+
+#endif /* end of include guard: WATERFALLBACKENDTEST_R4TN8XKD */
@@ -11,6 +11,17 @@
 using namespace cppapp;
 
 #include "RingBufferTest.h"
+#include "FixedFFTTest.h"
+#include "RowCodecTest.h"
+#include "IQBufferTest.h"
+#include "ImpulseBlankerTest.h"
+#include "AllocationTest.h"
+#include "QuicklookTest.h"
+#include "ChunkFileTest.h"
+#include "WaterfallBackendTest.h"
+#include "BasebandRecorderTest.h"
+#include "OverviewRecorderTest.h"
+#include "SnapshotWriterPoolTest.h"
 
 
 //class App : public AppBase {